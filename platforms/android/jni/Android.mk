@@ -33,18 +33,31 @@ LOCAL_C_INCLUDES := $(LOCAL_PATH)/include_all \
 
 DIFONT_SRC_FILES := \
 	$(DIFONT_SRC_PATH)/difont/Buffer.cpp \
+	$(DIFONT_SRC_PATH)/difont/common/BlockEncoder.cpp \
+	$(DIFONT_SRC_PATH)/difont/common/MappedFile.cpp \
 	$(DIFONT_SRC_PATH)/difont/common/Point.cpp \
 	$(DIFONT_SRC_PATH)/difont/common/Size.cpp \
+	$(DIFONT_SRC_PATH)/difont/common/Thread.cpp \
+	$(DIFONT_SRC_PATH)/difont/font/BakedFont.cpp \
 	$(DIFONT_SRC_PATH)/difont/font/Font.cpp \
+	$(DIFONT_SRC_PATH)/difont/font/FontCollection.cpp \
+	$(DIFONT_SRC_PATH)/difont/font/FrameBudget.cpp \
 	$(DIFONT_SRC_PATH)/difont/font/OutlineFont.cpp \
 	$(DIFONT_SRC_PATH)/difont/font/PolygonFont.cpp \
 	$(DIFONT_SRC_PATH)/difont/font/TextureFont.cpp \
+	$(DIFONT_SRC_PATH)/difont/freetype/AccumulationRasterizer.cpp \
 	$(DIFONT_SRC_PATH)/difont/freetype/Charmap.cpp \
 	$(DIFONT_SRC_PATH)/difont/freetype/Face.cpp \
+	$(DIFONT_SRC_PATH)/difont/freetype/FaceRegistry.cpp \
+	$(DIFONT_SRC_PATH)/difont/freetype/KerningTable.cpp \
+	$(DIFONT_SRC_PATH)/difont/freetype/LcdRasterizer.cpp \
 	$(DIFONT_SRC_PATH)/difont/freetype/Library.cpp \
 	$(DIFONT_SRC_PATH)/difont/freetype/GlyphContainer.cpp \
+	$(DIFONT_SRC_PATH)/difont/freetype/RasterWorkers.cpp \
+	$(DIFONT_SRC_PATH)/difont/freetype/SpanRasterizer.cpp \
 	$(DIFONT_SRC_PATH)/difont/glyph/Glyph.cpp \
 	$(DIFONT_SRC_PATH)/difont/glyph/OutlineGlyph.cpp \
+	$(DIFONT_SRC_PATH)/difont/glyph/PlaceholderGlyph.cpp \
 	$(DIFONT_SRC_PATH)/difont/glyph/PolygonGlyph.cpp \
 	$(DIFONT_SRC_PATH)/difont/glyph/TextureGlyph.cpp \
 	$(DIFONT_SRC_PATH)/difont/layout/Layout.cpp \
@@ -0,0 +1,229 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <difont/difont.h>
+
+#ifndef _DIFONT_BakedFont__
+#define _DIFONT_BakedFont__
+
+/**
+ * difont::BakedFont renders text from a font baked ahead of time by the
+ * difont-bake tool.
+ *
+ * The baked file holds the texture pages, glyph metrics, character map
+ * and kerning for a fixed set of sizes and characters, so the font is
+ * ready as soon as the file is mapped: nothing is rasterised and FreeType
+ * is never called. Characters that weren't baked are drawn with the
+ * face's missing glyph. Output is the same textured quads as TextureFont.
+ *
+ * @see     TextureFont
+ */
+namespace difont {
+    class BakedFontImpl;
+
+    class BakedFont {
+    public:
+        /**
+         * Map and validate a baked font file. Sets Error flag.
+         *
+         * @param bakedFilePath  baked font file path.
+         */
+        BakedFont(const char* bakedFilePath);
+
+        /**
+         * Read a baked font from a buffer in memory. Sets Error flag.
+         * The buffer is owned by the client and is NOT copied. It must be
+         * 8 byte aligned and stay valid while the font is used.
+         *
+         * @param pBufferBytes  the in-memory buffer
+         * @param bufferSizeInBytes  the length of the buffer in bytes
+         */
+        BakedFont(const unsigned char *pBufferBytes,
+                  size_t bufferSizeInBytes);
+
+        /**
+         * Destructor
+         */
+        virtual ~BakedFont();
+
+        /**
+         * Select one of the baked sizes.
+         *
+         * @param size      the face size in points (1/72 inch)
+         * @param res       the resolution of the target device.
+         * @return          <code>true</code> if the size was baked.
+         */
+        virtual bool FaceSize(const unsigned int size,
+                              const unsigned int res = 72);
+
+        /**
+         * Get the current face size in points (1/72 inch).
+         *
+         * @return face size, or zero if no size has been selected.
+         */
+        virtual unsigned int FaceSize() const;
+
+        /**
+         * Get the global ascender height for the face.
+         *
+         * @return  Ascender height
+         */
+        virtual float Ascender() const;
+
+        /**
+         * Gets the global descender height for the face.
+         *
+         * @return  Descender height
+         */
+        virtual float Descender() const;
+
+        /**
+         * Gets the line spacing for the font.
+         *
+         * @return  Line height
+         */
+        virtual float LineHeight() const;
+
+        /**
+         * Get the bounding box for a string.
+         *
+         * @param string  A char buffer.
+         * @param len  The length of the string. If < 0 then all characters
+         *             will be checked until a null character is encountered
+         *             (optional).
+         * @param position  The pen position of the first character (optional).
+         * @param spacing  A displacement vector to add after each character
+         *                 has been checked (optional).
+         * @return  The corresponding bounding box.
+         */
+        virtual difont::BBox BBox(const char *string, const int len = -1,
+                                  difont::Point position = difont::Point(),
+                                  difont::Point spacing = difont::Point());
+
+        /**
+         * Get the bounding box for a string.
+         *
+         * @param string  A wchar_t buffer.
+         * @param len  The length of the string. If < 0 then all characters
+         *             will be checked until a null character is encountered
+         *             (optional).
+         * @param position  The pen position of the first character (optional).
+         * @param spacing  A displacement vector to add after each character
+         *                 has been checked (optional).
+         * @return  The corresponding bounding box.
+         */
+        virtual difont::BBox BBox(const wchar_t *string, const int len = -1,
+                                  difont::Point position = difont::Point(),
+                                  difont::Point spacing = difont::Point());
+
+        /**
+         * Get the advance for a string.
+         *
+         * @param string  'C' style string to be checked.
+         * @param len  The length of the string. If < 0 then all characters
+         *             will be checked until a null character is encountered
+         *             (optional).
+         * @param spacing  A displacement vector to add after each character
+         *                 has been checked (optional).
+         * @return  The string's advance width.
+         */
+        virtual float Advance(const char* string, const int len = -1,
+                              difont::Point spacing = difont::Point());
+
+        /**
+         * Get the advance for a string.
+         *
+         * @param string  A wchar_t string
+         * @param len  The length of the string. If < 0 then all characters
+         *             will be checked until a null character is encountered
+         *             (optional).
+         * @param spacing  A displacement vector to add after each character
+         *                 has been checked (optional).
+         * @return  The string's advance width.
+         */
+        virtual float Advance(const wchar_t* string, const int len = -1,
+                              difont::Point spacing = difont::Point());
+
+        /**
+         * Render a string of characters. The textures are created the
+         * first time this is called, so it needs a current GL context.
+         *
+         * @param string  'C' style string to be output.
+         * @param len  The length of the string. If < 0 then all characters
+         *             will be displayed until a null character is encountered
+         *             (optional).
+         * @param position  The pen position of the first character (optional).
+         * @param spacing  A displacement vector to add after each character
+         *                 has been displayed (optional).
+         * @param renderMode  Render mode to use for display (optional).
+         * @return  The new pen position after the last character was output.
+         */
+        virtual difont::Point Render(const char* string, const int len = -1,
+                                     difont::Point position = difont::Point(),
+                                     difont::Point spacing = difont::Point(),
+                                     int renderMode = difont::RENDER_ALL);
+
+        /**
+         * Render a string of characters
+         *
+         * @param string    wchar_t string to be output.
+         * @param len  The length of the string. If < 0 then all characters
+         *             will be displayed until a null character is encountered
+         *             (optional).
+         * @param position  The pen position of the first character (optional).
+         * @param spacing  A displacement vector to add after each character
+         *                 has been displayed (optional).
+         * @param renderMode  Render mode to use for display (optional).
+         * @return  The new pen position after the last character was output.
+         */
+        virtual difont::Point Render(const wchar_t *string, const int len = -1,
+                                     difont::Point position = difont::Point(),
+                                     difont::Point spacing = difont::Point(),
+                                     int renderMode = difont::RENDER_ALL);
+
+        /**
+         * Queries the font for errors.
+         *
+         * @return  The current error code, using the FreeType error
+         *          values.
+         */
+        virtual FT_Error Error() const;
+
+    private:
+        /**
+         * Disallow copies, the implementation owns the mapping and textures.
+         */
+        BakedFont(const BakedFont&);
+        BakedFont& operator=(const BakedFont&);
+
+        /**
+         * Internal implementation object. For private use only.
+         */
+        BakedFontImpl *impl;
+    };
+}
+
+#endif // _DIFONT_BakedFont__
@@ -350,6 +350,65 @@ namespace difont {
                                      difont::Point spacing = difont::Point(),
                                      int renderMode = difont::RENDER_ALL);
 
+        /**
+         * A run of glyphs already shaped, by a text shaper or a layout
+         * kept from an earlier frame. The glyphs are picked by their index
+         * in the face, without the character map, and are not kerned.
+         */
+        struct GlyphRun {
+            /**
+             * The index of each glyph in the face.
+             */
+            const unsigned int* glyphs;
+
+            /**
+             * The number of glyphs.
+             */
+            unsigned int count;
+
+            /**
+             * The pen movement after each glyph, or <code>NULL</code> to
+             * move by the glyph's own advance.
+             */
+            const difont::Point* advances;
+
+            /**
+             * A displacement of each glyph from the pen, or
+             * <code>NULL</code> to draw each glyph at the pen.
+             */
+            const difont::Point* offsets;
+        };
+
+        /**
+         * Get the bounding box for a run of glyphs.
+         *
+         * @param run  The glyphs and their placement.
+         * @param position  The pen position of the first glyph (optional).
+         * @return  The corresponding bounding box.
+         */
+        virtual difont::BBox BBox(const GlyphRun& run,
+                                  difont::Point position = difont::Point());
+
+        /**
+         * Get the advance for a run of glyphs.
+         *
+         * @param run  The glyphs and their placement.
+         * @return  The run's advance width.
+         */
+        virtual float Advance(const GlyphRun& run);
+
+        /**
+         * Render a run of glyphs.
+         *
+         * @param run  The glyphs and their placement.
+         * @param position  The pen position of the first glyph (optional).
+         * @param renderMode  Render mode to use for display (optional).
+         * @return  The new pen position after the last glyph was output.
+         */
+        virtual difont::Point RenderGlyphs(const GlyphRun& run,
+                                           difont::Point position = difont::Point(),
+                                           int renderMode = difont::RENDER_ALL);
+
 
         virtual void PreRender();
 
@@ -364,10 +423,113 @@ namespace difont {
          */
         virtual FT_Error Error() const;
 
+        /**
+         * Limit the glyphs all fonts load per frame, so text that is new
+         * to a font can't stall a frame. Over the limit, a glyph is drawn
+         * as a blank the width of its advance until BeginFrame() loads it
+         * in a later frame. Glyphs are loaded in the order they were first
+         * needed.
+         *
+         * The budget is only reset by BeginFrame(), which must be called
+         * every frame while a limit is set.
+         *
+         * @param glyphs        The most glyphs to load per frame, or 0 for
+         *                      no limit.
+         * @param microseconds  The most time to spend loading glyphs per
+         *                      frame, or 0 for no limit. A glyph that
+         *                      starts within the time is always finished.
+         */
+        static void GlyphBudget(unsigned int glyphs, unsigned int microseconds = 0);
+
+        /**
+         * Start a frame: reset the glyph budget and spend it on the glyphs
+         * left over from earlier frames. Call it with the GL context
+         * current, before any text is rendered.
+         */
+        static void BeginFrame();
+
+        /**
+         * End a frame.
+         *
+         * @return  The number of glyphs waiting for a later frame.
+         */
+        static unsigned int EndFrame();
+
+        /**
+         * Counters for the glyphs the font has made to render text.
+         */
+        struct GlyphCacheStats {
+            /**
+             * Glyphs found already made, made because they were missing,
+             * and deleted to stay within a budget. Kept when the size
+             * changes.
+             */
+            unsigned long hits, misses, evictions;
+
+            /**
+             * The glyphs held, and the bytes they use, not counting
+             * texture atlas pages.
+             */
+            unsigned int glyphs;
+            size_t bytes;
+        };
+
+        /**
+         * Limit the memory used by the glyphs of this font. Over the
+         * limit, the glyphs used least recently are deleted and made again
+         * if they are drawn later. Their metrics are kept, so measuring
+         * text is unaffected. The budget is kept when the size changes.
+         *
+         * Only the glyphs themselves count. The atlas pages of a
+         * TextureFont don't: an evicted glyph's bitmap stays in its page
+         * for when the glyph is made again. See
+         * TextureFont::AtlasOccupancy() and TextureFont::Compact().
+         *
+         * @param bytes  The most bytes the glyphs may use, or 0 for no
+         *               limit.
+         */
+        void GlyphCacheBudget(size_t bytes);
+
+        /**
+         * Limit the memory used by the glyphs of all fonts together. A
+         * font making a glyph over the limit deletes its own least
+         * recently used glyphs. As with GlyphCacheBudget(), texture atlas
+         * pages are not counted.
+         *
+         * @param bytes  The most bytes the glyphs may use, or 0 for no
+         *               limit.
+         */
+        static void GlobalGlyphCacheBudget(size_t bytes);
+
+        /**
+         * Get the glyph cache counters.
+         */
+        GlyphCacheStats GlyphCacheStatistics() const;
+
+        /**
+         * Let several threads use the font at once, for measuring text on
+         * worker threads while it is drawn on the render thread.
+         *
+         * Advance() and BBox() of text whose glyphs have been measured or
+         * drawn before share a read lock and run in parallel. The first
+         * measurement of a glyph, and every other call, hold the font to
+         * themselves. Rendering must still happen on the thread with the
+         * GL context.
+         *
+         * Off by default, when the font must only be used by one thread at
+         * a time. Turn it on or off while no other thread uses the font.
+         *
+         * @param enable  <code>true</code> to lock the font for each call.
+         */
+        void ConcurrentMeasurement(bool enable);
+
     protected:
         /* Allow impl to access MakeGlyph */
         friend class FontImpl;
 
+        /* Allow collections to ask which characters the font has */
+        friend class FontCollectionImpl;
+
         /**
          * Construct a glyph of the correct type.
          *
@@ -0,0 +1,226 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <difont/difont.h>
+
+#ifndef _DIFONT_FontCollection__
+#define _DIFONT_FontCollection__
+
+/**
+ * difont::FontCollection draws text with an ordered list of fonts, each
+ * character with the first font that has a glyph for it, so mixed Latin,
+ * CJK and symbol text can be measured and drawn in one call.
+ *
+ * Which font draws a character is decided the first time it is seen and
+ * kept in a table of one byte per character, so later strings don't ask
+ * every font again. Characters no font has are drawn with the first
+ * font's missing glyph.
+ *
+ * A string is split into runs of characters drawn by the same font. Each
+ * run is measured and drawn by its font, kerned within the run. Render()
+ * draws every run of one font before the next font's, so the quads of a
+ * texture font's pages stay together in the FontMeshSet.
+ *
+ * The fonts are not owned. Their sizes and character maps should be set
+ * before they are added.
+ *
+ * @see     Font
+ */
+namespace difont {
+    class FontCollectionImpl;
+
+    class FontCollection {
+    public:
+        FontCollection();
+
+        /**
+         * Destructor. The fonts are not deleted.
+         */
+        virtual ~FontCollection();
+
+        /**
+         * Add a font to the end of the list, to draw the characters the
+         * fonts before it don't have.
+         *
+         * @param font  A font, which must outlive the collection.
+         * @return      <code>false</code> if the collection is full, at
+         *              <code>MAX_FONTS</code> fonts.
+         */
+        bool AddFont(Font* font);
+
+        /**
+         * The most fonts a collection can hold.
+         */
+        static const unsigned int MAX_FONTS = 255;
+
+        /**
+         * Get the number of fonts in the collection.
+         */
+        unsigned int FontCount() const;
+
+        /**
+         * Get the font that draws a character.
+         *
+         * @param charCode  The character code.
+         * @return  The first font with a glyph for the character, the
+         *          first font if none has one, or <code>NULL</code> if the
+         *          collection is empty.
+         */
+        Font* FontFor(unsigned int charCode);
+
+        /**
+         * Get the highest ascender of the fonts.
+         */
+        float Ascender() const;
+
+        /**
+         * Get the lowest descender of the fonts.
+         */
+        float Descender() const;
+
+        /**
+         * Get the largest line spacing of the fonts.
+         */
+        float LineHeight() const;
+
+        /**
+         * Get the bounding box for a string.
+         *
+         * @param string  A char buffer.
+         * @param len  The length of the string. If < 0 then all characters
+         *             will be checked until a null character is encountered
+         *             (optional).
+         * @param position  The pen position of the first character (optional).
+         * @param spacing  A displacement vector to add after each character
+         *                 has been checked (optional).
+         * @return  The corresponding bounding box.
+         */
+        difont::BBox BBox(const char *string, const int len = -1,
+                          difont::Point position = difont::Point(),
+                          difont::Point spacing = difont::Point());
+
+        /**
+         * Get the bounding box for a string.
+         *
+         * @param string  A wchar_t buffer.
+         * @param len  The length of the string. If < 0 then all characters
+         *             will be checked until a null character is encountered
+         *             (optional).
+         * @param position  The pen position of the first character (optional).
+         * @param spacing  A displacement vector to add after each character
+         *                 has been checked (optional).
+         * @return  The corresponding bounding box.
+         */
+        difont::BBox BBox(const wchar_t *string, const int len = -1,
+                          difont::Point position = difont::Point(),
+                          difont::Point spacing = difont::Point());
+
+        /**
+         * Get the advance for a string.
+         *
+         * @param string  'C' style string to be checked.
+         * @param len  The length of the string. If < 0 then all characters
+         *             will be checked until a null character is encountered
+         *             (optional).
+         * @param spacing  A displacement vector to add after each character
+         *                 has been checked (optional).
+         * @return  The string's advance width.
+         */
+        float Advance(const char* string, const int len = -1,
+                      difont::Point spacing = difont::Point());
+
+        /**
+         * Get the advance for a string.
+         *
+         * @param string  A wchar_t string
+         * @param len  The length of the string. If < 0 then all characters
+         *             will be checked until a null character is encountered
+         *             (optional).
+         * @param spacing  A displacement vector to add after each character
+         *                 has been checked (optional).
+         * @return  The string's advance width.
+         */
+        float Advance(const wchar_t* string, const int len = -1,
+                      difont::Point spacing = difont::Point());
+
+        /**
+         * Render a string of characters.
+         *
+         * @param string    'C' style string to be output.
+         * @param len  The length of the string. If < 0 then all characters
+         *             will be displayed until a null character is encountered
+         *             (optional).
+         * @param position  The pen position of the first character (optional).
+         * @param spacing  A displacement vector to add after each character
+         *                 has been displayed (optional).
+         * @param renderMode  Render mode to use for display (optional).
+         * @return  The new pen position after the last character was output.
+         */
+        difont::Point Render(const char* string, const int len = -1,
+                             difont::Point position = difont::Point(),
+                             difont::Point spacing = difont::Point(),
+                             int renderMode = difont::RENDER_ALL);
+
+        /**
+         * Render a string of characters
+         *
+         * @param string    wchar_t string to be output.
+         * @param len  The length of the string. If < 0 then all characters
+         *             will be displayed until a null character is encountered
+         *             (optional).
+         * @param position  The pen position of the first character (optional).
+         * @param spacing  A displacement vector to add after each character
+         *                 has been displayed (optional).
+         * @param renderMode  Render mode to use for display (optional).
+         * @return  The new pen position after the last character was output.
+         */
+        difont::Point Render(const wchar_t *string, const int len = -1,
+                             difont::Point position = difont::Point(),
+                             difont::Point spacing = difont::Point(),
+                             int renderMode = difont::RENDER_ALL);
+
+        /**
+         * Queries the collection for errors.
+         *
+         * @return  The last error of a font, or zero.
+         */
+        FT_Error Error() const;
+
+    private:
+        /**
+         * Disallow copies, the implementation owns the lookup table.
+         */
+        FontCollection(const FontCollection&);
+        FontCollection& operator=(const FontCollection&);
+
+        /**
+         * Internal implementation object. For private use only.
+         */
+        FontCollectionImpl *impl;
+    };
+}
+
+#endif // _DIFONT_FontCollection__
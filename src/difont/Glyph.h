@@ -70,6 +70,9 @@ namespace difont {
         friend class PolygonGlyph;
         friend class TextureGlyph;
 
+        /* The container reads the implementation to render it directly */
+        friend class GlyphContainer;
+
     public:
         /**
          * Destructor
@@ -62,6 +62,271 @@ namespace difont {
          */
         virtual ~TextureFont();
 
+        /**
+         * Set the number of horizontal subpixel positions that glyphs are
+         * rasterised at. With one phase (the default) the pen is snapped to
+         * whole pixels. With <code>n</code> phases, each glyph is drawn from
+         * a bitmap rasterised at the nearest multiple of 1/n pixel to the
+         * fractional pen position, so text moves smoothly when scrolled or
+         * animated. Phases other than zero are only rasterised the first time
+         * a glyph is drawn at that offset.
+         *
+         * Changing the phase count discards the glyphs already loaded.
+         *
+         * @param phases  The number of phases, from 1 to
+         *                <code>MAX_SUBPIXEL_PHASES</code>.
+         */
+        void SubpixelPhases(unsigned int phases);
+
+        /**
+         * The largest number of subpixel phases supported.
+         */
+        static const unsigned int MAX_SUBPIXEL_PHASES = 8;
+
+        /**
+         * Called when glyphs rasterised in the background are ready.
+         */
+        typedef void (*GlyphsReadyCallback)(TextureFont *font, void *userData);
+
+        /**
+         * Rasterise new glyphs on background threads instead of during
+         * Render(), so a burst of characters not seen before doesn't stall
+         * the frame. Each thread opens its own copy of the face.
+         *
+         * Until its bitmap is ready a glyph draws nothing but advances the
+         * pen by its real advance; its bounding box is the width of the
+         * advance and the height of the face. Finished bitmaps are added to
+         * the atlas and uploaded by the next Render() or Flush().
+         *
+         * <code>callback</code> is called on a background thread when
+         * bitmaps are ready, once until they are added. Use it to schedule a
+         * redraw; it must not call the font.
+         *
+         * A font read from memory must keep its buffer valid while the
+         * threads run. If no thread can be started, or the font file
+         * couldn't be mapped for the threads to share, glyphs are
+         * rasterised on the calling thread as with 0.
+         *
+         * @param threads   The number of threads, or 0 (the default) to
+         *                  rasterise on the calling thread. Glyphs still
+         *                  waiting are then rasterised straight away.
+         * @param callback  Called when bitmaps are ready, or
+         *                  <code>NULL</code>.
+         * @param userData  Passed to <code>callback</code>.
+         */
+        void AsyncRasterization(unsigned int threads,
+                                GlyphsReadyCallback callback = NULL,
+                                void *userData = NULL);
+
+        /**
+         * Build mipmaps for the glyph atlas, so text drawn smaller than the
+         * face size is filtered instead of aliased. The mipmaps are made
+         * from the atlas on the CPU rather than with glGenerateMipmap:
+         * bitmaps are aligned to the texel size of the smallest level and
+         * kept that far apart, so no level blends neighbouring glyphs.
+         * Each level is uploaded with the rows of the full size page it
+         * was made from.
+         *
+         * Changing the level count discards the glyphs already loaded.
+         * Not available where GL_TEXTURE_MAX_LEVEL isn't, such as
+         * OpenGL ES 2.
+         *
+         * @param levels  The number of levels below the full size, from 0
+         *                (the default, no mipmaps) to
+         *                <code>MAX_MIPMAP_LEVELS</code>.
+         * @return  The number of levels in use.
+         */
+        unsigned int MipmapLevels(unsigned int levels);
+
+        /**
+         * The largest number of mipmap levels supported.
+         */
+        static const unsigned int MAX_MIPMAP_LEVELS = 4;
+
+        /**
+         * Upload the glyphs added to the atlas since the last flush.
+         * Render() does this before it returns, so it is only needed when
+         * glyphs were loaded by BBox() or Advance() and the meshes from an
+         * earlier Render() are drawn.
+         */
+        void Flush();
+
+        /**
+         * Cache the glyph atlas in a directory, so glyphs rasterised in one
+         * run of the application are reloaded in the next without going
+         * through FreeType.
+         *
+         * One file is kept per font, size, resolution and set of load
+         * flags. It is loaded when the face size is set and written when
+         * the size changes, the font is destroyed or SaveCache() is called.
+         * Files that don't match the font, or were written by a different
+         * version of difont or on a device with another byte order, are
+         * ignored and replaced.
+         *
+         * @param path  An existing, writable directory, or an empty string
+         *              or <code>NULL</code> to disable the cache.
+         */
+        void CacheDirectory(const char* path);
+
+        /**
+         * Write the glyph atlas to the cache directory now, if any glyphs
+         * have been added since it was loaded. Useful on platforms where
+         * the application can be killed without the font being destroyed.
+         *
+         * @return  <code>true</code> if the cache was written.
+         */
+        bool SaveCache();
+
+        /**
+         * Keep every page of the glyph atlas as a layer of one
+         * GL_TEXTURE_2D_ARRAY instead of a texture per page, so text that
+         * spans several pages draws with a single texture binding.
+         *
+         * The meshes' texture is then a texture array and the layer of each
+         * vertex is in <code>texCoord[2]</code>. All layers have the size
+         * of the first page, and the array is reallocated with twice the
+         * layers when it fills up. Not available where the GL headers lack
+         * texture arrays, such as OpenGL ES 2.
+         *
+         * Changing the mode discards the glyphs already loaded.
+         *
+         * @param useArray  <code>true</code> for texture array pages.
+         * @return  <code>true</code> if texture array pages are in use.
+         */
+        bool TextureArrayPages(bool useArray);
+
+        /**
+         * Keep full pages of the glyph atlas block compressed, which takes
+         * half the texture memory of 8 bit pages. A page is compressed on
+         * the CPU, as BC4 where the GL headers have it and otherwise as
+         * EAC R11, by the first Render() or Flush() after glyphs start
+         * going into the next page; the page being filled stays
+         * uncompressed. Compressed pages are swizzled so their red channel
+         * reads as alpha, like the other pages.
+         *
+         * Pages are not compressed while texture array pages or LCD
+         * rendering are in use.
+         * Not available where the GL headers lack both formats or texture
+         * swizzles, such as OpenGL ES 2.
+         *
+         * Changing the mode discards the glyphs already loaded.
+         *
+         * @param compress  <code>true</code> for compressed pages.
+         * @return  <code>true</code> if full pages will be compressed.
+         */
+        bool CompressedPages(bool compress);
+
+        /**
+         * Rasterise glyphs for LCD screens with horizontal RGB stripes, so
+         * small text is sharper than with plain coverage. Each glyph is
+         * rasterised at three times its width and a five tap filter
+         * spreads each stripe's coverage over its neighbours, as FreeType's
+         * FT_RENDER_MODE_LCD does, into GL_RGB pages instead of GL_ALPHA.
+         *
+         * The red, green and blue of a texel are the coverage of the
+         * left, middle and right thirds of its pixel, so the texture
+         * co-ords of each quad serve all three. Draw the quads at whole
+         * pixels, or with subpixel phases, and blend each channel by its
+         * own coverage: output the text colour as the first colour and
+         * the texel as the second, with dual-source blending, i.e.
+         * <code>glBlendFunc(GL_SRC1_COLOR, GL_ONE_MINUS_SRC1_COLOR)</code>.
+         *
+         * Changing the mode or the filter discards the glyphs already
+         * loaded.
+         *
+         * @param enable  <code>true</code> for LCD rendering.
+         * @param filter  Five weights in 256ths for the stripes two to the
+         *                left through two to the right, adding up to 256,
+         *                or <code>NULL</code> for FreeType's default filter
+         *                {0x08, 0x4D, 0x56, 0x4D, 0x08}. {0x00, 0x55, 0x56,
+         *                0x55, 0x00} is FreeType's light filter.
+         * @return  <code>true</code> if glyphs are rasterised for LCDs.
+         */
+        bool LcdRendering(bool enable, const unsigned char *filter = NULL);
+
+        /**
+         * Rasterise glyphs at a few bucket sizes instead of at every face
+         * size, so text whose size changes often, as in animations, reuses
+         * one atlas. The face size is rounded up to the next of the series
+         * 1, 2, ... where each size is <code>ratio</code> times the one
+         * before, rounded; with 1.25 that is ..., 10, 13, 16, 20, 25, ...
+         *
+         * Glyphs are drawn at the face size by scaling their quads, and
+         * their advances, the kerning and the font's metrics are those
+         * of the face size, so layout is the same as without buckets.
+         * Setting another face size in the same bucket keeps the glyphs
+         * already rasterised. Faces that aren't scalable aren't bucketed.
+         *
+         * @param ratio  The ratio between bucket sizes, or 1 or less (the
+         *               default) to rasterise at every face size.
+         */
+        void SizeBuckets(float ratio);
+
+        /**
+         * Rasterise glyphs at a list of bucket sizes, like
+         * <code>SizeBuckets(float)</code>. The face size is rounded up to
+         * the next size in the list; sizes above the largest aren't
+         * bucketed.
+         *
+         * @param sizes  The bucket sizes, in any order, or
+         *               <code>NULL</code> to turn buckets off.
+         * @param count  The number of sizes.
+         */
+        void SizeBuckets(const unsigned int *sizes, unsigned int count);
+
+        /**
+         * How full the pages of the glyph atlas are.
+         */
+        struct AtlasStats {
+            /**
+             * The number of pages.
+             */
+            unsigned int pages;
+
+            /**
+             * The number of glyph bitmaps in the pages.
+             */
+            unsigned int bitmaps;
+
+            /**
+             * The texels of all the pages, and those covered by bitmaps.
+             */
+            size_t texels, usedTexels;
+        };
+
+        /**
+         * The atlas before and after a Compact().
+         */
+        struct CompactionStats {
+            AtlasStats before, after;
+        };
+
+        /**
+         * Get how full the pages of the glyph atlas are. The pages are not
+         * part of the glyph cache budget, so this is how to watch them.
+         */
+        AtlasStats AtlasOccupancy();
+
+        /**
+         * Repack the glyph bitmaps of the least full pages of the atlas
+         * into as few pages as hold them, tallest first in rows of their
+         * own height, and delete the pages they leave. New glyphs go into
+         * rows the height of the tallest glyph of the face, so a page
+         * filled with short glyphs is mostly gutter; repacking reclaims
+         * it. The bitmaps are copied from the pixels kept on the CPU, and
+         * the glyphs use their new places from the next Render().
+         *
+         * Nothing changes unless it frees at least one page. Call it
+         * between frames, once the meshes from the last Render() have
+         * been drawn, as it deletes their textures.
+         *
+         * @param maxPages  The most pages to repack in one call, so the
+         *                  work can be spread over frames, or 0 for all
+         *                  of them.
+         * @return  The atlas before and after.
+         */
+        CompactionStats Compact(unsigned int maxPages = 0);
+
     protected:
         /**
          * Construct a glyph of the correct type.
@@ -35,11 +35,28 @@
  * glyphs.
  */
 namespace difont {
+    class TextureFontImpl;
+
     class TextureGlyph : public Glyph {
     public:
         /**
          * Constructor
          *
+         * @param glyph       The Freetype glyph to be processed
+         * @param font        The texture font that owns the textures this
+         *                    glyph will be drawn in
+         * @param glyphIndex  The index of the glyph in the font face, used
+         *                    to rasterise further subpixel phases
+         */
+        TextureGlyph(FT_GlyphSlot glyph, TextureFontImpl *font,
+                     unsigned int glyphIndex);
+
+        /**
+         * Constructor (deprecated). Renders the glyph into part of a texture
+         * the caller owns, as FTGL's TextureGlyph did. The glyph has one
+         * bitmap, so it is drawn at whole pixels, and TextureFont doesn't
+         * manage it: prefer the constructor that takes the font.
+         *
          * @param glyph     The Freetype glyph to be processed
          * @param id        The id of the texture that this glyph will be
          *                  drawn in
@@ -51,7 +68,16 @@ namespace difont {
          * @param height    The height (number of rows) of the parent texture
          */
         TextureGlyph(FT_GlyphSlot glyph, int id, int xOffset, int yOffset,
-                       int width, int height);
+                     int width, int height);
+
+        /**
+         * Construct a glyph from bitmaps the font already holds, such as
+         * those loaded from its atlas cache.
+         *
+         * @param font        The texture font holding the bitmaps
+         * @param glyphIndex  The index of the glyph in the font face
+         */
+        TextureGlyph(TextureFontImpl *font, unsigned int glyphIndex);
 
         /**
          * Destructor
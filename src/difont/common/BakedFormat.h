@@ -0,0 +1,136 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_BAKED_FORMAT_H_
+#define _DIFONT_BAKED_FORMAT_H_
+
+#include <stdint.h>
+
+/**
+ * The layout of a baked font file, written by the difont-bake tool and
+ * read by BakedFont.
+ *
+ * The file starts with a FileHeader. Every other block is found through
+ * an offset from the start of the file and is 8 byte aligned, so the
+ * tables can be used in place from a memory mapping:
+ *
+ *   PageRecord[pageCount]      at FileHeader::pageTable
+ *   SizeRecord[sizeCount]      at FileHeader::sizeTable
+ *   per size:
+ *     GlyphRecord[glyphCount]    at SizeRecord::glyphTable
+ *     CharRecord[charCount]      at SizeRecord::charTable
+ *     KerningRecord[kerningCount] at SizeRecord::kerningTable
+ *   per page:
+ *     width * height alpha bytes at PageRecord::pixels
+ *
+ * Values are in the byte order of the machine that baked the file.
+ * Distances are in pixels at the size's resolution, with y pointing up.
+ */
+namespace difont {
+    namespace baked {
+        const char MAGIC[4] = { 'D', 'F', 'B', 'K' };
+
+        /**
+         * Bump whenever the layout of any record changes.
+         */
+        const uint32_t VERSION = 1;
+
+        const uint32_t ENDIAN_TAG = 0x01020304;
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            uint32_t byteOrder;
+            uint32_t headerSize;
+            uint32_t pageCount;
+            uint32_t sizeCount;
+            uint64_t fileLength;
+            uint64_t pageTable;
+            uint64_t sizeTable;
+        };
+
+        /**
+         * An 8 bit alpha texture, stored top row first.
+         */
+        struct PageRecord {
+            uint32_t width;
+            uint32_t height;
+            uint64_t pixels;
+        };
+
+        /**
+         * The glyphs baked for one face size. Glyph 0 is the face's
+         * missing glyph, drawn for characters that weren't baked.
+         */
+        struct SizeRecord {
+            uint32_t size;
+            uint32_t resolution;
+            float ascender;
+            float descender;
+            float lineHeight;
+            uint32_t glyphCount;
+            uint32_t charCount;
+            uint32_t kerningCount;
+            uint64_t glyphTable;
+            uint64_t charTable;
+            uint64_t kerningTable;
+        };
+
+        /**
+         * A glyph bitmap and its metrics. <code>page</code> is -1 and the
+         * rect is empty for glyphs with nothing to draw, such as spaces.
+         */
+        struct GlyphRecord {
+            int32_t page;
+            int32_t x, y, width, height;
+            float corner[2];
+            float advance;
+            float lower[2];
+            float upper[2];
+        };
+
+        /**
+         * Maps a character code to a glyph. Sorted by character code.
+         */
+        struct CharRecord {
+            uint32_t charCode;
+            uint32_t glyph;
+        };
+
+        /**
+         * The kerning between two glyphs, sorted by left then right glyph.
+         * Pairs that aren't listed have no kerning.
+         */
+        struct KerningRecord {
+            uint32_t left;
+            uint32_t right;
+            float x;
+            float y;
+        };
+    }
+}
+
+#endif  //  _DIFONT_BAKED_FORMAT_H_
@@ -0,0 +1,387 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "BlockEncoder.h"
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DIFONT_BLOCKS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define DIFONT_BLOCKS_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace difont;
+
+
+/**
+ * The EAC modifier tables, in units of the multiplier.
+ */
+static const int EAC_MODIFIERS[16][8] =
+{
+    { -3, -6,  -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5,  -8, -13, 1, 4, 7, 12 },
+    { -2, -4,  -6, -13, 1, 3, 5, 12 },
+    { -3, -6,  -8, -12, 2, 5, 7, 11 },
+    { -3, -7,  -9, -11, 2, 6, 8, 10 },
+    { -4, -7,  -8, -11, 3, 6, 7, 10 },
+    { -3, -5,  -8, -11, 2, 4, 7, 10 },
+    { -2, -6,  -8, -10, 1, 5, 7,  9 },
+    { -2, -5,  -8, -10, 1, 4, 7,  9 },
+    { -2, -4,  -8, -10, 1, 3, 7,  9 },
+    { -2, -5,  -7, -10, 1, 4, 6,  9 },
+    { -3, -4,  -7, -10, 2, 3, 6,  9 },
+    { -1, -2,  -3, -10, 0, 1, 2,  9 },
+    { -4, -6,  -8,  -9, 3, 5, 7,  8 },
+    { -3, -5,  -7,  -9, 2, 4, 6,  8 }
+};
+
+
+/**
+ * Copy a block's texels, row by row, repeating the edges of the image.
+ */
+static void LoadBlock(const unsigned char* pixels, int width, int height,
+                      int blockX, int blockY, unsigned char texels[16])
+{
+    for(int y = 0; y < 4; ++y)
+    {
+        int row = blockY + y < height ? blockY + y : height - 1;
+        const unsigned char* src = pixels + row * width;
+        for(int x = 0; x < 4; ++x)
+        {
+            int column = blockX + x < width ? blockX + x : width - 1;
+            texels[y * 4 + x] = src[column];
+        }
+    }
+}
+
+
+/**
+ * Find the closest of eight palette entries to each texel.
+ *
+ * @return  The sum of the differences.
+ */
+static int Nearest(const unsigned char texels[16], const unsigned char palette[8],
+                   unsigned char indices[16])
+{
+#if defined(DIFONT_BLOCKS_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(texels));
+    __m128i best = _mm_set1_epi8(-1);
+    __m128i bestIndex = zero;
+
+    for(int i = 0; i < 8; ++i)
+    {
+        __m128i p = _mm_set1_epi8(static_cast<char>(palette[i]));
+        __m128i d = _mm_or_si128(_mm_subs_epu8(t, p), _mm_subs_epu8(p, t));
+        // Nonzero where d < best; ties keep the earlier entry.
+        __m128i closer = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_subs_epu8(best, d), zero),
+                                          _mm_set1_epi8(-1));
+        best = _mm_min_epu8(best, d);
+        bestIndex = _mm_or_si128(_mm_andnot_si128(closer, bestIndex),
+                                 _mm_and_si128(closer, _mm_set1_epi8(static_cast<char>(i))));
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(indices), bestIndex);
+    __m128i sums = _mm_sad_epu8(best, zero);
+    return _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+#elif defined(DIFONT_BLOCKS_NEON)
+    uint8x16_t t = vld1q_u8(texels);
+    uint8x16_t best = vdupq_n_u8(255);
+    uint8x16_t bestIndex = vdupq_n_u8(0);
+
+    for(int i = 0; i < 8; ++i)
+    {
+        uint8x16_t d = vabdq_u8(t, vdupq_n_u8(palette[i]));
+        uint8x16_t closer = vcltq_u8(d, best);
+        best = vminq_u8(best, d);
+        bestIndex = vbslq_u8(closer, vdupq_n_u8(static_cast<uint8_t>(i)), bestIndex);
+    }
+
+    vst1q_u8(indices, bestIndex);
+    uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(best)));
+    return static_cast<int>(vgetq_lane_u64(sums, 0) + vgetq_lane_u64(sums, 1));
+#else
+    int error = 0;
+    for(int k = 0; k < 16; ++k)
+    {
+        int best = 256;
+        for(int i = 0; i < 8; ++i)
+        {
+            int d = texels[k] > palette[i] ? texels[k] - palette[i] : palette[i] - texels[k];
+            if(d < best)
+            {
+                best = d;
+                indices[k] = static_cast<unsigned char>(i);
+            }
+        }
+        error += best;
+    }
+    return error;
+#endif
+}
+
+
+/**
+ * Encode a block as BC4, trying both the eight value palette and the
+ * six value one with exact 0 and 255, which suits antialiased edges.
+ */
+static void EncodeBC4(const unsigned char texels[16], unsigned char block[8])
+{
+    unsigned char low = 255, high = 0;
+    unsigned char innerLow = 255, innerHigh = 0;
+    for(int k = 0; k < 16; ++k)
+    {
+        unsigned char v = texels[k];
+        low = v < low ? v : low;
+        high = v > high ? v : high;
+        if(v != 0 && v != 255)
+        {
+            innerLow = v < innerLow ? v : innerLow;
+            innerHigh = v > innerHigh ? v : innerHigh;
+        }
+    }
+
+    unsigned char indices[16];
+    if(low == high)
+    {
+        block[0] = block[1] = low;
+        memset(block + 2, 0, 6);
+        return;
+    }
+
+    // red0 > red1: red0, red1 and six steps between.
+    unsigned char palette[8];
+    palette[0] = high;
+    palette[1] = low;
+    for(int i = 2; i < 8; ++i)
+    {
+        palette[i] = static_cast<unsigned char>(((8 - i) * high + (i - 1) * low + 3) / 7);
+    }
+    int error = Nearest(texels, palette, indices);
+    block[0] = high;
+    block[1] = low;
+
+    // red0 <= red1: red0, red1, four steps between, 0 and 255.
+    if(innerLow > innerHigh)
+    {
+        innerLow = innerHigh = 0;
+    }
+    unsigned char inner[8];
+    unsigned char innerIndices[16];
+    inner[0] = innerLow;
+    inner[1] = innerHigh;
+    for(int i = 2; i < 6; ++i)
+    {
+        inner[i] = static_cast<unsigned char>(((6 - i) * innerLow + (i - 1) * innerHigh + 2) / 5);
+    }
+    inner[6] = 0;
+    inner[7] = 255;
+    if(Nearest(texels, inner, innerIndices) < error)
+    {
+        block[0] = innerLow;
+        block[1] = innerHigh;
+        memcpy(indices, innerIndices, 16);
+    }
+
+    // Three bits per texel, first texel in the lowest bits.
+    unsigned long long bits = 0;
+    for(int k = 15; k >= 0; --k)
+    {
+        bits = (bits << 3) | indices[k];
+    }
+    for(int i = 0; i < 6; ++i)
+    {
+        block[2 + i] = static_cast<unsigned char>(bits >> (8 * i));
+    }
+}
+
+
+/**
+ * Fill in the 8 bit values an EAC R11 block decodes to.
+ */
+static void EacPalette(int base, int multiplier, int table, unsigned char palette[8])
+{
+    for(int i = 0; i < 8; ++i)
+    {
+        int modifier = EAC_MODIFIERS[table][i];
+        int v = base * 8 + 4 + (multiplier ? modifier * multiplier * 8 : modifier);
+        v = v < 0 ? 0 : (v > 2047 ? 2047 : v);
+
+        // Only the clamped ends are exactly 0 and 255; keep the others off
+        // them so empty and solid texels stay exact.
+        int level = (v * 255 + 1023) / 2047;
+        if(v > 0 && level < 1)
+        {
+            level = 1;
+        }
+        if(v < 2047 && level > 254)
+        {
+            level = 254;
+        }
+        palette[i] = static_cast<unsigned char>(level);
+    }
+}
+
+
+/**
+ * Encode a block as EAC R11, searching the modifier tables with a
+ * multiplier fitted to the block's range. The search stops once every
+ * texel is within one level on average.
+ */
+static void EncodeEAC(const unsigned char texels[16], unsigned char block[8])
+{
+    unsigned char low = 255, high = 0;
+    for(int k = 0; k < 16; ++k)
+    {
+        low = texels[k] < low ? texels[k] : low;
+        high = texels[k] > high ? texels[k] : high;
+    }
+
+    int bestError = 0x7fffffff;
+    int bestBase = 0, bestMultiplier = 0, bestTable = 0;
+    unsigned char indices[16], bestIndices[16];
+    memset(bestIndices, 0, sizeof(bestIndices));
+    unsigned char palette[8];
+
+    const int GOOD_ENOUGH = 16;
+
+    for(int table = 0; table < 16 && bestError > GOOD_ENOUGH; ++table)
+    {
+        const int* modifiers = EAC_MODIFIERS[table];
+        int span = (modifiers[7] - modifiers[3]) * 8;
+
+        // Eleven bit units are about eight to the 8 bit step.
+        int range = (high - low) * 2047 / 255;
+        int multiplier = (range + span / 2) / span;
+
+        for(int m = multiplier; m <= multiplier + 1 && bestError > GOOD_ENOUGH; ++m)
+        {
+            int mult = m < 1 ? 1 : (m > 15 ? 15 : m);
+
+            // Centre the palette on the block. Blocks with empty texels
+            // also try pinning the lowest entry to 0, and need a palette
+            // with an exact 0 so the space around glyphs stays clear.
+            int bases[2];
+            int count = 1;
+            int centre = (low + high) * 2047 / 255 / 2;
+            bases[0] = (centre - 4 - (modifiers[3] + modifiers[7]) * mult * 4) / 8;
+            if(low == 0)
+            {
+                bases[count++] = (-4 - modifiers[3] * mult * 8) / 8;
+            }
+
+            for(int b = 0; b < count && bestError > GOOD_ENOUGH; ++b)
+            {
+                int base = bases[b] < 0 ? 0 : (bases[b] > 255 ? 255 : bases[b]);
+
+                EacPalette(base, mult, table, palette);
+                if(low == 0 && palette[3] != 0)
+                {
+                    continue;
+                }
+
+                int error = Nearest(texels, palette, indices);
+                if(error < bestError)
+                {
+                    bestError = error;
+                    bestBase = base;
+                    bestMultiplier = mult;
+                    bestTable = table;
+                    memcpy(bestIndices, indices, 16);
+                }
+            }
+        }
+    }
+
+    block[0] = static_cast<unsigned char>(bestBase);
+    block[1] = static_cast<unsigned char>((bestMultiplier << 4) | bestTable);
+
+    // Three bits per texel, column by column, first texel in the highest
+    // bits, stored big endian.
+    unsigned long long bits = 0;
+    for(int x = 0; x < 4; ++x)
+    {
+        for(int y = 0; y < 4; ++y)
+        {
+            bits = (bits << 3) | bestIndices[y * 4 + x];
+        }
+    }
+    for(int i = 0; i < 6; ++i)
+    {
+        block[2 + i] = static_cast<unsigned char>(bits >> (40 - 8 * i));
+    }
+}
+
+
+size_t BlockEncoder::EncodedSize(int width, int height)
+{
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 8;
+}
+
+
+void BlockEncoder::Encode(Format format, const unsigned char* pixels,
+                          int width, int height, unsigned char* blocks)
+{
+    // Most of an atlas is the empty space around the glyphs.
+    unsigned char empty[8];
+    unsigned char zeros[16];
+    memset(zeros, 0, sizeof(zeros));
+    if(format == BC4)
+    {
+        EncodeBC4(zeros, empty);
+    }
+    else
+    {
+        EncodeEAC(zeros, empty);
+    }
+
+    unsigned char texels[16];
+    for(int y = 0; y < height; y += 4)
+    {
+        for(int x = 0; x < width; x += 4)
+        {
+            LoadBlock(pixels, width, height, x, y, texels);
+
+            if(!memcmp(texels, zeros, 16))
+            {
+                memcpy(blocks, empty, 8);
+            }
+            else if(format == BC4)
+            {
+                EncodeBC4(texels, blocks);
+            }
+            else
+            {
+                EncodeEAC(texels, blocks);
+            }
+            blocks += 8;
+        }
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_BLOCK_ENCODER_H_
+#define _DIFONT_BLOCK_ENCODER_H_
+
+#include <stddef.h>
+
+namespace difont {
+    /**
+     * BlockEncoder compresses 8 bit single channel images into 4x4
+     * blocks of 8 bytes, as BC4 (RGTC1) or EAC R11, for uploading with
+     * glCompressedTexImage2D. Blocks that run past the right or bottom
+     * edge repeat the last column or row.
+     *
+     * Texels are matched to each block's palette 16 at a time with SSE2 or
+     * NEON where available.
+     */
+    class BlockEncoder {
+    public:
+        enum Format {
+            BC4,
+            EAC_R11
+        };
+
+        /**
+         * Get the size of an encoded image.
+         *
+         * @param width   The width in texels.
+         * @param height  The height in texels.
+         * @return  The size in bytes.
+         */
+        static size_t EncodedSize(int width, int height);
+
+        /**
+         * Encode an image.
+         *
+         * @param format  The block format.
+         * @param pixels  The texels, <code>width</code> bytes per row.
+         * @param width   The width in texels.
+         * @param height  The height in texels.
+         * @param blocks  Receives <code>EncodedSize(width, height)</code>
+         *                bytes of blocks, left to right and top to bottom.
+         */
+        static void Encode(Format format, const unsigned char* pixels,
+                           int width, int height, unsigned char* blocks);
+    };
+}
+
+#endif  //  _DIFONT_BLOCK_ENCODER_H_
@@ -0,0 +1,118 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_COVERAGE_BLIT_H_
+#define _DIFONT_COVERAGE_BLIT_H_
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DIFONT_BLIT_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define DIFONT_BLIT_NEON
+#include <arm_neon.h>
+#endif
+
+namespace difont {
+    /**
+     * Add a row of coverage into a buffer one pixel at a time, saturating
+     * at opaque.
+     *
+     * @param dest   the first pixel of the buffer row
+     * @param src    the first pixel of the glyph row
+     * @param count  the number of pixels
+     */
+    inline void AddCoverageRowScalar(unsigned char* dest, const unsigned char* src,
+                                     int count)
+    {
+        for(int x = 0; x < count; ++x)
+        {
+            int sum = dest[x] + src[x];
+            dest[x] = static_cast<unsigned char>(sum < 255 ? sum : 255);
+        }
+    }
+
+    /**
+     * Add a row of coverage into a buffer, saturating at opaque, so glyphs
+     * that overlap or abut keep both their edges. Sixteen pixels at a time
+     * with SSE2 or NEON where available; the same as
+     * AddCoverageRowScalar() either way.
+     *
+     * @param dest   the first pixel of the buffer row
+     * @param src    the first pixel of the glyph row
+     * @param count  the number of pixels
+     */
+    inline void AddCoverageRow(unsigned char* dest, const unsigned char* src, int count)
+    {
+        int x = 0;
+
+#if defined(DIFONT_BLIT_SSE2)
+        for(; x + 16 <= count; x += 16)
+        {
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + x));
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x), _mm_adds_epu8(d, s));
+        }
+#elif defined(DIFONT_BLIT_NEON)
+        for(; x + 16 <= count; x += 16)
+        {
+            vst1q_u8(dest + x, vqaddq_u8(vld1q_u8(dest + x), vld1q_u8(src + x)));
+        }
+#endif
+
+        AddCoverageRowScalar(dest + x, src + x, count - x);
+    }
+
+    /**
+     * Add a glyph's coverage into a buffer, clipped to the buffer.
+     *
+     * @param dest        the top left pixel of the buffer
+     * @param destWidth   the width of the buffer, and its pitch
+     * @param destHeight  the height of the buffer
+     * @param dx          the buffer column of the glyph's left edge
+     * @param dy          the buffer row of the glyph's top edge
+     * @param src         the top left pixel of the glyph
+     * @param width       the width of the glyph, and its pitch
+     * @param height      the height of the glyph
+     */
+    inline void AddCoverage(unsigned char* dest, int destWidth, int destHeight,
+                            int dx, int dy, const unsigned char* src,
+                            int width, int height)
+    {
+        // Clip the glyph rectangle against the buffer once.
+        int x0 = dx < 0 ? -dx : 0;
+        int y0 = dy < 0 ? -dy : 0;
+        int x1 = width < destWidth - dx ? width : destWidth - dx;
+        int y1 = height < destHeight - dy ? height : destHeight - dy;
+
+        for(int y = y0; y < y1 && x0 < x1; y++)
+        {
+            AddCoverageRow(dest + (dy + y) * destWidth + dx + x0,
+                           src + y * width + x0, x1 - x0);
+        }
+    }
+}
+
+#endif  //  _DIFONT_COVERAGE_BLIT_H_
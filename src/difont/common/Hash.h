@@ -0,0 +1,63 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_HASH_H_
+#define _DIFONT_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace difont {
+    /**
+     * The initial value of a 64 bit FNV-1a hash.
+     */
+    static const uint64_t FNV1A_64_INIT = 0xcbf29ce484222325ULL;
+
+    /**
+     * Fold a block of memory into a 64 bit FNV-1a hash.
+     *
+     * @param bytes   the memory to hash
+     * @param length  the length of the memory in bytes
+     * @param hash    the hash of any preceding data
+     * @return        the updated hash
+     */
+    inline uint64_t Fnv1a64(const void* bytes, size_t length,
+                            uint64_t hash = FNV1A_64_INIT)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(bytes);
+        const unsigned char* end = p + length;
+
+        while(p != end)
+        {
+            hash ^= *p++;
+            hash *= 0x100000001b3ULL;
+        }
+
+        return hash;
+    }
+}
+
+#endif  //  _DIFONT_HASH_H_
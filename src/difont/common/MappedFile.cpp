@@ -0,0 +1,158 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
+
+
+difont::MappedFile::MappedFile()
+:   data(0),
+    length(0)
+#ifdef _WIN32
+    , mapping(0)
+#endif
+{}
+
+
+difont::MappedFile::~MappedFile()
+{
+    Close();
+}
+
+
+#ifdef _WIN32
+
+bool difont::MappedFile::Open(const char* filePath)
+{
+    Close();
+
+    HANDLE file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0
+       || static_cast<unsigned long long>(fileSize.QuadPart) > static_cast<size_t>(-1))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    // The mapping keeps its own reference to the file.
+    HANDLE fileMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if(!fileMapping)
+    {
+        return false;
+    }
+
+    void* view = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+    if(!view)
+    {
+        CloseHandle(fileMapping);
+        return false;
+    }
+
+    mapping = fileMapping;
+    data = static_cast<const unsigned char*>(view);
+    length = static_cast<size_t>(fileSize.QuadPart);
+
+    return true;
+}
+
+
+void difont::MappedFile::Close()
+{
+    if(data)
+    {
+        UnmapViewOfFile(data);
+        CloseHandle(static_cast<HANDLE>(mapping));
+    }
+
+    data = 0;
+    length = 0;
+    mapping = 0;
+}
+
+#else
+
+bool difont::MappedFile::Open(const char* filePath)
+{
+    Close();
+
+    int fd = open(filePath, O_RDONLY);
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    void* view = mmap(0, static_cast<size_t>(fileStat.st_size), PROT_READ,
+                      MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(view == MAP_FAILED)
+    {
+        return false;
+    }
+
+    data = static_cast<const unsigned char*>(view);
+    length = static_cast<size_t>(fileStat.st_size);
+
+    return true;
+}
+
+
+void difont::MappedFile::Close()
+{
+    if(data)
+    {
+        munmap(const_cast<unsigned char*>(data), length);
+    }
+
+    data = 0;
+    length = 0;
+}
+
+#endif
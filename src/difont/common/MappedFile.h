@@ -0,0 +1,105 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_MAPPED_FILE_H_
+#define _DIFONT_MAPPED_FILE_H_
+
+#include <stddef.h>
+
+/**
+ * MappedFile maps a whole file read-only into memory.
+ *
+ * Uses mmap on POSIX systems and a file mapping object on Windows.
+ */
+namespace difont {
+    class MappedFile {
+    public:
+        /**
+         * Default Constructor
+         */
+        MappedFile();
+
+        /**
+         * Destructor
+         *
+         * Unmaps the file if it is open.
+         */
+        virtual ~MappedFile();
+
+        /**
+         * Map a file into memory, closing any file already mapped.
+         *
+         * @param filePath  the file to map.
+         * @return          <code>true</code> if the file was mapped.
+         *                  Empty files can't be mapped.
+         */
+        bool Open(const char* filePath);
+
+        /**
+         * Unmap the file.
+         */
+        void Close();
+
+        /**
+         * Get the contents of the file.
+         *
+         * @return  The first byte of the file or <code>NULL</code> if no
+         *          file is mapped.
+         */
+        const unsigned char* Data() const { return data; }
+
+        /**
+         * Get the length of the file in bytes.
+         */
+        size_t Length() const { return length; }
+
+    private:
+        /**
+         * Disallow copies, the mapping can only be released once.
+         */
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+
+        /**
+         * The mapped contents of the file
+         */
+        const unsigned char* data;
+
+        /**
+         * The length of the file in bytes
+         */
+        size_t length;
+
+#ifdef _WIN32
+        /**
+         * The file mapping object
+         */
+        void* mapping;
+#endif
+    };
+}
+
+#endif  //  _DIFONT_MAPPED_FILE_H_
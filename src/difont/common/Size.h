@@ -124,6 +124,11 @@ namespace difont {
          */
         FT_Error Error() const { return err; }
 
+        /**
+         * Get the FreeType size the char size was set on.
+         */
+        FT_Size FTSize() const { return ftSize; }
+
     private:
         /**
          * The current Freetype face that this Size object relates to.
@@ -0,0 +1,301 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "Thread.h"
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#   include <process.h>
+#endif
+
+
+#ifdef _WIN32
+
+difont::Mutex::Mutex()
+{
+    InitializeSRWLock(reinterpret_cast<PSRWLOCK>(&lock));
+}
+
+
+difont::Mutex::~Mutex()
+{}
+
+
+void difont::Mutex::Lock()
+{
+    AcquireSRWLockExclusive(reinterpret_cast<PSRWLOCK>(&lock));
+}
+
+
+void difont::Mutex::Unlock()
+{
+    ReleaseSRWLockExclusive(reinterpret_cast<PSRWLOCK>(&lock));
+}
+
+
+difont::SharedMutex::SharedMutex()
+{
+    InitializeSRWLock(reinterpret_cast<PSRWLOCK>(&lock));
+}
+
+
+difont::SharedMutex::~SharedMutex()
+{}
+
+
+void difont::SharedMutex::Lock()
+{
+    AcquireSRWLockExclusive(reinterpret_cast<PSRWLOCK>(&lock));
+}
+
+
+void difont::SharedMutex::Unlock()
+{
+    ReleaseSRWLockExclusive(reinterpret_cast<PSRWLOCK>(&lock));
+}
+
+
+void difont::SharedMutex::LockShared()
+{
+    AcquireSRWLockShared(reinterpret_cast<PSRWLOCK>(&lock));
+}
+
+
+void difont::SharedMutex::UnlockShared()
+{
+    ReleaseSRWLockShared(reinterpret_cast<PSRWLOCK>(&lock));
+}
+
+
+difont::Condition::Condition()
+{
+    InitializeConditionVariable(reinterpret_cast<PCONDITION_VARIABLE>(&condition));
+}
+
+
+difont::Condition::~Condition()
+{}
+
+
+void difont::Condition::Wait(Mutex& mutex)
+{
+    SleepConditionVariableSRW(reinterpret_cast<PCONDITION_VARIABLE>(&condition),
+                              reinterpret_cast<PSRWLOCK>(&mutex.lock), INFINITE, 0);
+}
+
+
+void difont::Condition::Signal()
+{
+    WakeConditionVariable(reinterpret_cast<PCONDITION_VARIABLE>(&condition));
+}
+
+
+void difont::Condition::Broadcast()
+{
+    WakeAllConditionVariable(reinterpret_cast<PCONDITION_VARIABLE>(&condition));
+}
+
+
+unsigned __stdcall difont::Thread::Main(void* thread)
+{
+    Thread* self = static_cast<Thread*>(thread);
+    self->function(self->argument);
+    return 0;
+}
+
+
+difont::Thread::Thread()
+:   function(0),
+    argument(0),
+    running(false),
+    handle(0)
+{}
+
+
+bool difont::Thread::Start(Function f, void* arg)
+{
+    Join();
+
+    function = f;
+    argument = arg;
+
+    // The destructor joins the thread, so this object outlives it.
+    handle = reinterpret_cast<void*>(_beginthreadex(NULL, 0, Main, this, 0, NULL));
+    running = handle != 0;
+
+    return running;
+}
+
+
+void difont::Thread::Join()
+{
+    if(running)
+    {
+        WaitForSingleObject(static_cast<HANDLE>(handle), INFINITE);
+        CloseHandle(static_cast<HANDLE>(handle));
+        handle = 0;
+        running = false;
+    }
+}
+
+#else
+
+difont::Mutex::Mutex()
+{
+    pthread_mutex_init(&mutex, NULL);
+}
+
+
+difont::Mutex::~Mutex()
+{
+    pthread_mutex_destroy(&mutex);
+}
+
+
+void difont::Mutex::Lock()
+{
+    pthread_mutex_lock(&mutex);
+}
+
+
+void difont::Mutex::Unlock()
+{
+    pthread_mutex_unlock(&mutex);
+}
+
+
+difont::SharedMutex::SharedMutex()
+{
+    pthread_rwlock_init(&lock, NULL);
+}
+
+
+difont::SharedMutex::~SharedMutex()
+{
+    pthread_rwlock_destroy(&lock);
+}
+
+
+void difont::SharedMutex::Lock()
+{
+    pthread_rwlock_wrlock(&lock);
+}
+
+
+void difont::SharedMutex::Unlock()
+{
+    pthread_rwlock_unlock(&lock);
+}
+
+
+void difont::SharedMutex::LockShared()
+{
+    pthread_rwlock_rdlock(&lock);
+}
+
+
+void difont::SharedMutex::UnlockShared()
+{
+    pthread_rwlock_unlock(&lock);
+}
+
+
+difont::Condition::Condition()
+{
+    pthread_cond_init(&condition, NULL);
+}
+
+
+difont::Condition::~Condition()
+{
+    pthread_cond_destroy(&condition);
+}
+
+
+void difont::Condition::Wait(Mutex& mutex)
+{
+    pthread_cond_wait(&condition, &mutex.mutex);
+}
+
+
+void difont::Condition::Signal()
+{
+    pthread_cond_signal(&condition);
+}
+
+
+void difont::Condition::Broadcast()
+{
+    pthread_cond_broadcast(&condition);
+}
+
+
+void* difont::Thread::Main(void* thread)
+{
+    Thread* self = static_cast<Thread*>(thread);
+    self->function(self->argument);
+    return NULL;
+}
+
+
+difont::Thread::Thread()
+:   function(0),
+    argument(0),
+    running(false)
+{}
+
+
+bool difont::Thread::Start(Function f, void* arg)
+{
+    Join();
+
+    function = f;
+    argument = arg;
+
+    // The destructor joins the thread, so this object outlives it.
+    running = pthread_create(&thread, NULL, Main, this) == 0;
+
+    return running;
+}
+
+
+void difont::Thread::Join()
+{
+    if(running)
+    {
+        pthread_join(thread, NULL);
+        running = false;
+    }
+}
+
+#endif
+
+
+difont::Thread::~Thread()
+{
+    Join();
+}
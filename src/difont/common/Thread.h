@@ -0,0 +1,232 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_THREAD_H_
+#define _DIFONT_THREAD_H_
+
+#ifndef _WIN32
+#   include <pthread.h>
+#endif
+
+/**
+ * Minimal threads and locks for the parts of difont that do work off the
+ * render thread.
+ *
+ * Uses pthreads on POSIX systems and slim reader/writer locks and condition
+ * variables on Windows.
+ */
+namespace difont {
+    class Mutex {
+    public:
+        Mutex();
+        ~Mutex();
+
+        void Lock();
+        void Unlock();
+
+    private:
+        friend class Condition;
+
+        Mutex(const Mutex&);
+        Mutex& operator=(const Mutex&);
+
+#ifdef _WIN32
+        /**
+         * An SRWLOCK, which is the size of a pointer
+         */
+        void* lock;
+#else
+        pthread_mutex_t mutex;
+#endif
+    };
+
+
+    /**
+     * Locks a mutex for the lifetime of the object.
+     */
+    class MutexLock {
+    public:
+        explicit MutexLock(Mutex& m) : mutex(m) { mutex.Lock(); }
+        ~MutexLock() { mutex.Unlock(); }
+
+    private:
+        MutexLock(const MutexLock&);
+        MutexLock& operator=(const MutexLock&);
+
+        Mutex& mutex;
+    };
+
+
+    /**
+     * A lock many threads can hold at once to read, or one to write.
+     */
+    class SharedMutex {
+    public:
+        SharedMutex();
+        ~SharedMutex();
+
+        void Lock();
+        void Unlock();
+
+        void LockShared();
+        void UnlockShared();
+
+    private:
+        SharedMutex(const SharedMutex&);
+        SharedMutex& operator=(const SharedMutex&);
+
+#ifdef _WIN32
+        /**
+         * An SRWLOCK, which is the size of a pointer
+         */
+        void* lock;
+#else
+        pthread_rwlock_t lock;
+#endif
+    };
+
+
+    /**
+     * Locks a shared mutex for the lifetime of the object, exclusively or
+     * shared. Does nothing for a <code>NULL</code> mutex, so locking can
+     * be optional.
+     */
+    class SharedMutexLock {
+    public:
+        explicit SharedMutexLock(SharedMutex* m, bool s = false)
+        :   mutex(m),
+            shared(s)
+        {
+            if(mutex)
+            {
+                shared ? mutex->LockShared() : mutex->Lock();
+            }
+        }
+
+        ~SharedMutexLock()
+        {
+            if(mutex)
+            {
+                shared ? mutex->UnlockShared() : mutex->Unlock();
+            }
+        }
+
+    private:
+        SharedMutexLock(const SharedMutexLock&);
+        SharedMutexLock& operator=(const SharedMutexLock&);
+
+        SharedMutex* mutex;
+        bool shared;
+    };
+
+
+    class Condition {
+    public:
+        Condition();
+        ~Condition();
+
+        /**
+         * Unlock <code>mutex</code>, wait to be signalled and lock it
+         * again. May return without being signalled.
+         */
+        void Wait(Mutex& mutex);
+
+        /**
+         * Wake one waiting thread.
+         */
+        void Signal();
+
+        /**
+         * Wake every waiting thread.
+         */
+        void Broadcast();
+
+    private:
+        Condition(const Condition&);
+        Condition& operator=(const Condition&);
+
+#ifdef _WIN32
+        /**
+         * A CONDITION_VARIABLE, which is the size of a pointer
+         */
+        void* condition;
+#else
+        pthread_cond_t condition;
+#endif
+    };
+
+
+    class Thread {
+    public:
+        typedef void (*Function)(void* argument);
+
+        Thread();
+
+        /**
+         * Destructor
+         *
+         * Waits for the thread to finish if it was started.
+         */
+        ~Thread();
+
+        /**
+         * Run <code>function(argument)</code> on a new thread.
+         *
+         * @return  <code>true</code> if the thread was started.
+         */
+        bool Start(Function function, void* argument);
+
+        /**
+         * Wait for the thread to finish.
+         */
+        void Join();
+
+    private:
+        Thread(const Thread&);
+        Thread& operator=(const Thread&);
+
+        /**
+         * The entry point of the new thread, which calls the function.
+         */
+#ifdef _WIN32
+        static unsigned __stdcall Main(void* thread);
+#else
+        static void* Main(void* thread);
+#endif
+
+        Function function;
+        void* argument;
+        bool running;
+
+#ifdef _WIN32
+        void* handle;
+#else
+        pthread_t thread;
+#endif
+    };
+}
+
+#endif  //  _DIFONT_THREAD_H_
@@ -53,6 +53,8 @@ namespace difont {
 #include "PixmapFont.h"
 #include "PolygonFont.h"
 #include "TextureFont.h"
+#include "BakedFont.h"
+#include "FontCollection.h"
 
 #include "Layout.h"
 #include "SimpleLayout.h"
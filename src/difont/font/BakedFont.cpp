@@ -0,0 +1,652 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <math.h>
+#include <string.h>
+
+#include  <difont/difont.h>
+
+#include "Internals.h"
+#include "Unicode.h"
+#include "BakedFontImpl.h"
+
+
+//
+//  difont::BakedFont
+//
+
+
+difont::BakedFont::BakedFont(const char* bakedFilePath) :
+    impl(new difont::BakedFontImpl(bakedFilePath))
+{}
+
+
+difont::BakedFont::BakedFont(const unsigned char *pBufferBytes,
+                             size_t bufferSizeInBytes) :
+    impl(new difont::BakedFontImpl(pBufferBytes, bufferSizeInBytes))
+{}
+
+
+difont::BakedFont::~BakedFont()
+{
+    delete impl;
+}
+
+
+bool difont::BakedFont::FaceSize(const unsigned int size, const unsigned int res)
+{
+    return impl->FaceSize(size, res);
+}
+
+
+unsigned int difont::BakedFont::FaceSize() const
+{
+    return impl->FaceSize();
+}
+
+
+float difont::BakedFont::Ascender() const
+{
+    return impl->Ascender();
+}
+
+
+float difont::BakedFont::Descender() const
+{
+    return impl->Descender();
+}
+
+
+float difont::BakedFont::LineHeight() const
+{
+    return impl->LineHeight();
+}
+
+
+difont::BBox difont::BakedFont::BBox(const char *string, const int len,
+                                     difont::Point position, difont::Point spacing)
+{
+    return impl->BBox(string, len, position, spacing);
+}
+
+
+difont::BBox difont::BakedFont::BBox(const wchar_t *string, const int len,
+                                     difont::Point position, difont::Point spacing)
+{
+    return impl->BBox(string, len, position, spacing);
+}
+
+
+float difont::BakedFont::Advance(const char* string, const int len, difont::Point spacing)
+{
+    return impl->Advance(string, len, spacing);
+}
+
+
+float difont::BakedFont::Advance(const wchar_t* string, const int len, difont::Point spacing)
+{
+    return impl->Advance(string, len, spacing);
+}
+
+
+difont::Point difont::BakedFont::Render(const char * string, const int len,
+                                        difont::Point position, difont::Point spacing,
+                                        int renderMode)
+{
+    return impl->Render(string, len, position, spacing, renderMode);
+}
+
+
+difont::Point difont::BakedFont::Render(const wchar_t * string, const int len,
+                                        difont::Point position, difont::Point spacing,
+                                        int renderMode)
+{
+    return impl->Render(string, len, position, spacing, renderMode);
+}
+
+
+FT_Error difont::BakedFont::Error() const
+{
+    return impl->err;
+}
+
+
+//
+//  difont::BakedFontImpl
+//
+
+
+difont::BakedFontImpl::BakedFontImpl(const char* bakedFilePath)
+:   err(0),
+    data(0),
+    length(0),
+    header(0),
+    pages(0),
+    sizes(0),
+    size(0),
+    glyphs(0),
+    chars(0),
+    kerning(0)
+{
+    if(!file.Open(bakedFilePath))
+    {
+        err = FT_Err_Cannot_Open_Resource;
+        return;
+    }
+
+    data = file.Data();
+    length = file.Length();
+
+    if(!Validate())
+    {
+        file.Close();
+    }
+}
+
+
+difont::BakedFontImpl::BakedFontImpl(const unsigned char *pBufferBytes,
+                                     size_t bufferSizeInBytes)
+:   err(0),
+    data(pBufferBytes),
+    length(bufferSizeInBytes),
+    header(0),
+    pages(0),
+    sizes(0),
+    size(0),
+    glyphs(0),
+    chars(0),
+    kerning(0)
+{
+    Validate();
+}
+
+
+difont::BakedFontImpl::~BakedFontImpl()
+{
+    if(textureIDList.size())
+    {
+        glDeleteTextures((GLsizei)textureIDList.size(),
+                         (const GLuint*)&textureIDList[0]);
+    }
+}
+
+
+/**
+ * Check that <code>count</code> records of type T at <code>offset</code>
+ * are aligned and lie within a buffer of <code>length</code> bytes.
+ */
+template <typename T>
+static inline bool TableFits(uint64_t offset, uint64_t count, size_t length)
+{
+    return offset % 8 == 0 && offset <= length
+        && count <= (length - offset) / sizeof(T);
+}
+
+
+bool difont::BakedFontImpl::Validate()
+{
+    if(!data || length < sizeof(baked::FileHeader)
+       || reinterpret_cast<uintptr_t>(data) % 8 != 0)
+    {
+        err = FT_Err_Invalid_Argument;
+        return false;
+    }
+
+    const baked::FileHeader *h = reinterpret_cast<const baked::FileHeader*>(data);
+    if(memcmp(h->magic, baked::MAGIC, sizeof(baked::MAGIC)) != 0
+       || h->byteOrder != baked::ENDIAN_TAG)
+    {
+        err = FT_Err_Unknown_File_Format;
+        return false;
+    }
+
+    if(h->version != baked::VERSION
+       || h->headerSize != sizeof(baked::FileHeader)
+       || h->fileLength != length
+       || !TableFits<baked::PageRecord>(h->pageTable, h->pageCount, length)
+       || !TableFits<baked::SizeRecord>(h->sizeTable, h->sizeCount, length))
+    {
+        err = FT_Err_Invalid_File_Format;
+        return false;
+    }
+
+    const baked::PageRecord *p = reinterpret_cast<const baked::PageRecord*>(data + h->pageTable);
+    for(uint32_t i = 0; i < h->pageCount; ++i)
+    {
+        if(!p[i].width || !p[i].height || p[i].width > 16384 || p[i].height > 16384
+           || p[i].pixels > length
+           || static_cast<uint64_t>(p[i].width) * p[i].height > length - p[i].pixels)
+        {
+            err = FT_Err_Invalid_File_Format;
+            return false;
+        }
+    }
+
+    const baked::SizeRecord *s = reinterpret_cast<const baked::SizeRecord*>(data + h->sizeTable);
+    for(uint32_t i = 0; i < h->sizeCount; ++i)
+    {
+        if(!s[i].glyphCount
+           || !TableFits<baked::GlyphRecord>(s[i].glyphTable, s[i].glyphCount, length)
+           || !TableFits<baked::CharRecord>(s[i].charTable, s[i].charCount, length)
+           || !TableFits<baked::KerningRecord>(s[i].kerningTable, s[i].kerningCount, length))
+        {
+            err = FT_Err_Invalid_File_Format;
+            return false;
+        }
+
+        const baked::GlyphRecord *g = reinterpret_cast<const baked::GlyphRecord*>(data + s[i].glyphTable);
+        for(uint32_t j = 0; j < s[i].glyphCount; ++j)
+        {
+            if(g[j].width < 0 || g[j].height < 0
+               || g[j].page < -1 || g[j].page >= static_cast<int32_t>(h->pageCount))
+            {
+                err = FT_Err_Invalid_File_Format;
+                return false;
+            }
+
+            // Compared as width > page width - x, since x + width could
+            // overflow. Pages are at most 16384 wide, so this can't.
+            if(g[j].width && g[j].height
+               && (g[j].page < 0 || g[j].x < 0 || g[j].y < 0
+                   || g[j].width > static_cast<int32_t>(p[g[j].page].width) - g[j].x
+                   || g[j].height > static_cast<int32_t>(p[g[j].page].height) - g[j].y))
+            {
+                err = FT_Err_Invalid_File_Format;
+                return false;
+            }
+        }
+
+        const baked::CharRecord *c = reinterpret_cast<const baked::CharRecord*>(data + s[i].charTable);
+        for(uint32_t j = 0; j < s[i].charCount; ++j)
+        {
+            // FindGlyph() searches the table, so it must be in order.
+            if(c[j].glyph >= s[i].glyphCount
+               || (j && c[j].charCode <= c[j - 1].charCode))
+            {
+                err = FT_Err_Invalid_File_Format;
+                return false;
+            }
+        }
+
+        const baked::KerningRecord *k = reinterpret_cast<const baked::KerningRecord*>(data + s[i].kerningTable);
+        for(uint32_t j = 0; j < s[i].kerningCount; ++j)
+        {
+            // As is KernAdvance().
+            if(k[j].left >= s[i].glyphCount || k[j].right >= s[i].glyphCount
+               || (j && (k[j].left < k[j - 1].left
+                         || (k[j].left == k[j - 1].left && k[j].right <= k[j - 1].right))))
+            {
+                err = FT_Err_Invalid_File_Format;
+                return false;
+            }
+        }
+    }
+
+    header = h;
+    pages = p;
+    sizes = s;
+
+    return true;
+}
+
+
+bool difont::BakedFontImpl::FaceSize(const unsigned int pointSize, const unsigned int res)
+{
+    if(!header)
+    {
+        return false;
+    }
+
+    for(uint32_t i = 0; i < header->sizeCount; ++i)
+    {
+        if(sizes[i].size == pointSize && sizes[i].resolution == res)
+        {
+            size = &sizes[i];
+            glyphs = reinterpret_cast<const baked::GlyphRecord*>(data + size->glyphTable);
+            chars = reinterpret_cast<const baked::CharRecord*>(data + size->charTable);
+            kerning = reinterpret_cast<const baked::KerningRecord*>(data + size->kerningTable);
+
+            for(unsigned int c = 0; c < 128; ++c)
+            {
+                asciiGlyphs[c] = FindGlyph(c);
+            }
+
+            err = 0;
+            return true;
+        }
+    }
+
+    err = FT_Err_Invalid_Pixel_Size;
+    return false;
+}
+
+
+unsigned int difont::BakedFontImpl::FaceSize() const
+{
+    return size ? size->size : 0;
+}
+
+
+float difont::BakedFontImpl::Ascender() const
+{
+    return size ? size->ascender : 0.0f;
+}
+
+
+float difont::BakedFontImpl::Descender() const
+{
+    return size ? size->descender : 0.0f;
+}
+
+
+float difont::BakedFontImpl::LineHeight() const
+{
+    return size ? size->lineHeight : 0.0f;
+}
+
+
+unsigned int difont::BakedFontImpl::FindGlyph(unsigned int charCode) const
+{
+    const baked::CharRecord *first = chars;
+    const baked::CharRecord *end = chars + size->charCount;
+    uint32_t count = size->charCount;
+
+    while(count > 0)
+    {
+        uint32_t half = count / 2;
+        if(first[half].charCode < charCode)
+        {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else
+        {
+            count = half;
+        }
+    }
+
+    return (first != end && first->charCode == charCode) ? first->glyph : 0;
+}
+
+
+difont::Point difont::BakedFontImpl::KernAdvance(unsigned int left, unsigned int right) const
+{
+    const baked::KerningRecord *first = kerning;
+    const baked::KerningRecord *end = kerning + size->kerningCount;
+    uint32_t count = size->kerningCount;
+
+    while(count > 0)
+    {
+        uint32_t half = count / 2;
+        if(first[half].left < left
+           || (first[half].left == left && first[half].right < right))
+        {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else
+        {
+            count = half;
+        }
+    }
+
+    if(first != end && first->left == left && first->right == right)
+    {
+        return difont::Point(first->x, first->y);
+    }
+
+    return difont::Point(0.0f, 0.0f);
+}
+
+
+void difont::BakedFontImpl::CreateTextures()
+{
+    textureIDList.resize(header->pageCount);
+    glGenTextures((GLsizei)textureIDList.size(), (GLuint*)&textureIDList[0]);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for(uint32_t i = 0; i < header->pageCount; ++i)
+    {
+        difont::gl::BindTexture(textureIDList[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, pages[i].width, pages[i].height,
+                     0, GL_ALPHA, GL_UNSIGNED_BYTE, data + pages[i].pixels);
+    }
+}
+
+
+void difont::BakedFontImpl::RenderGlyph(const baked::GlyphRecord& glyph,
+                                        const difont::Point& pen)
+{
+    if(glyph.width == 0 || glyph.height == 0)
+    {
+        return;
+    }
+
+    const baked::PageRecord& page = pages[glyph.page];
+
+    //      0
+    //      +----+
+    //      |    |
+    //      |    |
+    //      |    |
+    //      +----+
+    //           1
+    float u0 = static_cast<float>(glyph.x) / static_cast<float>(page.width);
+    float v0 = static_cast<float>(glyph.y) / static_cast<float>(page.height);
+    float u1 = static_cast<float>(glyph.x + glyph.width) / static_cast<float>(page.width);
+    float v1 = static_cast<float>(glyph.y + glyph.height) / static_cast<float>(page.height);
+
+    float dx = floor(pen.Xf() + glyph.corner[0]);
+    float dy = floor(pen.Yf() + glyph.corner[1]);
+    float destWidth = static_cast<float>(glyph.width);
+    float destHeight = static_cast<float>(glyph.height);
+
+    difont::FontVertex p1, p2, p3, p4;
+
+    p1.SetTexCoord2f(u0, v0);
+    p1.SetVertex2f(dx, dy);
+
+    p2.SetTexCoord2f(u0, v1);
+    p2.SetVertex2f(dx, dy - destHeight);
+
+    p3.SetTexCoord2f(u1, v1);
+    p3.SetVertex2f(dx + destWidth, dy - destHeight);
+
+    p4.SetTexCoord2f(u1, v0);
+    p4.SetVertex2f(dx + destWidth, dy);
+
+    difont::FontMeshSet::AddQuad(textureIDList[glyph.page], p1, p2, p3, p4);
+}
+
+
+template <typename T>
+inline difont::BBox difont::BakedFontImpl::BBoxI(const T* string, const int len,
+                                                 difont::Point position, difont::Point spacing)
+{
+    difont::BBox totalBBox;
+
+    /* Only compute the bounds if string is non-empty. */
+    if(size && string && ('\0' != string[0]))
+    {
+        // for multibyte - we can't rely on sizeof(T) == character
+        FTUnicodeStringItr<T> ustr(string);
+
+        for(int i = 0; (len < 0 && *ustr) || (len >= 0 && i < len); i++)
+        {
+            unsigned int thisGlyph = GlyphIndex(*ustr++);
+            unsigned int nextChar = *ustr;
+
+            if(i)
+            {
+                position += spacing;
+            }
+
+            const baked::GlyphRecord& glyph = glyphs[thisGlyph];
+            difont::BBox glyphBBox(glyph.lower[0], glyph.lower[1], 0.0f,
+                                   glyph.upper[0], glyph.upper[1], 0.0f);
+            glyphBBox += position;
+
+            if(i)
+            {
+                totalBBox |= glyphBBox;
+            }
+            else
+            {
+                totalBBox = glyphBBox;
+            }
+
+            float advance = glyph.advance;
+            if(nextChar)
+            {
+                advance += KernAdvance(thisGlyph, GlyphIndex(nextChar)).Xf();
+            }
+
+            position += difont::Point(advance, 0.0);
+        }
+    }
+
+    return totalBBox;
+}
+
+
+difont::BBox difont::BakedFontImpl::BBox(const char *string, const int len,
+                                         difont::Point position, difont::Point spacing)
+{
+    /* The chars need to be unsigned because they are cast to int later */
+    return BBoxI((const unsigned char *)string, len, position, spacing);
+}
+
+
+difont::BBox difont::BakedFontImpl::BBox(const wchar_t *string, const int len,
+                                         difont::Point position, difont::Point spacing)
+{
+    return BBoxI(string, len, position, spacing);
+}
+
+
+template <typename T>
+inline float difont::BakedFontImpl::AdvanceI(const T* string, const int len,
+                                             difont::Point spacing)
+{
+    float advance = 0.0f;
+    if(!size)
+    {
+        return advance;
+    }
+
+    FTUnicodeStringItr<T> ustr(string);
+
+    for(int i = 0; (len < 0 && *ustr) || (len >= 0 && i < len); i++)
+    {
+        unsigned int thisGlyph = GlyphIndex(*ustr++);
+        unsigned int nextChar = *ustr;
+
+        advance += glyphs[thisGlyph].advance;
+
+        if(nextChar)
+        {
+            advance += KernAdvance(thisGlyph, GlyphIndex(nextChar)).Xf();
+            advance += spacing.Xf();
+        }
+    }
+
+    return advance;
+}
+
+
+float difont::BakedFontImpl::Advance(const char* string, const int len,
+                                     difont::Point spacing)
+{
+    /* The chars need to be unsigned because they are cast to int later */
+    return AdvanceI((const unsigned char *)string, len, spacing);
+}
+
+
+float difont::BakedFontImpl::Advance(const wchar_t* string, const int len,
+                                     difont::Point spacing)
+{
+    return AdvanceI(string, len, spacing);
+}
+
+
+template <typename T>
+inline difont::Point difont::BakedFontImpl::RenderI(const T* string, const int len,
+                                                    difont::Point position, difont::Point spacing,
+                                                    int renderMode)
+{
+    if(!size)
+    {
+        return position;
+    }
+
+    if(textureIDList.empty() && header->pageCount)
+    {
+        CreateTextures();
+    }
+
+    // for multibyte - we can't rely on sizeof(T) == character
+    FTUnicodeStringItr<T> ustr(string);
+
+    for(int i = 0; (len < 0 && *ustr) || (len >= 0 && i < len); i++)
+    {
+        unsigned int thisGlyph = GlyphIndex(*ustr++);
+        unsigned int nextChar = *ustr;
+
+        const baked::GlyphRecord& glyph = glyphs[thisGlyph];
+        RenderGlyph(glyph, position);
+
+        position += difont::Point(glyph.advance, 0.0f);
+
+        if(nextChar)
+        {
+            position += KernAdvance(thisGlyph, GlyphIndex(nextChar));
+            position += spacing;
+        }
+    }
+
+    return position;
+}
+
+
+difont::Point difont::BakedFontImpl::Render(const char * string, const int len,
+                                            difont::Point position, difont::Point spacing,
+                                            int renderMode)
+{
+    /* The chars need to be unsigned because they are cast to int later */
+    return RenderI((const unsigned char *)string, len, position, spacing, renderMode);
+}
+
+
+difont::Point difont::BakedFontImpl::Render(const wchar_t * string, const int len,
+                                            difont::Point position, difont::Point spacing,
+                                            int renderMode)
+{
+    return RenderI(string, len, position, spacing, renderMode);
+}
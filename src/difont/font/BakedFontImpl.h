@@ -0,0 +1,171 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_BAKED_FONT_IMPL_H_
+#define _DIFONT_BAKED_FONT_IMPL_H_
+
+#include <difont/difont.h>
+
+#include "BakedFormat.h"
+#include "MappedFile.h"
+
+#include <vector>
+
+namespace difont {
+    class BakedFontImpl {
+        friend class BakedFont;
+
+    protected:
+        BakedFontImpl(const char* bakedFilePath);
+
+        BakedFontImpl(const unsigned char *pBufferBytes,
+                      size_t bufferSizeInBytes);
+
+        virtual ~BakedFontImpl();
+
+        bool FaceSize(const unsigned int size, const unsigned int res);
+
+        unsigned int FaceSize() const;
+
+        float Ascender() const;
+
+        float Descender() const;
+
+        float LineHeight() const;
+
+        difont::BBox BBox(const char *s, const int len, difont::Point, difont::Point);
+
+        difont::BBox BBox(const wchar_t *s, const int len, difont::Point, difont::Point);
+
+        float Advance(const char *s, const int len, difont::Point);
+
+        float Advance(const wchar_t *s, const int len, difont::Point);
+
+        difont::Point Render(const char *s, const int len,
+                             difont::Point, difont::Point, int);
+
+        difont::Point Render(const wchar_t *s, const int len,
+                             difont::Point, difont::Point, int);
+
+        /**
+         * Current error code. Zero means no error.
+         */
+        FT_Error err;
+
+    private:
+        /**
+         * Check the header and that every table and record lies within
+         * the data, and point the tables at it.
+         *
+         * @return  <code>true</code> if the data is a usable baked font.
+         */
+        bool Validate();
+
+        /**
+         * Create the textures from the page pixels.
+         */
+        void CreateTextures();
+
+        /**
+         * Find the glyph for a character in the current size.
+         *
+         * @return  The glyph's index, or 0 (the missing glyph) if the
+         *          character wasn't baked.
+         */
+        inline unsigned int GlyphIndex(unsigned int charCode) const
+        {
+            return charCode < 128 ? asciiGlyphs[charCode] : FindGlyph(charCode);
+        }
+
+        /**
+         * Search the character map of the current size.
+         */
+        unsigned int FindGlyph(unsigned int charCode) const;
+
+        /**
+         * Get the kerning between two glyphs in the current size.
+         */
+        difont::Point KernAdvance(unsigned int left, unsigned int right) const;
+
+        /**
+         * Emit a textured quad for a glyph at the pen position.
+         */
+        void RenderGlyph(const baked::GlyphRecord& glyph, const difont::Point& pen);
+
+        /**
+         * The mapped file, if the font was read from a file
+         */
+        difont::MappedFile file;
+
+        /**
+         * The baked data, from the file or the client's buffer
+         */
+        const unsigned char *data;
+        size_t length;
+
+        /**
+         * The tables within the data
+         */
+        const baked::FileHeader *header;
+        const baked::PageRecord *pages;
+        const baked::SizeRecord *sizes;
+
+        /**
+         * The selected size and its tables, or <code>NULL</code>
+         */
+        const baked::SizeRecord *size;
+        const baked::GlyphRecord *glyphs;
+        const baked::CharRecord *chars;
+        const baked::KerningRecord *kerning;
+
+        /**
+         * Glyph indices for the first 128 character codes of the
+         * selected size, to skip the binary search for ASCII.
+         */
+        unsigned int asciiGlyphs[128];
+
+        /**
+         * A texture for each page, created by the first Render()
+         */
+        std::vector<GLuint> textureIDList;
+
+        /* Internal generic BBox() implementation */
+        template <typename T>
+        inline difont::BBox BBoxI(const T *s, const int len,
+                                  difont::Point position, difont::Point spacing);
+
+        /* Internal generic Advance() implementation */
+        template <typename T>
+        inline float AdvanceI(const T *s, const int len, difont::Point spacing);
+
+        /* Internal generic Render() implementation */
+        template <typename T>
+        inline difont::Point RenderI(const T *s, const int len,
+                                     difont::Point position, difont::Point spacing, int mode);
+    };
+}
+
+#endif  //  _DIFONT_BAKED_FONT_IMPL_H_
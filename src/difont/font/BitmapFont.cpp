@@ -27,7 +27,9 @@
 #include  <difont/difont.h>
 
 #include "Internals.h"
+#include "FrameBudget.h"
 #include "BitmapFontImpl.h"
+#include "BitmapGlyphImpl.h"
 
 
 //
@@ -48,7 +50,11 @@ BitmapFont::BitmapFont(unsigned char const *pBufferBytes,
 
 
 BitmapFont::~BitmapFont()
-{}
+{
+    // Before the vtable is unwound: BeginFrame() may be making one of
+    // this font's glyphs on another thread.
+    difont::FrameBudget::ForgetFont(impl);
+}
 
 
 Glyph* BitmapFont::MakeGlyph(FT_GlyphSlot ftGlyph)
@@ -78,8 +84,8 @@ inline difont::Point BitmapFontImpl::RenderI(const T* string, const int len,
 
     glDisable(GL_BLEND);
 
-    difont::Point tmp = FontImpl::Render(string, len,
-                                     position, spacing, renderMode);
+    difont::Point tmp = RenderGlyphs<T, BitmapGlyphImpl>(string, len,
+                                                       position, spacing, renderMode);
 
    // glPopClientAttrib();
     //glPopAttrib();
@@ -103,3 +109,10 @@ difont::Point BitmapFontImpl::Render(const wchar_t * string, const int len,
     return RenderI(string, len, position, spacing, renderMode);
 }
 
+
+difont::Point BitmapFontImpl::RenderRun(const Font::GlyphRun& run,
+                                        difont::Point position, int renderMode)
+{
+    return RenderI(&run, run.count, position, difont::Point(), renderMode);
+}
+
@@ -38,11 +38,17 @@ namespace difont {
 
     protected:
         BitmapFontImpl(Font *ftFont, const char* fontFilePath) :
-        FontImpl(ftFont, fontFilePath) {};
+        FontImpl(ftFont, fontFilePath)
+        {
+            nativeGlyph = &typeid(BitmapGlyph);
+        }
 
         BitmapFontImpl(Font *ftFont, const unsigned char *pBufferBytes,
                          size_t bufferSizeInBytes) :
-        FontImpl(ftFont, pBufferBytes, bufferSizeInBytes) {};
+        FontImpl(ftFont, pBufferBytes, bufferSizeInBytes)
+        {
+            nativeGlyph = &typeid(BitmapGlyph);
+        }
 
         virtual difont::Point Render(const char *s, const int len,
                                      difont::Point position, difont::Point spacing,
@@ -52,6 +58,9 @@ namespace difont {
                                      difont::Point position, difont::Point spacing,
                                      int renderMode);
 
+        virtual difont::Point RenderRun(const Font::GlyphRun& run,
+                                        difont::Point position, int renderMode);
+
     private:
         /* Internal generic Render() implementation */
         template <typename T>
@@ -23,12 +23,16 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <wchar.h>
 
 #include  <difont/difont.h>
 
 #include "Internals.h"
+#include "FrameBudget.h"
+#include "Hash.h"
 #include "BufferFontImpl.h"
+#include "BufferGlyphImpl.h"
 
 
 //
@@ -49,7 +53,11 @@ Font(new BufferFontImpl(this, pBufferBytes, bufferSizeInBytes))
 
 
 BufferFont::~BufferFont()
-{}
+{
+    // Before the vtable is unwound: BeginFrame() may be making one of
+    // this font's glyphs on another thread.
+    difont::FrameBudget::ForgetFont(impl);
+}
 
 
 Glyph* BufferFont::MakeGlyph(FT_GlyphSlot ftGlyph)
@@ -71,23 +79,11 @@ Glyph* BufferFont::MakeGlyph(FT_GlyphSlot ftGlyph)
 
 BufferFontImpl::BufferFontImpl(Font *ftFont, const char* fontFilePath) :
 FontImpl(ftFont, fontFilePath),
-buffer(new Buffer())
+buffer(new Buffer()),
+resolution(0)
 {
     load_flags = FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP;
-
-    glGenTextures(BUFFER_CACHE_SIZE, idCache);
-
-    for(int i = 0; i < BUFFER_CACHE_SIZE; i++)
-    {
-        stringCache[i] = NULL;
-        difont::gl::BindTexture(idCache[i]);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); //GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); //GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    }
-
-    lastString = 0;
+    nativeGlyph = &typeid(BufferGlyph);
 }
 
 
@@ -95,36 +91,19 @@ BufferFontImpl::BufferFontImpl(Font *ftFont,
                                    const unsigned char *pBufferBytes,
                                    size_t bufferSizeInBytes) :
 FontImpl(ftFont, pBufferBytes, bufferSizeInBytes),
-buffer(new Buffer())
+buffer(new Buffer()),
+resolution(0)
 {
     load_flags = FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP;
-
-    glGenTextures(BUFFER_CACHE_SIZE, idCache);
-
-    for(int i = 0; i < BUFFER_CACHE_SIZE; i++)
-    {
-        stringCache[i] = NULL;
-        difont::gl::BindTexture(idCache[i]);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);  //GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE); //GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    }
-
-    lastString = 0;
+    nativeGlyph = &typeid(BufferGlyph);
 }
 
 
 BufferFontImpl::~BufferFontImpl()
 {
-    glDeleteTextures(BUFFER_CACHE_SIZE, idCache);
-
-    for(int i = 0; i < BUFFER_CACHE_SIZE; i++)
+    for(size_t i = 0; i < pages.size(); i++)
     {
-        if(stringCache[i])
-        {
-            free(stringCache[i]);
-        }
+        glDeleteTextures(1, &pages[i].textureID);
     }
 
     delete buffer;
@@ -140,15 +119,8 @@ Glyph* BufferFontImpl::MakeGlyphImpl(FT_GlyphSlot ftGlyph)
 bool BufferFontImpl::FaceSize(const unsigned int size,
                                 const unsigned int res)
 {
-    for(int i = 0; i < BUFFER_CACHE_SIZE; i++)
-    {
-        if(stringCache[i])
-        {
-            free(stringCache[i]);
-            stringCache[i] = NULL;
-        }
-    }
-
+    // Cached strings stay put; the size is part of their key.
+    resolution = res;
     return FontImpl::FaceSize(size, res);
 }
 
@@ -167,59 +139,250 @@ static inline GLuint NextPowerOf2(GLuint in)
 }
 
 
-inline int StringCompare(void const *a, char const *b, int len)
+static inline int StringLength(char const *s, int len)
 {
-    return len < 0 ? strcmp((char const *)a, b)
-    : strncmp((char const *)a, b, len);
+    return len < 0 ? (int)strlen(s) : len;
 }
 
 
-inline int StringCompare(void const *a, wchar_t const *b, int len)
+static inline int StringLength(wchar_t const *s, int len)
 {
-    return len < 0 ? wcscmp((wchar_t const *)a, b)
-    : wcsncmp((wchar_t const *)a, b, len);
+    return len < 0 ? (int)wcslen(s) : len;
 }
 
 
-inline char *StringCopy(char const *s, int len)
+template <typename T>
+static inline void KeyText(std::string& text, T const *s, int len)
+{
+    text.assign(reinterpret_cast<const char *>(s), StringLength(s, len) * sizeof(T));
+}
+
+
+static inline void KeyText(std::string& text, const Font::GlyphRun *run, int len)
 {
-    if(len < 0)
+    // The arrays a run points to, not the pointers.
+    text.assign(reinterpret_cast<const char *>(run->glyphs),
+                len * sizeof(*run->glyphs));
+
+    text += run->advances ? 'a' : '-';
+    if(run->advances)
     {
-#ifdef WIN32
-        return _strdup(s);
-#else
-        return strdup(s);
-#endif
+        text.append(reinterpret_cast<const char *>(run->advances),
+                    len * sizeof(*run->advances));
+    }
+
+    text += run->offsets ? 'o' : '-';
+    if(run->offsets)
+    {
+        text.append(reinterpret_cast<const char *>(run->offsets),
+                    len * sizeof(*run->offsets));
+    }
+}
+
+
+BufferFontImpl::StringList::iterator
+BufferFontImpl::FindString(const BufferString& key)
+{
+    std::pair<StringIndex::iterator, StringIndex::iterator> range =
+        stringIndex.equal_range(key.hash);
+
+    for(StringIndex::iterator i = range.first; i != range.second; ++i)
+    {
+        StringList::iterator entry = i->second;
+
+        if(entry->charSize == key.charSize
+           && entry->spacingX == key.spacingX
+           && entry->spacingY == key.spacingY
+           && entry->size == key.size
+           && entry->resolution == key.resolution
+           && entry->text == key.text)
+        {
+            // Most recently used moves to the front.
+            strings.splice(strings.begin(), strings, entry);
+            return entry;
+        }
+    }
+
+    return strings.end();
+}
+
+
+void BufferFontImpl::ResetPage(BufferPage& page, int width, int height)
+{
+    page.width = width;
+    page.height = height;
+    page.strings = 0;
+    page.freeRects.clear();
+
+    BufferRect all = { 0, 0, width, height };
+    page.freeRects.push_back(all);
+
+    difont::gl::BindTexture(page.textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, width, height, 0,
+                 GL_ALPHA, GL_UNSIGNED_BYTE, NULL);
+}
+
+
+bool BufferFontImpl::AllocateInPage(BufferPage& page, int width, int height,
+                                    BufferRect& rect)
+{
+    // Best fit: the smallest free rectangle the string fits in.
+    int best = -1;
+    int bestArea = 0;
+
+    for(size_t i = 0; i < page.freeRects.size(); i++)
+    {
+        const BufferRect& f = page.freeRects[i];
+        int area = f.width * f.height;
+
+        if(f.width >= width && f.height >= height
+           && (best < 0 || area < bestArea))
+        {
+            best = (int)i;
+            bestArea = area;
+        }
+    }
+
+    if(best < 0)
+    {
+        return false;
+    }
+
+    BufferRect f = page.freeRects[best];
+    page.freeRects[best] = page.freeRects.back();
+    page.freeRects.pop_back();
+
+    rect.x = f.x;
+    rect.y = f.y;
+    rect.width = width;
+    rect.height = height;
+
+    // Guillotine split, keeping the larger leftover in one piece.
+    BufferRect right, below;
+    if(f.width - width > f.height - height)
+    {
+        right.x = f.x + width; right.y = f.y;
+        right.width = f.width - width; right.height = f.height;
+        below.x = f.x; below.y = f.y + height;
+        below.width = width; below.height = f.height - height;
+    }
+    else
+    {
+        right.x = f.x + width; right.y = f.y;
+        right.width = f.width - width; right.height = height;
+        below.x = f.x; below.y = f.y + height;
+        below.width = f.width; below.height = f.height - height;
+    }
+
+    if(right.width > 0 && right.height > 0)
+    {
+        page.freeRects.push_back(right);
+    }
+
+    if(below.width > 0 && below.height > 0)
+    {
+        page.freeRects.push_back(below);
+    }
+
+    page.strings++;
+    return true;
+}
+
+
+int BufferFontImpl::EvictString()
+{
+    StringList::iterator victim = --strings.end();
+
+    std::pair<StringIndex::iterator, StringIndex::iterator> range =
+        stringIndex.equal_range(victim->hash);
+    for(StringIndex::iterator i = range.first; i != range.second; ++i)
+    {
+        if(i->second == victim)
+        {
+            stringIndex.erase(i);
+            break;
+        }
+    }
+
+    int index = victim->page;
+    BufferPage& page = pages[index];
+
+    // An empty page starts over in one piece; otherwise the hole is reused
+    // as is.
+    if(--page.strings == 0)
+    {
+        BufferRect all = { 0, 0, page.width, page.height };
+        page.freeRects.clear();
+        page.freeRects.push_back(all);
     }
     else
     {
-#ifdef HAVE_STRNDUP
-        return strndup(s, len);
-#else
-        char *s2 = (char*)malloc(len + 1);
-        memcpy(s2, s, len);
-        s2[len] = 0;
-        return s2;
-#endif
+        page.freeRects.push_back(victim->rect);
     }
+
+    strings.erase(victim);
+    return index;
 }
 
 
-inline wchar_t *StringCopy(wchar_t const *s, int len)
+int BufferFontImpl::Allocate(int width, int height, BufferRect& rect)
 {
-    if(len < 0)
+    for(size_t i = 0; i < pages.size(); i++)
+    {
+        if(AllocateInPage(pages[i], width, height, rect))
+        {
+            return (int)i;
+        }
+    }
+
+    int pageWidth = width > BUFFER_PAGE_SIZE ? (int)NextPowerOf2(width)
+                                             : BUFFER_PAGE_SIZE;
+    int pageHeight = height > BUFFER_PAGE_SIZE ? (int)NextPowerOf2(height)
+                                               : BUFFER_PAGE_SIZE;
+
+    if((int)pages.size() < BUFFER_MAX_PAGES)
+    {
+        BufferPage page;
+        glGenTextures(1, &page.textureID);
+        difont::gl::BindTexture(page.textureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        ResetPage(page, pageWidth, pageHeight);
+
+        pages.push_back(page);
+        AllocateInPage(pages.back(), width, height, rect);
+        return (int)pages.size() - 1;
+    }
+
+    // Every page is in use: expire strings, oldest first, until one of
+    // them makes room. Emptying a page that is still too small for the
+    // string grows it.
+    while(!strings.empty())
     {
-#if defined HAVE_WCSDUP
-        return wcsdup(s);
-#else
-        len = (int)wcslen(s);
-#endif
+        int index = EvictString();
+        BufferPage& page = pages[index];
+
+        if(AllocateInPage(page, width, height, rect))
+        {
+            return index;
+        }
+
+        if(page.strings == 0)
+        {
+            ResetPage(page, std::max(page.width, pageWidth),
+                      std::max(page.height, pageHeight));
+            AllocateInPage(page, width, height, rect);
+            return index;
+        }
     }
 
-    wchar_t *s2 = (wchar_t *)malloc((len + 1) * sizeof(wchar_t));
-    memcpy(s2, s, len * sizeof(wchar_t));
-    s2[len] = 0;
-    return s2;
+    // Only reachable when strings hold no pages at all.
+    ResetPage(pages[0], std::max(pages[0].width, pageWidth),
+              std::max(pages[0].height, pageHeight));
+    AllocateInPage(pages[0], width, height, rect);
+    return 0;
 }
 
 
@@ -229,9 +392,6 @@ inline difont::Point BufferFontImpl::RenderI(const T* string, const int len,
                                          int renderMode)
 {
     const float padding = 3.0f;
-    int width, height, texWidth, texHeight;
-    int cacheIndex = -1;
-    bool inCache = false;
 
     // Protect blending functions, GL_BLEND and GL_TEXTURE_2D
     // glPushAttrib(GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT);
@@ -243,95 +403,93 @@ inline difont::Point BufferFontImpl::RenderI(const T* string, const int len,
     glEnable(GL_TEXTURE_2D);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // GL_ONE
 
-    // Search whether the string is already in a texture we uploaded
-    for(int n = 0; n < BUFFER_CACHE_SIZE; n++)
-    {
-        int i = (lastString + n + BUFFER_CACHE_SIZE) % BUFFER_CACHE_SIZE;
-
-        if(stringCache[i] && !StringCompare(stringCache[i], string, len))
-        {
-            cacheIndex = i;
-            inCache = true;
-            break;
-        }
-    }
-
-    // If the string was not found, we need to put it in the cache and compute
-    // its new bounding box.
-    if(!inCache)
+    BufferString key;
+    KeyText(key.text, string, len);
+    key.charSize = sizeof(T);
+    key.spacingX = spacing.Xf();
+    key.spacingY = spacing.Yf();
+    key.size = charSize.CharSize();
+    key.resolution = resolution;
+    key.hash = Fnv1a64(key.text.data(), key.text.size());
+    key.hash = Fnv1a64(&key.charSize, sizeof(key.charSize), key.hash);
+    key.hash = Fnv1a64(&key.spacingX, sizeof(key.spacingX), key.hash);
+    key.hash = Fnv1a64(&key.spacingY, sizeof(key.spacingY), key.hash);
+    key.hash = Fnv1a64(&key.size, sizeof(key.size), key.hash);
+    key.hash = Fnv1a64(&key.resolution, sizeof(key.resolution), key.hash);
+
+    StringList::iterator entry = FindString(key);
+
+    // If the string was not found, render it into a free rectangle of an
+    // atlas page and upload just that rectangle.
+    if(entry == strings.end())
     {
-        // FIXME: this cache is not very efficient. We should first expire
-        // strings that are not used very often.
-        cacheIndex = lastString;
-        lastString = (lastString + 1) % BUFFER_CACHE_SIZE;
-
-        if(stringCache[cacheIndex])
+        if((int)strings.size() >= BUFFER_CACHE_SIZE)
         {
-            free(stringCache[cacheIndex]);
+            EvictString();
         }
-        // FIXME: only the first N bytes are copied; we want the first N chars.
-        stringCache[cacheIndex] = StringCopy(string, len);
-        bboxCache[cacheIndex] = BBox(string, len, difont::Point(), spacing);
-    }
-
-    difont::BBox bbox = bboxCache[cacheIndex];
 
-    width = static_cast<int>(bbox.Upper().X() - bbox.Lower().X()
-                             + padding + padding + 0.5);
-    height = static_cast<int>(bbox.Upper().Y() - bbox.Lower().Y()
-                              + padding + padding + 0.5);
+        key.bBox = BBoxHeld(string, len, difont::Point(), spacing);
 
-    texWidth = NextPowerOf2(width);
-    texHeight = NextPowerOf2(height);
+        int width = static_cast<int>(key.bBox.Upper().X() - key.bBox.Lower().X()
+                                     + padding + padding + 0.5);
+        int height = static_cast<int>(key.bBox.Upper().Y() - key.bBox.Lower().Y()
+                                      + padding + padding + 0.5);
 
-    difont::gl::BindTexture(idCache[cacheIndex]);
+        key.page = Allocate(width, height, key.rect);
 
-    // If the string was not found, we need to render the text in a new
-    // texture buffer, then upload it to the OpenGL layer.
-    if(!inCache)
-    {
-        buffer->Size(texWidth, texHeight);
-        buffer->Pos(difont::Point(padding, padding) - bbox.Lower());
+        buffer->Size(width, height);
+        buffer->Pos(difont::Point(padding, padding) - key.bBox.Lower());
 
-        advanceCache[cacheIndex] =
-        FontImpl::Render(string, len, difont::Point(), spacing, renderMode);
+        key.advance =
+        RenderGlyphs<T, BufferGlyphImpl>(string, len, difont::Point(), spacing,
+                                         renderMode);
 
-        difont::gl::BindTexture(idCache[cacheIndex]);
+        difont::gl::BindTexture(pages[key.page].textureID);
 
         //glPixelStorei(GL_UNPACK_LSB_FIRST, GL_FALSE);
         //glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-        /* TODO: use glTexSubImage2D later? */
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, texWidth, texHeight, 0,
-                     GL_ALPHA, GL_UNSIGNED_BYTE, (GLvoid *)buffer->Pixels());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, key.rect.x, key.rect.y,
+                        width, height, GL_ALPHA, GL_UNSIGNED_BYTE,
+                        (GLvoid *)buffer->Pixels());
 
         buffer->Size(0, 0);
+
+        strings.push_front(key);
+        entry = strings.begin();
+        stringIndex.insert(std::make_pair(key.hash, entry));
     }
 
-    difont::Point low = position + bbox.Lower();
-    difont::Point up = position + bbox.Upper();
+    const BufferPage& page = pages[entry->page];
+    const BufferRect& rect = entry->rect;
+    difont::gl::BindTexture(page.textureID);
+
+    // The buffer's first row is the top of the string.
+    float s0 = (rect.x + padding) / page.width;
+    float s1 = (rect.x + rect.width - padding) / page.width;
+    float t0 = (rect.y + padding) / page.height;
+    float t1 = (rect.y + rect.height - padding) / page.height;
+
+    difont::Point low = position + entry->bBox.Lower();
+    difont::Point up = position + entry->bBox.Upper();
 
     difont::gl::Begin(GL_QUADS);
     //glNormal3f(0.0f, 0.0f, 1.0f);
-    difont::gl::TexCoord2f(padding / texWidth,
-                   (texHeight - height + padding) / texHeight);
+    difont::gl::TexCoord2f(s0, t0);
     difont::gl::Vertex2f(low.Xf(), up.Yf());
-    difont::gl::TexCoord2f(padding / texWidth,
-                   (texHeight - padding) / texHeight);
+    difont::gl::TexCoord2f(s0, t1);
     difont::gl::Vertex2f(low.Xf(), low.Yf());
-    difont::gl::TexCoord2f((width - padding) / texWidth,
-                   (texHeight - padding) / texHeight);
+    difont::gl::TexCoord2f(s1, t1);
     difont::gl::Vertex2f(up.Xf(), low.Yf());
-    difont::gl::TexCoord2f((width - padding) / texWidth,
-                   (texHeight - height + padding) / texHeight);
+    difont::gl::TexCoord2f(s1, t0);
     difont::gl::Vertex2f(up.Xf(), up.Yf());
     difont::gl::End();
 
     //glPopClientAttrib();
     // glPopAttrib();
 
-    return position + advanceCache[cacheIndex];
+    return position + entry->advance;
 }
 
 
@@ -350,3 +508,10 @@ difont::Point BufferFontImpl::Render(const wchar_t * string, const int len,
     return RenderI(string, len, position, spacing, renderMode);
 }
 
+
+difont::Point BufferFontImpl::RenderRun(const Font::GlyphRun& run,
+                                        difont::Point position, int renderMode)
+{
+    return RenderI(&run, run.count, position, difont::Point(), renderMode);
+}
+
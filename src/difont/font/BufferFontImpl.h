@@ -27,6 +27,10 @@
 #define _DIFONT_BufferFontImpl__
 
 #include "FontImpl.h"
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
 
 namespace difont {
 
@@ -53,6 +57,9 @@ namespace difont {
                                      difont::Point position, difont::Point spacing,
                                      int renderMode);
 
+        virtual difont::Point RenderRun(const Font::GlyphRun& run,
+                                        difont::Point position, int renderMode);
+
         virtual bool FaceSize(const unsigned int size,
                               const unsigned int res);
 
@@ -70,13 +77,97 @@ namespace difont {
         /* Pixel buffer */
         Buffer *buffer;
 
-        static const int BUFFER_CACHE_SIZE = 64;
-        /* Texture IDs */
-        GLuint idCache[BUFFER_CACHE_SIZE];
-        void *stringCache[BUFFER_CACHE_SIZE];
-        difont::BBox bboxCache[BUFFER_CACHE_SIZE];
-        difont::Point advanceCache[BUFFER_CACHE_SIZE];
-        int lastString;
+        /**
+         * A rectangle of texels in an atlas page.
+         */
+        struct BufferRect
+        {
+            int x, y, width, height;
+        };
+
+        /**
+         * A shared texture that rendered strings are packed into.
+         */
+        struct BufferPage
+        {
+            GLuint textureID;
+            int width, height;
+            /* Unused space, as disjoint rectangles */
+            std::vector<BufferRect> freeRects;
+            /* Number of cached strings living in the page */
+            int strings;
+        };
+
+        /**
+         * A string rendered into one of the atlas pages. The key is the
+         * string's bytes together with everything that changes its image.
+         */
+        struct BufferString
+        {
+            std::string text;
+            unsigned int charSize;
+            float spacingX, spacingY;
+            unsigned int size, resolution;
+            uint64_t hash;
+
+            difont::BBox bBox;
+            difont::Point advance;
+            int page;
+            BufferRect rect;
+        };
+
+        typedef std::list<BufferString> StringList;
+        typedef std::multimap<uint64_t, StringList::iterator> StringIndex;
+
+        /**
+         * Find a cached string and make it the most recently used.
+         *
+         * @return  the entry, or strings.end() on a miss.
+         */
+        StringList::iterator FindString(const BufferString& key);
+
+        /**
+         * Reserve a rectangle in an atlas page, adding pages or evicting
+         * the least recently used strings as needed.
+         *
+         * @param width   rectangle width in texels.
+         * @param height  rectangle height in texels.
+         * @param rect    receives the reserved rectangle.
+         * @return  the page index.
+         */
+        int Allocate(int width, int height, BufferRect& rect);
+
+        /**
+         * Carve a rectangle out of a page's free space.
+         *
+         * @return  <code>true</code> if it fit.
+         */
+        bool AllocateInPage(BufferPage& page, int width, int height,
+                            BufferRect& rect);
+
+        /**
+         * (Re)create a page's texture at the given size and mark it empty.
+         */
+        void ResetPage(BufferPage& page, int width, int height);
+
+        /**
+         * Drop the least recently used string and free its rectangle.
+         *
+         * @return  the index of the page the string lived in.
+         */
+        int EvictString();
+
+        /* Most recently used first */
+        StringList strings;
+        StringIndex stringIndex;
+        std::vector<BufferPage> pages;
+
+        /* Resolution of the current face size, part of every key */
+        unsigned int resolution;
+
+        static const int BUFFER_CACHE_SIZE = 256;
+        static const int BUFFER_PAGE_SIZE = 1024;
+        static const int BUFFER_MAX_PAGES = 4;
     };
 }
 
@@ -27,6 +27,7 @@
 #include  <difont/difont.h>
 
 #include "Internals.h"
+#include "FrameBudget.h"
 #include "ExtrudeFontImpl.h"
 
 
@@ -48,7 +49,11 @@ ExtrudeFont::ExtrudeFont(const unsigned char *pBufferBytes,
 
 
 ExtrudeFont::~ExtrudeFont()
-{}
+{
+    // Before the vtable is unwound: BeginFrame() may be making one of
+    // this font's glyphs on another thread.
+    difont::FrameBudget::ForgetFont(impl);
+}
 
 
 Glyph* ExtrudeFont::MakeGlyph(FT_GlyphSlot ftGlyph)
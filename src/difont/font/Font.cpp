@@ -28,6 +28,8 @@
 #include "Unicode.h"
 
 #include "FontImpl.h"
+#include "FrameBudget.h"
+#include "PlaceholderGlyph.h"
 
 #include "BitmapFontImpl.h"
 #include "ExtrudeFontImpl.h"
@@ -66,96 +68,114 @@ Font::Font(FontImpl *pImpl)
 
 Font::~Font()
 {
+    // The font classes do this in their own destructors, while their
+    // MakeGlyph() can still be called; this catches other subclasses.
+    difont::FrameBudget::ForgetFont(impl);
     delete impl;
 }
 
 
 bool Font::Attach(const char* fontFilePath)
 {
+    SharedMutexLock lock(impl->accessLock);
     return impl->Attach(fontFilePath);
 }
 
 
 bool Font::Attach(const unsigned char *pBufferBytes, size_t bufferSizeInBytes)
 {
+    SharedMutexLock lock(impl->accessLock);
     return impl->Attach(pBufferBytes, bufferSizeInBytes);
 }
 
 
 bool Font::FaceSize(const unsigned int size, const unsigned int res)
 {
+    SharedMutexLock lock(impl->accessLock);
     return impl->FaceSize(size, res);
 }
 
 
 unsigned int Font::FaceSize() const
 {
+    SharedMutexLock lock(impl->accessLock, true);
     return impl->FaceSize();
 }
 
 
 void Font::Depth(float depth)
 {
+    SharedMutexLock lock(impl->accessLock);
     return impl->Depth(depth);
 }
 
 
 void Font::Outset(float outset)
 {
+    SharedMutexLock lock(impl->accessLock);
     return impl->Outset(outset);
 }
 
 
 void Font::Outset(float front, float back)
 {
+    SharedMutexLock lock(impl->accessLock);
     return impl->Outset(front, back);
 }
 
 
 void Font::GlyphLoadFlags(FT_Int flags)
 {
+    SharedMutexLock lock(impl->accessLock);
     return impl->GlyphLoadFlags(flags);
 }
 
 
 bool Font::CharMap(FT_Encoding encoding)
 {
+    SharedMutexLock lock(impl->accessLock);
     return impl->CharMap(encoding);
 }
 
 
 unsigned int Font::CharMapCount() const
 {
+    SharedMutexLock lock(impl->accessLock, true);
     return impl->CharMapCount();
 }
 
 
 FT_Encoding* Font::CharMapList()
 {
+    SharedMutexLock lock(impl->accessLock);
     return impl->CharMapList();
 }
 
 
 void Font::UseDisplayList(bool useList)
 {
+    SharedMutexLock lock(impl->accessLock);
     return impl->UseDisplayList(useList);
 }
 
 
 float Font::Ascender() const
 {
+    SharedMutexLock lock(impl->accessLock, true);
     return impl->Ascender();
 }
 
 
 float Font::Descender() const
 {
+    SharedMutexLock lock(impl->accessLock, true);
     return impl->Descender();
 }
 
 
 float Font::LineHeight() const
 {
+    SharedMutexLock lock(impl->accessLock, true);
     return impl->LineHeight();
 }
 
@@ -163,6 +183,7 @@ float Font::LineHeight() const
 difont::Point Font::Render(const char * string, const int len,
                            difont::Point position, difont::Point spacing, int renderMode)
 {
+    SharedMutexLock lock(impl->accessLock);
     return impl->Render(string, len, position, spacing, renderMode);
 }
 
@@ -170,15 +191,32 @@ difont::Point Font::Render(const char * string, const int len,
 difont::Point Font::Render(const wchar_t * string, const int len,
                            difont::Point position, difont::Point spacing, int renderMode)
 {
+    SharedMutexLock lock(impl->accessLock);
     return impl->Render(string, len, position, spacing, renderMode);
 }
 
 
+difont::Point Font::RenderGlyphs(const GlyphRun& run, difont::Point position,
+                                 int renderMode)
+{
+    SharedMutexLock lock(impl->accessLock);
+    return impl->RenderRun(run, position, renderMode);
+}
+
 
-void Font::PreRender() { impl->PreRender(); }
+
+void Font::PreRender()
+{
+    SharedMutexLock lock(impl->accessLock);
+    impl->PreRender();
+}
 
 
-void Font::PostRender() { impl->PostRender(); }
+void Font::PostRender()
+{
+    SharedMutexLock lock(impl->accessLock);
+    impl->PostRender();
+}
 
 
 
@@ -208,12 +246,69 @@ difont::BBox Font::BBox(const wchar_t *string, const int len,
 }
 
 
+float Font::Advance(const GlyphRun& run)
+{
+    return impl->AdvanceRun(run);
+}
+
+
+difont::BBox Font::BBox(const GlyphRun& run, difont::Point position)
+{
+    return impl->BBoxRun(run, position);
+}
+
+
 FT_Error Font::Error() const
 {
+    SharedMutexLock lock(impl->accessLock, true);
     return impl->err;
 }
 
 
+void Font::GlyphBudget(unsigned int glyphs, unsigned int microseconds)
+{
+    difont::FrameBudget::Limit(glyphs, microseconds);
+}
+
+
+void Font::BeginFrame()
+{
+    difont::FrameBudget::BeginFrame();
+}
+
+
+unsigned int Font::EndFrame()
+{
+    return difont::FrameBudget::EndFrame();
+}
+
+
+void Font::GlyphCacheBudget(size_t bytes)
+{
+    SharedMutexLock lock(impl->accessLock);
+    impl->GlyphCacheBudget(bytes);
+}
+
+
+void Font::GlobalGlyphCacheBudget(size_t bytes)
+{
+    difont::GlyphContainer::GlobalBudget(bytes);
+}
+
+
+Font::GlyphCacheStats Font::GlyphCacheStatistics() const
+{
+    SharedMutexLock lock(impl->accessLock, true);
+    return impl->GlyphCacheStatistics();
+}
+
+
+void Font::ConcurrentMeasurement(bool enable)
+{
+    impl->ConcurrentMeasurement(enable);
+}
+
+
 //
 //  FontImpl
 //
@@ -223,8 +318,14 @@ FontImpl::FontImpl(Font *ftFont, char const *fontFilePath) :
 face(fontFilePath),
 useDisplayLists(true),
 load_flags(FT_LOAD_DEFAULT),
+nativeGlyph(NULL),
+accessLock(NULL),
 intf(ftFont),
-glyphList(0)
+glyphList(0),
+cacheBudget(0),
+cacheHits(0),
+cacheMisses(0),
+cacheEvictions(0)
 {
     err = face.Error();
     if(err == 0)
@@ -239,8 +340,14 @@ FontImpl::FontImpl(Font *ftFont, const unsigned char *pBufferBytes,
 face(pBufferBytes, bufferSizeInBytes),
 useDisplayLists(true),
 load_flags(FT_LOAD_DEFAULT),
+nativeGlyph(NULL),
+accessLock(NULL),
 intf(ftFont),
-glyphList(0)
+glyphList(0),
+cacheBudget(0),
+cacheHits(0),
+cacheMisses(0),
+cacheEvictions(0)
 {
     err = face.Error();
     if(err == 0)
@@ -252,10 +359,8 @@ glyphList(0)
 
 FontImpl::~FontImpl()
 {
-    if(glyphList)
-    {
-        delete glyphList;
-    }
+    ForgetSizes(false);
+    delete accessLock;
 }
 
 
@@ -286,15 +391,62 @@ bool FontImpl::Attach(const unsigned char *pBufferBytes,
 }
 
 
+// Placeholders are the only glyphs with a bare GlyphImpl.
+static bool IsPlaceholder(const GlyphImpl* impl, void* context)
+{
+    return typeid(*impl) == typeid(GlyphImpl);
+}
+
+
 bool FontImpl::FaceSize(const unsigned int size, const unsigned int res)
 {
-    if(glyphList != NULL)
+    // Setting the current size again makes all the glyphs again, so
+    // settings changed since reach them.
+    if(glyphList && !sizes.empty() && sizes.front().size == size
+       && sizes.front().res == res)
     {
+        ForgetSizes(false);
+    }
+
+    // Glyphs deferred by the frame budget are deferred again when their
+    // size is next used.
+    EvictGlyphs(IsPlaceholder, NULL);
+    difont::FrameBudget::Forget(this);
+
+    for(std::list<SizeState>::iterator it = sizes.begin(); it != sizes.end(); ++it)
+    {
+        if(it->size == size && it->res == res)
+        {
+            sizes.splice(sizes.begin(), sizes, it);
+            face.ActivateSize(it->charSize);
+            charSize = it->charSize;
+            glyphList = it->glyphList;
+            err = 0;
+            return true;
+        }
+    }
+
+    if(sizes.empty())
+    {
+        // The first size is set on the face's own FreeType size.
         delete glyphList;
-        glyphList = NULL;
+        charSize = face.Size(size, res);
+    }
+    else if(sizes.size() < MAX_SIZES)
+    {
+        charSize = face.NewSize(size, res);
+    }
+    else
+    {
+        // Reuse the FreeType size of the least recently used size.
+        SizeState& oldest = sizes.back();
+        delete oldest.glyphList;
+        face.ActivateSize(oldest.charSize);
+        sizes.pop_back();
+        charSize = face.Size(size, res);
     }
 
-    charSize = face.Size(size, res);
+    glyphList = NULL;
     err = face.Error();
 
     if(err != 0)
@@ -303,6 +455,15 @@ bool FontImpl::FaceSize(const unsigned int size, const unsigned int res)
     }
 
     glyphList = new GlyphContainer(&face);
+    glyphList->Budget(cacheBudget);
+
+    SizeState state;
+    state.size = size;
+    state.res = res;
+    state.charSize = charSize;
+    state.glyphList = glyphList;
+    sizes.push_front(state);
+
     return true;
 }
 
@@ -341,6 +502,10 @@ bool FontImpl::CharMap(FT_Encoding encoding)
 {
     bool result = glyphList->CharMap(encoding);
     err = glyphList->Error();
+
+    // The other sizes map characters with the old charmap.
+    ForgetSizes(true);
+
     return result;
 }
 
@@ -384,6 +549,29 @@ float FontImpl::LineHeight() const
 template <typename T>
 inline difont::BBox FontImpl::BBoxI(const T* string, const int len,
                                 difont::Point position, difont::Point spacing)
+{
+    if(accessLock && face.SharedKerning())
+    {
+        // Nothing is loaded under the shared lock. Text with glyphs not
+        // measured before is measured again under the exclusive one.
+        SharedMutexLock lock(accessLock, true);
+        bool missed = false;
+        difont::BBox totalBBox = MeasureBBox(string, len, position, spacing, &missed);
+        if(!missed)
+        {
+            return totalBBox;
+        }
+    }
+
+    SharedMutexLock lock(accessLock);
+    return MeasureBBox(string, len, position, spacing, NULL);
+}
+
+
+template <typename T>
+inline difont::BBox FontImpl::MeasureBBox(const T* string, const int len,
+                                          difont::Point position, difont::Point spacing,
+                                          bool* missed)
 {
     difont::BBox totalBBox;
 
@@ -395,12 +583,13 @@ inline difont::BBox FontImpl::BBoxI(const T* string, const int len,
         unsigned int thisChar = *ustr++;
         unsigned int nextChar = *ustr;
 
-        if(CheckGlyph(thisChar))
+        unsigned int slot = MetricsSlot(thisChar, missed);
+        if(slot)
         {
-            totalBBox = glyphList->BBox(thisChar);
+            totalBBox = glyphList->SlotBBox(slot);
             totalBBox += position;
 
-            position += difont::Point(glyphList->Advance(thisChar, nextChar), 0.0);
+            position += difont::Point(SlotAdvance(slot, nextChar, missed), 0.0);
         }
 
         /* Expand totalBox by each glyph in string */
@@ -409,16 +598,21 @@ inline difont::BBox FontImpl::BBoxI(const T* string, const int len,
             thisChar = *ustr++;
             nextChar = *ustr;
 
-            if(CheckGlyph(thisChar))
+            slot = MetricsSlot(thisChar, missed);
+            if(slot)
             {
                 position += spacing;
 
-                difont::BBox tempBBox = glyphList->BBox(thisChar);
+                difont::BBox tempBBox = glyphList->SlotBBox(slot);
                 tempBBox += position;
                 totalBBox |= tempBBox;
 
-                position += difont::Point(glyphList->Advance(thisChar, nextChar),
-                                    0.0);
+                position += difont::Point(SlotAdvance(slot, nextChar, missed), 0.0);
+            }
+
+            if(missed && *missed)
+            {
+                break;
             }
         }
     }
@@ -442,9 +636,54 @@ difont::BBox FontImpl::BBox(const wchar_t *string, const int len,
 }
 
 
+difont::BBox FontImpl::BBoxHeld(const char *string, const int len,
+                                difont::Point position, difont::Point spacing)
+{
+    return MeasureBBox((const unsigned char *)string, len, position, spacing, NULL);
+}
+
+
+difont::BBox FontImpl::BBoxHeld(const wchar_t *string, const int len,
+                                difont::Point position, difont::Point spacing)
+{
+    return MeasureBBox(string, len, position, spacing, NULL);
+}
+
+
+difont::BBox FontImpl::BBoxHeld(const Font::GlyphRun *run, const int len,
+                                difont::Point position, difont::Point spacing)
+{
+    difont::BBox totalBBox;
+    MeasureRun(*run, position, &totalBBox, NULL);
+
+    return totalBBox;
+}
+
+
 template <typename T>
 inline float FontImpl::AdvanceI(const T* string, const int len,
                                   difont::Point spacing)
+{
+    if(accessLock && face.SharedKerning())
+    {
+        // As for BBoxI().
+        SharedMutexLock lock(accessLock, true);
+        bool missed = false;
+        float advance = MeasureAdvance(string, len, spacing, &missed);
+        if(!missed)
+        {
+            return advance;
+        }
+    }
+
+    SharedMutexLock lock(accessLock);
+    return MeasureAdvance(string, len, spacing, NULL);
+}
+
+
+template <typename T>
+inline float FontImpl::MeasureAdvance(const T* string, const int len,
+                                      difont::Point spacing, bool* missed)
 {
     float advance = 0.0f;
     FTUnicodeStringItr<T> ustr(string);
@@ -454,9 +693,15 @@ inline float FontImpl::AdvanceI(const T* string, const int len,
         unsigned int thisChar = *ustr++;
         unsigned int nextChar = *ustr;
 
-        if(CheckGlyph(thisChar))
+        unsigned int slot = MetricsSlot(thisChar, missed);
+        if(slot)
+        {
+            advance += SlotAdvance(slot, nextChar, missed);
+        }
+
+        if(missed && *missed)
         {
-            advance += glyphList->Advance(thisChar, nextChar);
+            break;
         }
 
         if(nextChar)
@@ -487,24 +732,69 @@ inline difont::Point FontImpl::RenderI(const T* string, const int len,
                                    difont::Point position, difont::Point spacing,
                                    int renderMode)
 {
-    // for multibyte - we can't rely on sizeof(T) == character
-    FTUnicodeStringItr<T> ustr(string);
+    return RenderGlyphs<T, GlyphImpl>(string, len, position, spacing, renderMode);
+}
 
-    for(int i = 0; (len < 0 && *ustr) || (len >= 0 && i < len); i++)
+
+difont::Point FontImpl::Render(const char * string, const int len,
+                           difont::Point position, difont::Point spacing, int renderMode)
+{
+    difont::Point tmp = FontImpl::RenderI(string, len, position, spacing, renderMode);
+    return tmp;
+}
+
+
+difont::Point FontImpl::Render(const wchar_t * string, const int len,
+                           difont::Point position, difont::Point spacing, int renderMode)
+{
+    difont::Point tmp = FontImpl::RenderI(string, len, position, spacing, renderMode);
+    return tmp;
+}
+
+
+difont::Point FontImpl::RenderRun(const Font::GlyphRun& run,
+                                 difont::Point position, int renderMode)
+{
+    return RenderI(&run, run.count, position, difont::Point(), renderMode);
+}
+
+
+difont::Point FontImpl::MeasureRun(const Font::GlyphRun& run, difont::Point position,
+                                   difont::BBox* bBox, bool* missed)
+{
+    bool empty = true;
+
+    for(unsigned int i = 0; i < run.count; i++)
     {
-        unsigned int thisChar = *ustr++;
-        unsigned int nextChar = *ustr;
+        unsigned int slot = FontIndexMetricsSlot(run.glyphs[i], missed);
+        if(missed && *missed)
+        {
+            break;
+        }
 
-        if(CheckGlyph(thisChar))
+        if(slot && bBox)
         {
+            difont::BBox tempBBox = glyphList->SlotBBox(slot);
+            tempBBox += run.offsets ? position + run.offsets[i] : position;
 
-            position += glyphList->Render(thisChar, nextChar,
-                                          position, renderMode);
+            if(empty)
+            {
+                *bBox = tempBBox;
+                empty = false;
+            }
+            else
+            {
+                *bBox |= tempBBox;
+            }
         }
 
-        if(nextChar)
+        if(run.advances)
         {
-            position += spacing;
+            position += run.advances[i];
+        }
+        else if(slot)
+        {
+            position += difont::Point(glyphList->SlotAdvance(slot), 0.0);
         }
     }
 
@@ -512,50 +802,301 @@ inline difont::Point FontImpl::RenderI(const T* string, const int len,
 }
 
 
-difont::Point FontImpl::Render(const char * string, const int len,
-                           difont::Point position, difont::Point spacing, int renderMode)
+difont::Point FontImpl::MeasureRunI(const Font::GlyphRun& run, difont::Point position,
+                                    difont::BBox* bBox)
 {
-    difont::Point tmp = FontImpl::RenderI(string, len, position, spacing, renderMode);
-    return tmp;
+    if(accessLock)
+    {
+        // Runs aren't kerned, so any face may share the lock.
+        SharedMutexLock lock(accessLock, true);
+        bool missed = false;
+        difont::Point end = MeasureRun(run, position, bBox, &missed);
+        if(!missed)
+        {
+            return end;
+        }
+    }
+
+    SharedMutexLock lock(accessLock);
+    return MeasureRun(run, position, bBox, NULL);
 }
 
 
-difont::Point FontImpl::Render(const wchar_t * string, const int len,
-                           difont::Point position, difont::Point spacing, int renderMode)
+difont::BBox FontImpl::BBoxRun(const Font::GlyphRun& run, difont::Point position)
 {
-    difont::Point tmp = FontImpl::RenderI(string, len, position, spacing, renderMode);
-    return tmp;
+    difont::BBox totalBBox;
+    MeasureRunI(run, position, &totalBBox);
+
+    return totalBBox;
 }
 
 
-bool FontImpl::CheckGlyph(const unsigned int characterCode)
+float FontImpl::AdvanceRun(const Font::GlyphRun& run)
 {
-    if(glyphList->Glyph(characterCode))
+    if(run.advances)
     {
-        return true;
+        // The glyphs themselves aren't needed.
+        float advance = 0.0f;
+        for(unsigned int i = 0; i < run.count; i++)
+        {
+            advance += run.advances[i].Xf();
+        }
+
+        return advance;
+    }
+
+    return MeasureRunI(run, difont::Point(), NULL).Xf();
+}
+
+
+unsigned int FontImpl::AddGlyph(const unsigned int characterCode)
+{
+    // The slot holds only metrics if the text was measured before, or
+    // its glyph was evicted.
+    return FillSlot(glyphList->Slot(characterCode),
+                    glyphList->FontIndex(characterCode), characterCode, false);
+}
+
+
+unsigned int FontImpl::FillSlot(unsigned int slot, const unsigned int glyphIndex,
+                                const unsigned int code, bool byFontIndex)
+{
+    ++cacheMisses;
+
+    Glyph* tempGlyph = MakeCachedGlyph(glyphIndex);
+    if(!tempGlyph)
+    {
+        if(difont::FrameBudget::Available())
+        {
+            tempGlyph = LoadGlyph(glyphIndex);
+            if(!tempGlyph)
+            {
+                return 0;
+            }
+        }
+        else
+        {
+            // Out of budget this frame, finish it in a later one.
+            if(slot)
+            {
+                tempGlyph = new difont::PlaceholderGlyph(
+                    glyphList->SlotAdvance(slot), glyphList->SlotBBox(slot));
+            }
+            else
+            {
+                float advance = face.GlyphAdvance(glyphIndex, load_flags);
+                tempGlyph = new difont::PlaceholderGlyph(advance,
+                    difont::BBox(0.0f, charSize.Descender(), 0.0f,
+                                 advance, charSize.Ascender(), 0.0f));
+            }
+            difont::FrameBudget::Defer(this, code, byFontIndex);
+        }
+    }
+
+    if(slot)
+    {
+        glyphList->ReplaceSlot(slot, tempGlyph, IsNativeGlyph(tempGlyph));
+    }
+    else if(byFontIndex)
+    {
+        slot = glyphList->AddFontIndex(tempGlyph, glyphIndex, IsNativeGlyph(tempGlyph));
+    }
+    else
+    {
+        glyphList->Add(tempGlyph, code, IsNativeGlyph(tempGlyph));
+        slot = glyphList->Slot(code);
+    }
+
+    cacheEvictions += glyphList->Trim(slot);
+    return slot;
+}
+
+
+unsigned int FontImpl::AddMetrics(const unsigned int characterCode)
+{
+    // Loading the outline is enough, nothing is rasterised or tessellated.
+    FT_GlyphSlot ftSlot = face.Glyph(glyphList->FontIndex(characterCode),
+                                     load_flags);
+    if(!ftSlot)
+    {
+        err = face.Error();
+        return 0;
+    }
+
+    glyphList->AddMetrics(characterCode,
+                          static_cast<float>(ftSlot->advance.x) / 64.0f,
+                          difont::BBox(ftSlot));
+
+    return glyphList->Slot(characterCode);
+}
+
+
+unsigned int FontImpl::AddFontIndexMetrics(const unsigned int glyphIndex)
+{
+    glyphList->IndexFontIndices();
+
+    unsigned int slot = glyphList->FontIndexSlot(glyphIndex);
+    if(slot)
+    {
+        return slot;
     }
 
-    unsigned int glyphIndex = glyphList->FontIndex(characterCode);
     FT_GlyphSlot ftSlot = face.Glyph(glyphIndex, load_flags);
     if(!ftSlot)
     {
         err = face.Error();
-        return false;
+        return 0;
     }
 
-    Glyph* tempGlyph = intf->MakeGlyph(ftSlot);
-    if(!tempGlyph)
+    return glyphList->AddFontIndexMetrics(glyphIndex,
+                                          static_cast<float>(ftSlot->advance.x) / 64.0f,
+                                          difont::BBox(ftSlot));
+}
+
+
+Glyph* FontImpl::LoadGlyph(unsigned int glyphIndex)
+{
+    uint64_t start = difont::FrameBudget::Start();
+
+    Glyph* tempGlyph = NULL;
+    FT_GlyphSlot ftSlot = face.Glyph(glyphIndex, load_flags);
+    if(ftSlot)
+    {
+        tempGlyph = intf->MakeGlyph(ftSlot);
+    }
+    else
+    {
+        err = face.Error();
+    }
+
+    difont::FrameBudget::Spend(start);
+
+    if(!tempGlyph && 0 == err)
     {
-        if(0 == err)
+        err = 0x13;
+    }
+
+    return tempGlyph;
+}
+
+
+void FontImpl::FinishGlyph(const unsigned int code, bool byFontIndex)
+{
+    // Called from Font::BeginFrame(), not through this font.
+    SharedMutexLock lock(accessLock);
+
+    unsigned int slot = byFontIndex ? glyphList->FontIndexSlot(code)
+                                    : glyphList->Slot(code);
+
+    // The placeholder is gone if the size changed after the glyph was
+    // taken from the budget's list.
+    if(!slot || !dynamic_cast<difont::PlaceholderGlyph*>(glyphList->SlotGlyph(slot)))
+    {
+        return;
+    }
+
+    // The placeholder stays if the glyph can't be loaded.
+    Glyph* tempGlyph = LoadGlyph(byFontIndex ? code : glyphList->FontIndex(code));
+    if(tempGlyph)
+    {
+        glyphList->ReplaceSlot(slot, tempGlyph, IsNativeGlyph(tempGlyph));
+        cacheEvictions += glyphList->Trim(slot);
+    }
+}
+
+
+void FontImpl::RefreshGlyphMetrics()
+{
+    if(glyphList)
+    {
+        glyphList->RefreshMetrics();
+    }
+}
+
+
+void FontImpl::ForgetSizes(bool keepCurrent)
+{
+    if(!keepCurrent)
+    {
+        difont::FrameBudget::Forget(this);
+
+        // Before the first size the glyphs aren't in a SizeState.
+        if(sizes.empty())
         {
-            err = 0x13;
+            delete glyphList;
         }
-        
-        return false;
+        glyphList = NULL;
+    }
+
+    while(sizes.size() > (keepCurrent ? 1 : 0))
+    {
+        SizeState& state = sizes.back();
+        delete state.glyphList;
+
+        // The current FreeType size stays, for the next size to be set on.
+        if(sizes.size() > 1)
+        {
+            face.DoneSize(state.charSize);
+        }
+        sizes.pop_back();
+    }
+}
+
+
+unsigned int FontImpl::EvictGlyphs(bool (*test)(const GlyphImpl* impl, void* context),
+                                   void* context)
+{
+    return glyphList ? glyphList->EvictIf(test, context) : 0;
+}
+
+
+void FontImpl::GlyphCacheBudget(size_t bytes)
+{
+    cacheBudget = bytes;
+    for(std::list<SizeState>::iterator it = sizes.begin(); it != sizes.end(); ++it)
+    {
+        it->glyphList->Budget(bytes);
+    }
+
+    if(glyphList)
+    {
+        glyphList->Budget(bytes);
+        cacheEvictions += glyphList->Trim(0);
+    }
+}
+
+
+Font::GlyphCacheStats FontImpl::GlyphCacheStatistics() const
+{
+    Font::GlyphCacheStats stats;
+    stats.hits = cacheHits;
+    stats.misses = cacheMisses;
+    stats.evictions = cacheEvictions;
+    stats.glyphs = glyphList ? glyphList->GlyphCount() : 0;
+    stats.bytes = glyphList ? glyphList->Bytes() : 0;
+
+    return stats;
+}
+
+
+bool FontImpl::HasGlyph(const unsigned int characterCode)
+{
+    // Called from FontCollection, not through this font.
+    SharedMutexLock lock(accessLock);
+    return glyphList && glyphList->FontIndex(characterCode) != 0;
+}
+
+
+void FontImpl::ConcurrentMeasurement(bool enable)
+{
+    if(enable && !accessLock)
+    {
+        accessLock = new SharedMutex;
+    }
+    else if(!enable && accessLock)
+    {
+        delete accessLock;
+        accessLock = NULL;
     }
-    
-    glyphList->Add(tempGlyph, characterCode);
-    
-    return true;
 }
 
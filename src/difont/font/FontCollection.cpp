@@ -0,0 +1,517 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+
+#include <algorithm>
+
+#include  <difont/difont.h>
+
+#include "Internals.h"
+#include "Unicode.h"
+#include "FontImpl.h"
+#include "FontCollectionImpl.h"
+
+
+//
+//  difont::FontCollection
+//
+
+
+difont::FontCollection::FontCollection() :
+    impl(new difont::FontCollectionImpl())
+{}
+
+
+difont::FontCollection::~FontCollection()
+{
+    delete impl;
+}
+
+
+bool difont::FontCollection::AddFont(Font* font)
+{
+    return impl->AddFont(font);
+}
+
+
+unsigned int difont::FontCollection::FontCount() const
+{
+    return impl->FontCount();
+}
+
+
+difont::Font* difont::FontCollection::FontFor(unsigned int charCode)
+{
+    return impl->FontFor(charCode);
+}
+
+
+float difont::FontCollection::Ascender() const
+{
+    return impl->Ascender();
+}
+
+
+float difont::FontCollection::Descender() const
+{
+    return impl->Descender();
+}
+
+
+float difont::FontCollection::LineHeight() const
+{
+    return impl->LineHeight();
+}
+
+
+difont::BBox difont::FontCollection::BBox(const char *string, const int len,
+                                          difont::Point position, difont::Point spacing)
+{
+    return impl->BBox(string, len, position, spacing);
+}
+
+
+difont::BBox difont::FontCollection::BBox(const wchar_t *string, const int len,
+                                          difont::Point position, difont::Point spacing)
+{
+    return impl->BBox(string, len, position, spacing);
+}
+
+
+float difont::FontCollection::Advance(const char* string, const int len, difont::Point spacing)
+{
+    return impl->Advance(string, len, spacing);
+}
+
+
+float difont::FontCollection::Advance(const wchar_t* string, const int len, difont::Point spacing)
+{
+    return impl->Advance(string, len, spacing);
+}
+
+
+difont::Point difont::FontCollection::Render(const char * string, const int len,
+                                             difont::Point position, difont::Point spacing,
+                                             int renderMode)
+{
+    return impl->Render(string, len, position, spacing, renderMode);
+}
+
+
+difont::Point difont::FontCollection::Render(const wchar_t * string, const int len,
+                                             difont::Point position, difont::Point spacing,
+                                             int renderMode)
+{
+    return impl->Render(string, len, position, spacing, renderMode);
+}
+
+
+FT_Error difont::FontCollection::Error() const
+{
+    return impl->err;
+}
+
+
+//
+//  difont::FontCollectionImpl
+//
+
+
+difont::FontCollectionImpl::FontCollectionImpl() :
+    err(0)
+{
+    for(unsigned int i = 0; i < PLANE_COUNT; i++)
+    {
+        planes[i] = NULL;
+    }
+}
+
+
+difont::FontCollectionImpl::~FontCollectionImpl()
+{
+    Clear();
+}
+
+
+bool difont::FontCollectionImpl::AddFont(Font* font)
+{
+    if(!font || fonts.size() >= difont::FontCollection::MAX_FONTS)
+    {
+        return false;
+    }
+
+    fonts.push_back(font);
+    CheckError(font);
+
+    // Characters no font had may be in this one.
+    Clear();
+    return true;
+}
+
+
+float difont::FontCollectionImpl::Ascender() const
+{
+    float ascender = 0.0f;
+    for(size_t i = 0; i < fonts.size(); ++i)
+    {
+        ascender = i ? std::max(ascender, fonts[i]->Ascender()) : fonts[i]->Ascender();
+    }
+
+    return ascender;
+}
+
+
+float difont::FontCollectionImpl::Descender() const
+{
+    float descender = 0.0f;
+    for(size_t i = 0; i < fonts.size(); ++i)
+    {
+        descender = i ? std::min(descender, fonts[i]->Descender()) : fonts[i]->Descender();
+    }
+
+    return descender;
+}
+
+
+float difont::FontCollectionImpl::LineHeight() const
+{
+    float lineHeight = 0.0f;
+    for(size_t i = 0; i < fonts.size(); ++i)
+    {
+        lineHeight = std::max(lineHeight, fonts[i]->LineHeight());
+    }
+
+    return lineHeight;
+}
+
+
+unsigned int difont::FontCollectionImpl::Resolve(unsigned int charCode)
+{
+    if(fonts.empty())
+    {
+        return 0;
+    }
+
+    // The first font draws the missing glyph if no font has one.
+    unsigned int number = 0;
+    for(size_t i = 0; i < fonts.size(); ++i)
+    {
+        if(fonts[i]->impl->HasGlyph(charCode))
+        {
+            number = static_cast<unsigned int>(i);
+            break;
+        }
+    }
+
+    unsigned int plane = charCode >> 16;
+    if(plane < PLANE_COUNT)
+    {
+        if(!planes[plane])
+        {
+            planes[plane] = new unsigned char*[BLOCK_SIZE];
+            for(unsigned int i = 0; i < BLOCK_SIZE; i++)
+            {
+                planes[plane][i] = NULL;
+            }
+        }
+
+        unsigned char*& block = planes[plane][(charCode >> 8) & 0xff];
+        if(!block)
+        {
+            block = new unsigned char[BLOCK_SIZE];
+            memset(block, 0, BLOCK_SIZE);
+        }
+
+        block[charCode & 0xff] = static_cast<unsigned char>(number + 1);
+    }
+
+    return number;
+}
+
+
+void difont::FontCollectionImpl::Clear()
+{
+    for(unsigned int i = 0; i < PLANE_COUNT; i++)
+    {
+        if(planes[i])
+        {
+            for(unsigned int j = 0; j < BLOCK_SIZE; j++)
+            {
+                delete[] planes[i][j];
+            }
+
+            delete[] planes[i];
+            planes[i] = NULL;
+        }
+    }
+}
+
+
+template <typename T>
+inline void difont::FontCollectionImpl::SplitRunsI(const T* string, const int len)
+{
+    runs.clear();
+    if(!string || fonts.empty())
+    {
+        return;
+    }
+
+    // for multibyte - we can't rely on sizeof(T) == character
+    FTUnicodeStringItr<T> ustr(string);
+
+    for(int i = 0; (len < 0 && *ustr) || (len >= 0 && i < len); i++)
+    {
+        size_t offset = ustr.getBufferFromHere() - string;
+        unsigned int font = FontNumber(*ustr++);
+
+        if(runs.empty() || runs.back().font != font)
+        {
+            Run run;
+            run.font = font;
+            run.offset = offset;
+            run.ended = 0;
+            run.length = 0;
+            run.spaced = 0;
+            runs.push_back(run);
+        }
+
+        ++runs.back().length;
+        ++runs.back().spaced;
+    }
+
+    // No spacing after the last character of the string.
+    if(!runs.empty() && !*ustr)
+    {
+        --runs.back().spaced;
+    }
+}
+
+
+void difont::FontCollectionImpl::SplitRuns(const char* string, const int len)
+{
+    /* The chars need to be unsigned because they are cast to int later */
+    SplitRunsI((const unsigned char *)string, len);
+}
+
+
+void difont::FontCollectionImpl::SplitRuns(const wchar_t* string, const int len)
+{
+    SplitRunsI(string, len);
+}
+
+
+template <typename T>
+inline void difont::FontCollectionImpl::EndRuns(const T* string)
+{
+    std::vector<T>& text = RunText(string);
+    text.clear();
+
+    for(size_t i = 0; i + 1 < runs.size(); ++i)
+    {
+        runs[i].ended = text.size();
+        text.insert(text.end(), string + runs[i].offset, string + runs[i + 1].offset);
+        text.push_back(0);
+    }
+}
+
+
+template <typename T>
+inline const T* difont::FontCollectionImpl::RunString(const T* string, size_t run)
+{
+    // The last run reads on past the string's length, as a font would.
+    if(run + 1 == runs.size())
+    {
+        return string + runs[run].offset;
+    }
+
+    return &RunText(string)[runs[run].ended];
+}
+
+
+template <typename T>
+inline difont::Point difont::FontCollectionImpl::PlaceRuns(const T* string,
+                                                           difont::Point position,
+                                                           difont::Point spacing)
+{
+    EndRuns(string);
+
+    for(size_t i = 0; i < runs.size(); ++i)
+    {
+        Run& run = runs[i];
+        Font* font = fonts[run.font];
+
+        // An ended run's advance has no spacing after its last character.
+        float advance = font->Advance(RunString(string, i), run.length, spacing);
+        if(i + 1 < runs.size())
+        {
+            advance += spacing.Xf();
+        }
+
+        run.position = position;
+        position += difont::Point(advance, spacing.Yf() * run.spaced);
+        CheckError(font);
+    }
+
+    return position;
+}
+
+
+template <typename T>
+inline difont::BBox difont::FontCollectionImpl::BBoxI(const T* string, const int len,
+                                                      difont::Point position,
+                                                      difont::Point spacing)
+{
+    difont::BBox totalBBox;
+
+    SplitRuns(string, len);
+    PlaceRuns(string, position, spacing);
+
+    for(size_t i = 0; i < runs.size(); ++i)
+    {
+        const Run& run = runs[i];
+        Font* font = fonts[run.font];
+
+        difont::BBox runBBox = font->BBox(RunString(string, i), run.length,
+                                          run.position, spacing);
+        if(i)
+        {
+            totalBBox |= runBBox;
+        }
+        else
+        {
+            totalBBox = runBBox;
+        }
+    }
+
+    return totalBBox;
+}
+
+
+difont::BBox difont::FontCollectionImpl::BBox(const char *string, const int len,
+                                              difont::Point position, difont::Point spacing)
+{
+    return BBoxI(string, len, position, spacing);
+}
+
+
+difont::BBox difont::FontCollectionImpl::BBox(const wchar_t *string, const int len,
+                                              difont::Point position, difont::Point spacing)
+{
+    return BBoxI(string, len, position, spacing);
+}
+
+
+template <typename T>
+inline float difont::FontCollectionImpl::AdvanceI(const T* string, const int len,
+                                                  difont::Point spacing)
+{
+    SplitRuns(string, len);
+    return PlaceRuns(string, difont::Point(), spacing).Xf();
+}
+
+
+float difont::FontCollectionImpl::Advance(const char* string, const int len,
+                                          difont::Point spacing)
+{
+    return AdvanceI(string, len, spacing);
+}
+
+
+float difont::FontCollectionImpl::Advance(const wchar_t* string, const int len,
+                                          difont::Point spacing)
+{
+    return AdvanceI(string, len, spacing);
+}
+
+
+template <typename T>
+inline difont::Point difont::FontCollectionImpl::RenderI(const T* string, const int len,
+                                                         difont::Point position,
+                                                         difont::Point spacing,
+                                                         int renderMode)
+{
+    SplitRuns(string, len);
+
+    if(runs.size() == 1)
+    {
+        Font* font = fonts[runs[0].font];
+        font->PreRender();
+        position = font->Render(string, len, position, spacing, renderMode);
+        font->PostRender();
+        CheckError(font);
+        return position;
+    }
+
+    difont::Point end = PlaceRuns(string, position, spacing);
+
+    // Each font's runs together, so their quads share meshes.
+    for(unsigned int number = 0; number < fonts.size(); ++number)
+    {
+        Font* font = NULL;
+        for(size_t i = 0; i < runs.size(); ++i)
+        {
+            const Run& run = runs[i];
+            if(run.font != number)
+            {
+                continue;
+            }
+
+            if(!font)
+            {
+                font = fonts[number];
+                font->PreRender();
+            }
+
+            font->Render(RunString(string, i), run.length, run.position, spacing,
+                         renderMode);
+        }
+
+        if(font)
+        {
+            font->PostRender();
+            CheckError(font);
+        }
+    }
+
+    return end;
+}
+
+
+difont::Point difont::FontCollectionImpl::Render(const char * string, const int len,
+                                                 difont::Point position, difont::Point spacing,
+                                                 int renderMode)
+{
+    return RenderI(string, len, position, spacing, renderMode);
+}
+
+
+difont::Point difont::FontCollectionImpl::Render(const wchar_t * string, const int len,
+                                                 difont::Point position, difont::Point spacing,
+                                                 int renderMode)
+{
+    return RenderI(string, len, position, spacing, renderMode);
+}
@@ -0,0 +1,225 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_FONT_COLLECTION_IMPL_H_
+#define _DIFONT_FONT_COLLECTION_IMPL_H_
+
+#include <difont/difont.h>
+
+#include <vector>
+
+namespace difont {
+    class FontCollectionImpl {
+        friend class FontCollection;
+
+    protected:
+        FontCollectionImpl();
+
+        virtual ~FontCollectionImpl();
+
+        bool AddFont(Font* font);
+
+        unsigned int FontCount() const
+        {
+            return static_cast<unsigned int>(fonts.size());
+        }
+
+        Font* FontFor(unsigned int charCode)
+        {
+            return fonts.empty() ? NULL : fonts[FontNumber(charCode)];
+        }
+
+        float Ascender() const;
+
+        float Descender() const;
+
+        float LineHeight() const;
+
+        difont::BBox BBox(const char *s, const int len, difont::Point, difont::Point);
+
+        difont::BBox BBox(const wchar_t *s, const int len, difont::Point, difont::Point);
+
+        float Advance(const char *s, const int len, difont::Point);
+
+        float Advance(const wchar_t *s, const int len, difont::Point);
+
+        difont::Point Render(const char *s, const int len,
+                             difont::Point, difont::Point, int);
+
+        difont::Point Render(const wchar_t *s, const int len,
+                             difont::Point, difont::Point, int);
+
+        /**
+         * Current error code. Zero means no error.
+         */
+        FT_Error err;
+
+    private:
+        /**
+         * Get the number of the font that draws a character, asking the
+         * fonts the first time the character is seen.
+         */
+        inline unsigned int FontNumber(unsigned int charCode);
+
+        /**
+         * Find the first font with a glyph for a character and remember
+         * it in the table.
+         */
+        unsigned int Resolve(unsigned int charCode);
+
+        /**
+         * Free the table, when adding a font may change what draws a
+         * character.
+         */
+        void Clear();
+
+        /**
+         * Split a string into runs of characters drawn by one font.
+         * Strings of char are read as UTF-8.
+         */
+        void SplitRuns(const char *s, const int len);
+
+        void SplitRuns(const wchar_t *s, const int len);
+
+        template <typename T>
+        inline void SplitRunsI(const T *s, const int len);
+
+        /**
+         * Copy the runs of a string, each but the last ended by a zero, so
+         * the fonts don't kern the last character of a run against the
+         * first of the next, which another font draws.
+         */
+        template <typename T>
+        inline void EndRuns(const T *s);
+
+        /**
+         * The characters of a run, ended by a zero unless it is the last.
+         */
+        template <typename T>
+        inline const T* RunString(const T *s, size_t run);
+
+        std::vector<char>& RunText(const char*) { return narrowText; }
+
+        std::vector<wchar_t>& RunText(const wchar_t*) { return wideText; }
+
+        /**
+         * Set the pen position of every run, measuring each with its font.
+         *
+         * @return  The pen position after the last run.
+         */
+        template <typename T>
+        inline difont::Point PlaceRuns(const T *s, difont::Point position,
+                                       difont::Point spacing);
+
+        /**
+         * Note a font's error, keeping the last one.
+         */
+        void CheckError(const Font* font)
+        {
+            if(font->Error())
+            {
+                err = font->Error();
+            }
+        }
+
+        /**
+         * The fonts, in the order they are tried
+         */
+        std::vector<Font*> fonts;
+
+        /**
+         * Characters of a string drawn by one font, from
+         * <code>offset</code> elements into the string. Spacing is added
+         * after <code>spaced</code> of them, all but the string's last.
+         * Runs before the last are copied from <code>ended</code> elements
+         * into the run text.
+         */
+        struct Run {
+            unsigned int font;
+            size_t offset;
+            size_t ended;
+            int length;
+            int spaced;
+            difont::Point position;
+        };
+
+        /**
+         * The runs of the last string, kept to reuse their memory
+         */
+        std::vector<Run> runs;
+
+        /**
+         * The runs of the last string, copied by EndRuns()
+         */
+        std::vector<char> narrowText;
+        std::vector<wchar_t> wideText;
+
+        static const unsigned int BLOCK_SIZE = 256;
+        static const unsigned int PLANE_COUNT = 17;
+
+        /**
+         * The font number plus one for each character, zero until it is
+         * resolved, in blocks of 256 for each Unicode plane. Blocks and
+         * planes are <code>NULL</code> until used. Characters past the
+         * last plane are resolved every time.
+         */
+        unsigned char** planes[PLANE_COUNT];
+
+        /* Internal generic BBox() implementation */
+        template <typename T>
+        inline difont::BBox BBoxI(const T *s, const int len,
+                                  difont::Point position, difont::Point spacing);
+
+        /* Internal generic Advance() implementation */
+        template <typename T>
+        inline float AdvanceI(const T *s, const int len, difont::Point spacing);
+
+        /* Internal generic Render() implementation */
+        template <typename T>
+        inline difont::Point RenderI(const T *s, const int len,
+                                     difont::Point position, difont::Point spacing, int mode);
+    };
+
+
+    inline unsigned int FontCollectionImpl::FontNumber(unsigned int charCode)
+    {
+        unsigned int plane = charCode >> 16;
+
+        if(plane < PLANE_COUNT)
+        {
+            unsigned char** blocks = planes[plane];
+            unsigned char* block = blocks ? blocks[(charCode >> 8) & 0xff] : NULL;
+            if(block && block[charCode & 0xff])
+            {
+                return block[charCode & 0xff] - 1;
+            }
+        }
+
+        return Resolve(charCode);
+    }
+}
+
+#endif  //  _DIFONT_FONT_COLLECTION_IMPL_H_
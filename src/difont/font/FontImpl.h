@@ -29,14 +29,23 @@
 
 #include  <difont/difont.h>
 
+#include <list>
+#include <typeinfo>
+
 #include "Face.h"
+#include "GlyphContainer.h"
+#include "GlyphImpl.h"
+#include "Thread.h"
+#include "Unicode.h"
 
 namespace difont {
-    class GlyphContainer;
     class Glyph;
 
     class FontImpl {
         friend class Font;
+        friend class FontCollectionImpl;
+        friend class FrameBudget;
+        friend class TextureFont;
     protected:
         FontImpl(Font *ftFont, char const *fontFilePath);
 
@@ -91,11 +100,114 @@ namespace difont {
         virtual difont::Point Render(const wchar_t *s, const int len,
                                      difont::Point, difont::Point, int);
 
+        difont::BBox BBoxRun(const Font::GlyphRun& run, difont::Point position);
+
+        float AdvanceRun(const Font::GlyphRun& run);
+
+        /**
+         * Render a run of glyphs. Fonts with their own RenderI() call it
+         * with the run as a one-item string, so the run gets the same
+         * rendering state as text.
+         */
+        virtual difont::Point RenderRun(const Font::GlyphRun& run,
+                                        difont::Point position, int renderMode);
+
         virtual void PreRender() {}
 
 
         virtual	void PostRender() {}
 
+        /**
+         * Construct a glyph without loading it from the face, for fonts
+         * that keep their own copy of the glyph data or load it elsewhere.
+         *
+         * @param glyphIndex  The index of the glyph in the face.
+         * @return  A glyph, or <code>NULL</code> if it must be loaded.
+         */
+        virtual Glyph* MakeCachedGlyph(unsigned int glyphIndex) { return NULL; }
+
+        /**
+         * Render a string, calling the glyph implementation's RenderImpl()
+         * directly for glyphs of the font's own type. With T a
+         * Font::GlyphRun, <code>s</code> points to a single run and
+         * <code>len</code> is its glyph count.
+         *
+         * @tparam Impl  The implementation class of the font's glyphs. The
+         *               font must set nativeGlyph to the matching glyph
+         *               class for any glyph to take the direct path.
+         */
+        template <typename T, typename Impl>
+        inline difont::Point RenderGlyphs(const T *s, const int len,
+                                          difont::Point position,
+                                          difont::Point spacing, int mode);
+
+        /**
+         * BBox() for a font that already holds the access lock, in its
+         * Render(). A run is measured without <code>len</code> and
+         * <code>spacing</code>.
+         */
+        difont::BBox BBoxHeld(const char *s, const int len,
+                              difont::Point position, difont::Point spacing);
+
+        difont::BBox BBoxHeld(const wchar_t *s, const int len,
+                              difont::Point position, difont::Point spacing);
+
+        difont::BBox BBoxHeld(const Font::GlyphRun *run, const int len,
+                              difont::Point position, difont::Point spacing);
+
+        /**
+         * Read the metrics of every loaded glyph again, for fonts that
+         * finish glyphs after they have been added.
+         */
+        void RefreshGlyphMetrics();
+
+        /**
+         * The most face sizes whose glyphs are kept, so switching back to
+         * one of them doesn't make its glyphs again.
+         */
+        static const unsigned int MAX_SIZES = 4;
+
+        /**
+         * Delete the glyphs of the sizes kept, for fonts whose glyphs go
+         * stale or use the font in their destructors.
+         *
+         * @param keepCurrent  <code>true</code> to keep the current size's.
+         */
+        void ForgetSizes(bool keepCurrent);
+
+        /**
+         * Delete the current size's glyphs a test picks, keeping their
+         * metrics. See GlyphContainer::EvictIf().
+         *
+         * @return  The number of glyphs deleted.
+         */
+        unsigned int EvictGlyphs(bool (*test)(const GlyphImpl* impl, void* context),
+                                 void* context);
+
+        /**
+         * Glyph cache budget and counters, kept when the size changes.
+         */
+        void GlyphCacheBudget(size_t bytes);
+
+        Font::GlyphCacheStats GlyphCacheStatistics() const;
+
+        /**
+         * Whether the face has a glyph for a character, other than the
+         * missing glyph.
+         */
+        bool HasGlyph(const unsigned int chr);
+
+        /**
+         * Create or delete the lock that lets several threads measure
+         * text at once. See Font::ConcurrentMeasurement().
+         */
+        void ConcurrentMeasurement(bool enable);
+
+        /**
+         * Get the interface of which we are the implementation.
+         */
+        Font* Interface() const { return intf; }
+
         /**
          * Current face object
          */
@@ -118,11 +230,25 @@ namespace difont {
          */
         FT_Int load_flags;
 
+        /**
+         * The exact glyph class MakeGlyph() returns, or <code>NULL</code>
+         * to render every glyph through the virtual Glyph interface.
+         */
+        const std::type_info* nativeGlyph;
+
         /**
          * Current error code. Zero means no error.
          */
         FT_Error err;
 
+        /**
+         * Held by every call through the font's interface while concurrent
+         * measurement is on: shared to measure text whose glyph metrics
+         * are all known, exclusively for anything else. <code>NULL</code>
+         * while it is off.
+         */
+        difont::SharedMutex* accessLock;
+
     private:
         /**
          * A link back to the interface of which we are the implementation.
@@ -133,15 +259,135 @@ namespace difont {
          * Check that the glyph at <code>chr</code> exist. If not load it.
          *
          * @param chr  character index
-         * @return <code>true</code> if the glyph can be created.
+         * @return  The slot, or zero if the glyph can't be created.
          */
-        bool CheckGlyph(const unsigned int chr);
+        inline unsigned int GlyphSlot(const unsigned int chr);
+
+        /**
+         * Check that the metrics of the glyph at <code>chr</code> are known.
+         * If not read them from the outline, without building a glyph.
+         *
+         * @param chr     character index
+         * @param missed  if not <code>NULL</code>, set instead of loading
+         *                missing metrics, so nothing is changed.
+         * @return  The slot, or zero if the glyph can't be loaded.
+         */
+        inline unsigned int MetricsSlot(const unsigned int chr, bool* missed);
+
+        /**
+         * Create, load or defer the glyph for a character without one.
+         *
+         * @return  The slot, or zero on failure.
+         */
+        unsigned int AddGlyph(const unsigned int chr);
+
+        /**
+         * Read the metrics of a character not yet in the container.
+         *
+         * @return  The slot, or zero on failure.
+         */
+        unsigned int AddMetrics(const unsigned int chr);
+
+        /**
+         * As GlyphSlot() and MetricsSlot(), for a glyph picked by its index
+         * in the face.
+         */
+        inline unsigned int FontIndexGlyphSlot(const unsigned int glyphIndex);
+
+        inline unsigned int FontIndexMetricsSlot(const unsigned int glyphIndex,
+                                                 bool* missed);
+
+        /**
+         * Create, load or defer the glyph for a slot without one, or for a
+         * new slot if <code>slot</code> is zero.
+         *
+         * @param slot         The slot, or zero.
+         * @param glyphIndex   The glyph's index in the face.
+         * @param code         The character code, or the glyph index for a
+         *                     glyph added by index.
+         * @param byFontIndex  Whether a new slot is found by glyph index
+         *                     rather than character code.
+         * @return  The slot, or zero on failure.
+         */
+        unsigned int FillSlot(unsigned int slot, const unsigned int glyphIndex,
+                              const unsigned int code, bool byFontIndex);
+
+        /**
+         * Read the metrics of a glyph index not yet in the container.
+         *
+         * @return  The slot, or zero on failure.
+         */
+        unsigned int AddFontIndexMetrics(const unsigned int glyphIndex);
+
+        /**
+         * The kerned advance of the glyph in a slot. With
+         * <code>missed</code>, as for MetricsSlot().
+         */
+        inline float SlotAdvance(const unsigned int slot,
+                                 const unsigned int nextChr,
+                                 bool* missed);
+
+        /**
+         * Whether a glyph is exactly of the font's own glyph class.
+         */
+        bool IsNativeGlyph(const Glyph* glyph) const
+        {
+            return nativeGlyph && typeid(*glyph) == *nativeGlyph;
+        }
+
+        /**
+         * Render the glyph in a slot, directly if it is of type Impl.
+         */
+        template <typename Impl>
+        static inline const difont::Point& RenderSlot(GlyphContainer* glyphs,
+                                                      unsigned int slot,
+                                                      const difont::Point& pen,
+                                                      int mode);
+
+        /**
+         * Load a glyph from the face and make a glyph of the font's type.
+         *
+         * @return  The glyph, or <code>NULL</code> on failure.
+         */
+        Glyph* LoadGlyph(unsigned int glyphIndex);
+
+        /**
+         * Replace the placeholder for a glyph deferred by the frame budget.
+         *
+         * @param code         The character code, or the glyph index.
+         * @param byFontIndex  Whether <code>code</code> is a glyph index.
+         */
+        void FinishGlyph(const unsigned int code, bool byFontIndex);
 
         /**
          * An object that holds a list of glyphs
          */
         GlyphContainer* glyphList;
 
+        /**
+         * A recently used face size, with its FreeType size and glyphs.
+         */
+        struct SizeState {
+            unsigned int size;
+            unsigned int res;
+            difont::Size charSize;
+            GlyphContainer* glyphList;
+        };
+
+        /**
+         * The sizes kept, the current one first.
+         */
+        std::list<SizeState> sizes;
+
+        /**
+         * The glyph cache budget in bytes, and the glyphs found, made and
+         * deleted to stay within the budgets.
+         */
+        size_t cacheBudget;
+        unsigned long cacheHits;
+        unsigned long cacheMisses;
+        unsigned long cacheEvictions;
+
         /**
          * Current pen or cursor position;
          */
@@ -151,16 +397,246 @@ namespace difont {
         template <typename T>
         inline difont::BBox BBoxI(const T *s, const int len,
                                   difont::Point position, difont::Point spacing);
+
+        template <typename T>
+        inline difont::BBox MeasureBBox(const T *s, const int len,
+                                        difont::Point position, difont::Point spacing,
+                                        bool* missed);
         
         /* Internal generic Advance() implementation */
         template <typename T>
         inline float AdvanceI(const T *s, const int len, difont::Point spacing);
+
+        template <typename T>
+        inline float MeasureAdvance(const T *s, const int len, difont::Point spacing,
+                                    bool* missed);
         
         /* Internal generic Render() implementation */
         template <typename T>
         inline difont::Point RenderI(const T *s, const int len,
                                      difont::Point position, difont::Point spacing, int mode);
+
+        /**
+         * Measure a run, as for MeasureBBox(). The bounds are only found
+         * if <code>bBox</code> isn't <code>NULL</code>.
+         *
+         * @return  The pen position after the run.
+         */
+        difont::Point MeasureRun(const Font::GlyphRun& run, difont::Point position,
+                                 difont::BBox* bBox, bool* missed);
+
+        /**
+         * Measure a run, under the shared lock if its glyphs are known.
+         */
+        difont::Point MeasureRunI(const Font::GlyphRun& run, difont::Point position,
+                                  difont::BBox* bBox);
+
+        /* The loops behind RenderGlyphs(), for text and for glyph runs */
+        template <typename Impl, typename T>
+        inline difont::Point RenderSequence(const T *s, const int len,
+                                            difont::Point position,
+                                            difont::Point spacing, int mode);
+
+        template <typename Impl>
+        inline difont::Point RenderSequence(const Font::GlyphRun *run, const int len,
+                                            difont::Point position,
+                                            difont::Point spacing, int mode);
     };
+
+
+    inline unsigned int FontImpl::GlyphSlot(const unsigned int chr)
+    {
+        unsigned int slot = glyphList->Slot(chr);
+        if(slot && glyphList->SlotGlyph(slot))
+        {
+            ++cacheHits;
+            glyphList->Touch(slot);
+            return slot;
+        }
+
+        return AddGlyph(chr);
+    }
+
+
+    inline unsigned int FontImpl::FontIndexGlyphSlot(const unsigned int glyphIndex)
+    {
+        unsigned int slot = glyphList->FontIndexSlot(glyphIndex);
+        if(slot && glyphList->SlotGlyph(slot))
+        {
+            ++cacheHits;
+            glyphList->Touch(slot);
+            return slot;
+        }
+
+        if(glyphIndex >= face.GlyphCount())
+        {
+            return 0;
+        }
+
+        // The first glyph by index starts the index of the slots.
+        glyphList->IndexFontIndices();
+        return FillSlot(glyphList->FontIndexSlot(glyphIndex), glyphIndex,
+                        glyphIndex, true);
+    }
+
+
+    inline unsigned int FontImpl::FontIndexMetricsSlot(const unsigned int glyphIndex,
+                                                       bool* missed)
+    {
+        unsigned int slot = glyphList->FontIndexSlot(glyphIndex);
+        if(slot || glyphIndex >= face.GlyphCount())
+        {
+            return slot;
+        }
+
+        if(missed)
+        {
+            *missed = true;
+            return 0;
+        }
+
+        return AddFontIndexMetrics(glyphIndex);
+    }
+
+
+    inline unsigned int FontImpl::MetricsSlot(const unsigned int chr,
+                                              bool* missed)
+    {
+        unsigned int slot = glyphList->Slot(chr);
+        if(slot || !missed)
+        {
+            return slot ? slot : AddMetrics(chr);
+        }
+
+        *missed = true;
+        return 0;
+    }
+
+
+    inline float FontImpl::SlotAdvance(const unsigned int slot,
+                                       const unsigned int nextChr,
+                                       bool* missed)
+    {
+        unsigned int nextIndex;
+        if(!missed)
+        {
+            nextIndex = glyphList->FontIndex(nextChr);
+        }
+        else if(!glyphList->KnownFontIndex(nextChr, nextIndex))
+        {
+            *missed = true;
+            return 0.0f;
+        }
+
+        return face.KernAdvance(glyphList->SlotFontIndex(slot), nextIndex).Xf()
+               + glyphList->SlotAdvance(slot);
+    }
+
+
+    template <typename Impl>
+    inline const difont::Point& FontImpl::RenderSlot(GlyphContainer* glyphs,
+                                                     unsigned int slot,
+                                                     const difont::Point& pen,
+                                                     int mode)
+    {
+        GlyphImpl* impl = glyphs->SlotImpl(slot);
+        if(impl)
+        {
+            // Qualified, so the call isn't virtual.
+            return static_cast<Impl*>(impl)->Impl::RenderImpl(pen, mode);
+        }
+
+        return glyphs->SlotGlyph(slot)->Render(pen, mode);
+    }
+
+
+    template <>
+    inline const difont::Point& FontImpl::RenderSlot<GlyphImpl>(GlyphContainer* glyphs,
+                                                                unsigned int slot,
+                                                                const difont::Point& pen,
+                                                                int mode)
+    {
+        return glyphs->SlotGlyph(slot)->Render(pen, mode);
+    }
+
+
+    template <typename T, typename Impl>
+    inline difont::Point FontImpl::RenderGlyphs(const T* string, const int len,
+                                                difont::Point position,
+                                                difont::Point spacing,
+                                                int renderMode)
+    {
+        return RenderSequence<Impl>(string, len, position, spacing, renderMode);
+    }
+
+
+    template <typename Impl, typename T>
+    inline difont::Point FontImpl::RenderSequence(const T* string, const int len,
+                                                  difont::Point position,
+                                                  difont::Point spacing,
+                                                  int renderMode)
+    {
+        // for multibyte - we can't rely on sizeof(T) == character
+        FTUnicodeStringItr<T> ustr(string);
+
+        for(int i = 0; (len < 0 && *ustr) || (len >= 0 && i < len); i++)
+        {
+            unsigned int thisChar = *ustr++;
+            unsigned int nextChar = *ustr;
+
+            unsigned int slot = GlyphSlot(thisChar);
+            if(slot)
+            {
+                // A pair that can't be kerned isn't kerned, the glyph is
+                // still drawn. The face's error may be from anything.
+                difont::Point kernAdvance =
+                    face.KernAdvance(glyphList->SlotFontIndex(slot),
+                                     glyphList->FontIndex(nextChar));
+
+                kernAdvance += RenderSlot<Impl>(glyphList, slot,
+                                                position, renderMode);
+
+                position += kernAdvance;
+            }
+
+            if(nextChar)
+            {
+                position += spacing;
+            }
+        }
+
+        return position;
+    }
+
+
+    template <typename Impl>
+    inline difont::Point FontImpl::RenderSequence(const Font::GlyphRun* run,
+                                                  const int len,
+                                                  difont::Point position,
+                                                  difont::Point spacing,
+                                                  int renderMode)
+    {
+        for(int i = 0; i < len; i++)
+        {
+            difont::Point advance;
+
+            unsigned int slot = FontIndexGlyphSlot(run->glyphs[i]);
+            if(slot)
+            {
+                difont::Point pen = position;
+                if(run->offsets)
+                {
+                    pen += run->offsets[i];
+                }
+
+                advance = RenderSlot<Impl>(glyphList, slot, pen, renderMode);
+            }
+
+            position += run->advances ? run->advances[i] : advance;
+        }
+
+        return position;
+    }
 }
 
 #endif  //  __FontImpl__
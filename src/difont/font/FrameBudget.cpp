@@ -0,0 +1,212 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "FrameBudget.h"
+#include "FontImpl.h"
+#include "Thread.h"
+
+#if defined(_WIN32)
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#elif defined(__APPLE__)
+#   include <mach/mach_time.h>
+#else
+#   include <time.h>
+#endif
+
+using namespace difont;
+
+
+unsigned int FrameBudget::glyphLimit = 0;
+uint64_t FrameBudget::timeLimit = 0;
+unsigned int FrameBudget::glyphsSpent = 0;
+uint64_t FrameBudget::timeSpent = 0;
+std::deque<FrameBudget::DeferredGlyph> FrameBudget::deferred;
+FontImpl *FrameBudget::finishing = NULL;
+
+
+static Mutex& BudgetMutex()
+{
+    static Mutex mutex;
+    return mutex;
+}
+
+
+/**
+ * Signalled when BeginFrame() has finished a glyph.
+ */
+static Condition& GlyphFinished()
+{
+    static Condition condition;
+    return condition;
+}
+
+
+/**
+ * A monotonic clock in microseconds.
+ */
+static uint64_t Microseconds()
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    if(!frequency.QuadPart)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return static_cast<uint64_t>(now.QuadPart * 1000000 / frequency.QuadPart);
+#elif defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+    if(!timebase.denom)
+    {
+        mach_timebase_info(&timebase);
+    }
+
+    return mach_absolute_time() * timebase.numer / timebase.denom / 1000;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+#endif
+}
+
+
+void FrameBudget::Limit(unsigned int glyphs, unsigned int microseconds)
+{
+    MutexLock lock(BudgetMutex());
+    glyphLimit = glyphs;
+    timeLimit = microseconds;
+}
+
+
+void FrameBudget::BeginFrame()
+{
+    MutexLock lock(BudgetMutex());
+    glyphsSpent = 0;
+    timeSpent = 0;
+
+    while(!deferred.empty() && InBudget())
+    {
+        DeferredGlyph glyph = deferred.front();
+        deferred.pop_front();
+
+        // Finished without the lock, as it spends the budget and takes
+        // the font's lock. ForgetFont() waits for it meanwhile.
+        finishing = glyph.font;
+        BudgetMutex().Unlock();
+        glyph.font->FinishGlyph(glyph.code, glyph.byFontIndex);
+        BudgetMutex().Lock();
+        finishing = NULL;
+        GlyphFinished().Broadcast();
+    }
+}
+
+
+unsigned int FrameBudget::EndFrame()
+{
+    MutexLock lock(BudgetMutex());
+    return static_cast<unsigned int>(deferred.size());
+}
+
+
+bool FrameBudget::Available()
+{
+    MutexLock lock(BudgetMutex());
+    return InBudget();
+}
+
+
+bool FrameBudget::InBudget()
+{
+    return (!glyphLimit || glyphsSpent < glyphLimit)
+        && (!timeLimit || timeSpent < timeLimit);
+}
+
+
+uint64_t FrameBudget::Start()
+{
+    MutexLock lock(BudgetMutex());
+    return timeLimit ? Microseconds() : 0;
+}
+
+
+void FrameBudget::Spend(uint64_t start)
+{
+    // Read the clock before waiting for the lock.
+    uint64_t now = start ? Microseconds() : 0;
+
+    MutexLock lock(BudgetMutex());
+    ++glyphsSpent;
+
+    if(timeLimit && start)
+    {
+        timeSpent += now - start;
+    }
+}
+
+
+void FrameBudget::Defer(FontImpl *font, unsigned int code, bool byFontIndex)
+{
+    DeferredGlyph glyph;
+    glyph.font = font;
+    glyph.code = code;
+    glyph.byFontIndex = byFontIndex;
+
+    MutexLock lock(BudgetMutex());
+    deferred.push_back(glyph);
+}
+
+
+void FrameBudget::Forget(FontImpl *font)
+{
+    MutexLock lock(BudgetMutex());
+    std::deque<DeferredGlyph>::iterator it = deferred.begin();
+    while(it != deferred.end())
+    {
+        if(it->font == font)
+        {
+            it = deferred.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+
+void FrameBudget::ForgetFont(FontImpl *font)
+{
+    Forget(font);
+
+    MutexLock lock(BudgetMutex());
+    while(finishing == font)
+    {
+        GlyphFinished().Wait(BudgetMutex());
+    }
+}
@@ -0,0 +1,131 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_FRAME_BUDGET_H_
+#define _DIFONT_FRAME_BUDGET_H_
+
+#include <deque>
+#include <stdint.h>
+
+namespace difont {
+    class FontImpl;
+
+    /**
+     * FrameBudget limits how many glyphs all fonts load on the render
+     * thread each frame. Glyphs over the limit are made placeholders and
+     * deferred; BeginFrame() finishes them, oldest first, in later frames.
+     *
+     * Without a limit (the default) every glyph is loaded when it is first
+     * needed.
+     *
+     * The budget is shared by fonts on every thread, so its state is
+     * guarded by a lock. The lock is never held while a font loads a
+     * glyph, so it can't be taken out of order with a font's own lock.
+     */
+    class FrameBudget {
+    public:
+        /**
+         * Set the limits. Zero means no limit.
+         */
+        static void Limit(unsigned int glyphs, unsigned int microseconds);
+
+        /**
+         * Reset the budget and spend it on the deferred glyphs.
+         */
+        static void BeginFrame();
+
+        /**
+         * @return  The number of glyphs still deferred.
+         */
+        static unsigned int EndFrame();
+
+        /**
+         * Check if a glyph may be loaded now.
+         */
+        static bool Available();
+
+        /**
+         * Get a time to pass to <code>Spend</code> once a glyph is loaded.
+         */
+        static uint64_t Start();
+
+        /**
+         * Count a glyph loaded since <code>start</code>.
+         */
+        static void Spend(uint64_t start);
+
+        /**
+         * Defer a glyph to a later frame.
+         *
+         * @param byFontIndex  Whether <code>code</code> is a glyph index
+         *                     rather than a character code.
+         */
+        static void Defer(FontImpl *font, unsigned int code,
+                          bool byFontIndex = false);
+
+        /**
+         * Drop the deferred glyphs of a font, which is about to discard
+         * or has discarded its glyphs. A glyph BeginFrame() is already
+         * finishing may still be finished; FinishGlyph() ignores it if its
+         * placeholder is gone.
+         */
+        static void Forget(FontImpl *font);
+
+        /**
+         * Drop the deferred glyphs of a font that is being deleted, and
+         * wait for BeginFrame() to finish a glyph of it on another thread.
+         * The caller mustn't hold the font's lock, which that glyph needs.
+         */
+        static void ForgetFont(FontImpl *font);
+
+    private:
+        /**
+         * Available() for a caller holding the lock.
+         */
+        static bool InBudget();
+
+        struct DeferredGlyph {
+            FontImpl *font;
+            unsigned int code;
+            bool byFontIndex;
+        };
+
+        static unsigned int glyphLimit;
+        static uint64_t timeLimit;
+
+        static unsigned int glyphsSpent;
+        static uint64_t timeSpent;
+
+        static std::deque<DeferredGlyph> deferred;
+
+        /**
+         * The font BeginFrame() is finishing a glyph of, if any.
+         */
+        static FontImpl *finishing;
+    };
+}
+
+#endif  //  _DIFONT_FRAME_BUDGET_H_
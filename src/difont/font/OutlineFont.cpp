@@ -27,7 +27,9 @@
 #include  <difont/difont.h>
 
 #include "Internals.h"
+#include "FrameBudget.h"
 #include "OutlineFontImpl.h"
+#include "OutlineGlyphImpl.h"
 
 using namespace difont;
 
@@ -43,7 +45,11 @@ OutlineFont::OutlineFont(const unsigned char *pBufferBytes,
 
 
 OutlineFont::~OutlineFont()
-{}
+{
+    // Before the vtable is unwound: BeginFrame() may be making one of
+    // this font's glyphs on another thread.
+    difont::FrameBudget::ForgetFont(impl);
+}
 
 
 Glyph* OutlineFont::MakeGlyph(FT_GlyphSlot ftGlyph)
@@ -69,6 +75,7 @@ OutlineFontImpl::OutlineFontImpl(Font *ftFont, const char* fontFilePath)
   outset(0.0f)
 {
     load_flags = FT_LOAD_NO_HINTING;
+    nativeGlyph = &typeid(OutlineGlyph);
 	preRendered = false;
 }
 
@@ -80,6 +87,7 @@ OutlineFontImpl::OutlineFontImpl(Font *ftFont,
   outset(0.0f)
 {
     load_flags = FT_LOAD_NO_HINTING;
+    nativeGlyph = &typeid(OutlineGlyph);
 	preRendered = false;
 }
 
@@ -94,13 +102,13 @@ inline difont::Point OutlineFontImpl::RenderI(const T* string, const int len,
     difont::FontMeshSet::AddMesh(GL_LINES);
 	if (preRendered)
 	{
-		tmp = FontImpl::Render(string, len,
+		tmp = RenderGlyphs<T, OutlineGlyphImpl>(string, len,
 										 position, spacing, renderMode);
 	}
 	else 
 	{
 		PreRender();
-		tmp = FontImpl::Render(string, len,
+		tmp = RenderGlyphs<T, OutlineGlyphImpl>(string, len,
 										 position, spacing, renderMode);
 		PostRender();
 	}
@@ -136,3 +144,10 @@ difont::Point OutlineFontImpl::Render(const wchar_t * string, const int len,
     return RenderI(string, len, position, spacing, renderMode);
 }
 
+
+difont::Point OutlineFontImpl::RenderRun(const Font::GlyphRun& run,
+                                         difont::Point position, int renderMode)
+{
+    return RenderI(&run, run.count, position, difont::Point(), renderMode);
+}
+
@@ -57,6 +57,9 @@ namespace difont {
                                      difont::Point position, difont::Point spacing,
                                      int renderMode);
 
+        virtual difont::Point RenderRun(const Font::GlyphRun& run,
+                                        difont::Point position, int renderMode);
+
 
 
     private:
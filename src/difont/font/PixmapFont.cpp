@@ -27,7 +27,9 @@
 #include  <difont/difont.h>
 
 #include "Internals.h"
+#include "FrameBudget.h"
 #include "PixmapFontImpl.h"
+#include "PixmapGlyphImpl.h"
 
 
 //
@@ -48,7 +50,11 @@ difont::PixmapFont::PixmapFont(const unsigned char *pBufferBytes,
 
 
 difont::PixmapFont::~PixmapFont()
-{}
+{
+    // Before the vtable is unwound: BeginFrame() may be making one of
+    // this font's glyphs on another thread.
+    difont::FrameBudget::ForgetFont(impl);
+}
 
 
 difont::Glyph* difont::PixmapFont::MakeGlyph(FT_GlyphSlot ftGlyph)
@@ -66,6 +72,7 @@ difont::PixmapFontImpl::PixmapFontImpl(difont::Font *ftFont, const char* fontFil
 : FontImpl(ftFont, fontFilePath)
 {
     load_flags = FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP;
+    nativeGlyph = &typeid(PixmapGlyph);
 }
 
 
@@ -75,6 +82,7 @@ difont::PixmapFontImpl::PixmapFontImpl(difont::Font *ftFont,
 : FontImpl(ftFont, pBufferBytes, bufferSizeInBytes)
 {
     load_flags = FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP;
+    nativeGlyph = &typeid(PixmapGlyph);
 }
 
 
@@ -104,8 +112,8 @@ inline difont::Point PixmapFontImpl::RenderI(const T* string, const int len,
     glPixelTransferf(GL_BLUE_SCALE, ftglColour[2]);
     glPixelTransferf(GL_ALPHA_SCALE, ftglColour[3]);
 */
-    difont::Point tmp = FontImpl::Render(string, len,
-                                     position, spacing, renderMode);
+    difont::Point tmp = RenderGlyphs<T, PixmapGlyphImpl>(string, len,
+                                                       position, spacing, renderMode);
 
 	/*
     glPopClientAttrib();
@@ -130,3 +138,10 @@ difont::Point difont::PixmapFontImpl::Render(const wchar_t * string, const int l
     return RenderI(string, len, position, spacing, renderMode);
 }
 
+
+difont::Point difont::PixmapFontImpl::RenderRun(const Font::GlyphRun& run,
+                                                difont::Point position, int renderMode)
+{
+    return RenderI(&run, run.count, position, difont::Point(), renderMode);
+}
+
@@ -27,6 +27,7 @@
 #include  <difont/difont.h>
 
 #include "Internals.h"
+#include "FrameBudget.h"
 #include "PolygonFontImpl.h"
 
 
@@ -47,7 +48,11 @@ Font(new PolygonFontImpl(this, pBufferBytes, bufferSizeInBytes))
 
 
 difont::PolygonFont::~PolygonFont()
-{}
+{
+    // Before the vtable is unwound: BeginFrame() may be making one of
+    // this font's glyphs on another thread.
+    difont::FrameBudget::ForgetFont(impl);
+}
 
 
 difont::Glyph* difont::PolygonFont::MakeGlyph(FT_GlyphSlot ftGlyph)
@@ -24,12 +24,20 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <cassert>
 #include <string> // For memset
+#include <string.h>
 
 #include  <difont/difont.h>
 
 #include "Internals.h"
+#include "BlockEncoder.h"
+#include "FrameBudget.h"
+#include "Hash.h"
+#include "LcdRasterizer.h"
+#include "MappedFile.h"
+#include "SpanRasterizer.h"
 
 #include "../glyph/TextureGlyphImpl.h"
 #include "./TextureFontImpl.h"
@@ -52,7 +60,172 @@ difont::TextureFont::TextureFont(const unsigned char *pBufferBytes,
 
 
 difont::TextureFont::~TextureFont()
-{}
+{
+    // Before the vtable is unwound: BeginFrame() may be making one of
+    // this font's glyphs on another thread.
+    difont::FrameBudget::ForgetFont(impl);
+}
+
+
+void difont::TextureFont::SubpixelPhases(unsigned int phases)
+{
+    difont::SharedMutexLock lock(impl->accessLock);
+    difont::TextureFontImpl *myimpl = dynamic_cast<difont::TextureFontImpl *>(impl);
+    if(myimpl)
+    {
+        myimpl->SubpixelPhases(phases);
+    }
+}
+
+
+void difont::TextureFont::CacheDirectory(const char* path)
+{
+    difont::SharedMutexLock lock(impl->accessLock);
+    difont::TextureFontImpl *myimpl = dynamic_cast<difont::TextureFontImpl *>(impl);
+    if(myimpl)
+    {
+        myimpl->CacheDirectory(path);
+    }
+}
+
+
+void difont::TextureFont::AsyncRasterization(unsigned int threads,
+                                             GlyphsReadyCallback callback,
+                                             void *userData)
+{
+    difont::SharedMutexLock lock(impl->accessLock);
+    difont::TextureFontImpl *myimpl = dynamic_cast<difont::TextureFontImpl *>(impl);
+    if(myimpl)
+    {
+        myimpl->AsyncRasterization(threads, callback, userData);
+    }
+}
+
+
+unsigned int difont::TextureFont::MipmapLevels(unsigned int levels)
+{
+    difont::SharedMutexLock lock(impl->accessLock);
+    difont::TextureFontImpl *myimpl = dynamic_cast<difont::TextureFontImpl *>(impl);
+    if(!myimpl)
+    {
+        return 0;
+    }
+
+    return myimpl->MipmapLevels(levels);
+}
+
+
+void difont::TextureFont::Flush()
+{
+    difont::SharedMutexLock lock(impl->accessLock);
+    difont::TextureFontImpl *myimpl = dynamic_cast<difont::TextureFontImpl *>(impl);
+    if(myimpl)
+    {
+        myimpl->Flush();
+    }
+}
+
+
+bool difont::TextureFont::TextureArrayPages(bool useArray)
+{
+    difont::SharedMutexLock lock(impl->accessLock);
+    difont::TextureFontImpl *myimpl = dynamic_cast<difont::TextureFontImpl *>(impl);
+    if(!myimpl)
+    {
+        return false;
+    }
+
+    return myimpl->TextureArrayPages(useArray);
+}
+
+
+bool difont::TextureFont::CompressedPages(bool compress)
+{
+    difont::SharedMutexLock lock(impl->accessLock);
+    difont::TextureFontImpl *myimpl = dynamic_cast<difont::TextureFontImpl *>(impl);
+    if(!myimpl)
+    {
+        return false;
+    }
+
+    return myimpl->CompressedPages(compress);
+}
+
+
+bool difont::TextureFont::LcdRendering(bool enable, const unsigned char *filter)
+{
+    difont::SharedMutexLock lock(impl->accessLock);
+    difont::TextureFontImpl *myimpl = dynamic_cast<difont::TextureFontImpl *>(impl);
+    if(!myimpl)
+    {
+        return false;
+    }
+
+    return myimpl->LcdRendering(enable, filter);
+}
+
+
+void difont::TextureFont::SizeBuckets(float ratio)
+{
+    difont::SharedMutexLock lock(impl->accessLock);
+    difont::TextureFontImpl *myimpl = dynamic_cast<difont::TextureFontImpl *>(impl);
+    if(myimpl)
+    {
+        myimpl->SizeBuckets(ratio, NULL, 0);
+    }
+}
+
+
+void difont::TextureFont::SizeBuckets(const unsigned int *sizes, unsigned int count)
+{
+    difont::SharedMutexLock lock(impl->accessLock);
+    difont::TextureFontImpl *myimpl = dynamic_cast<difont::TextureFontImpl *>(impl);
+    if(myimpl)
+    {
+        myimpl->SizeBuckets(0.0f, sizes, count);
+    }
+}
+
+
+difont::TextureFont::AtlasStats difont::TextureFont::AtlasOccupancy()
+{
+    difont::SharedMutexLock lock(impl->accessLock);
+    difont::TextureFontImpl *myimpl = dynamic_cast<difont::TextureFontImpl *>(impl);
+    if(!myimpl)
+    {
+        AtlasStats stats = { 0, 0, 0, 0 };
+        return stats;
+    }
+
+    return myimpl->AtlasOccupancy();
+}
+
+
+difont::TextureFont::CompactionStats difont::TextureFont::Compact(unsigned int maxPages)
+{
+    difont::SharedMutexLock lock(impl->accessLock);
+    difont::TextureFontImpl *myimpl = dynamic_cast<difont::TextureFontImpl *>(impl);
+    if(!myimpl)
+    {
+        CompactionStats stats = { { 0, 0, 0, 0 }, { 0, 0, 0, 0 } };
+        return stats;
+    }
+
+    return myimpl->Compact(maxPages);
+}
+
+
+bool difont::TextureFont::SaveCache()
+{
+    difont::SharedMutexLock lock(impl->accessLock);
+    difont::TextureFontImpl *myimpl = dynamic_cast<difont::TextureFontImpl *>(impl);
+    if(!myimpl)
+    {
+        return false;
+    }
+
+    return myimpl->SaveCache();
+}
 
 
 difont::Glyph* difont::TextureFont::MakeGlyph(FT_GlyphSlot ftGlyph)
@@ -86,6 +259,30 @@ static inline GLuint NextPowerOf2(GLuint in)
 }
 
 
+// Compressed pages need a single channel block format and a swizzle to
+// read its red channel as alpha.
+#if defined(GL_TEXTURE_SWIZZLE_A) && defined(GL_COMPRESSED_RED_RGTC1)
+#define DIFONT_COMPRESSED_FORMAT GL_COMPRESSED_RED_RGTC1
+#define DIFONT_COMPRESSED_BLOCKS difont::BlockEncoder::BC4
+#elif defined(GL_TEXTURE_SWIZZLE_A) && defined(GL_COMPRESSED_R11_EAC)
+#define DIFONT_COMPRESSED_FORMAT GL_COMPRESSED_R11_EAC
+#define DIFONT_COMPRESSED_BLOCKS difont::BlockEncoder::EAC_R11
+#endif
+
+
+static inline int AlignUp(int in, int alignment)
+{
+    return (in + alignment - 1) & ~(alignment - 1);
+}
+
+
+static inline GLsizei LevelSize(GLsizei size, unsigned int level)
+{
+    size >>= level;
+    return size ? size : 1;
+}
+
+
 difont::TextureFontImpl::TextureFontImpl(Font *ftFont, const char* fontFilePath)
 :   FontImpl(ftFont, fontFilePath),
     maximumGLTextureSize(0),
@@ -95,9 +292,26 @@ difont::TextureFontImpl::TextureFontImpl(Font *ftFont, const char* fontFilePath)
     glyphWidth(0),
     padding(3),
     xOffset(0),
-    yOffset(0)
+    yOffset(0),
+    shelfHeight(0),
+    subpixelPhases(1),
+    resolution(72),
+    bucketRatio(0.0f),
+    rasterSize(0),
+    quadScale(1.0f),
+    mipmapLevels(0),
+    arrayPages(false),
+    arrayLayers(0),
+    compressedPages(false),
+    channels(1),
+    workers(NULL),
+    generation(0),
+    readyCallback(NULL),
+    readyUserData(NULL),
+    cacheDirty(false)
 {
     load_flags = FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP;
+    nativeGlyph = &typeid(TextureGlyph);
     remGlyphs = numGlyphs = face.GlyphCount();
 	preRendered = false;
 }
@@ -114,147 +328,2095 @@ difont::TextureFontImpl::TextureFontImpl(Font *ftFont,
     glyphWidth(0),
     padding(3),
     xOffset(0),
-    yOffset(0)
+    yOffset(0),
+    shelfHeight(0),
+    subpixelPhases(1),
+    resolution(72),
+    bucketRatio(0.0f),
+    rasterSize(0),
+    quadScale(1.0f),
+    mipmapLevels(0),
+    arrayPages(false),
+    arrayLayers(0),
+    compressedPages(false),
+    channels(1),
+    workers(NULL),
+    generation(0),
+    readyCallback(NULL),
+    readyUserData(NULL),
+    cacheDirty(false)
 {
     load_flags = FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP;
+    nativeGlyph = &typeid(TextureGlyph);
     remGlyphs = numGlyphs = face.GlyphCount();
 }
 
 
 difont::TextureFontImpl::~TextureFontImpl()
 {
-    if(textureIDList.size())
+    delete workers;
+
+    // The glyphs reach back into the font as they go.
+    ForgetSizes(false);
+
+    SaveCache();
+    ReleaseTextures();
+    ReleaseStashedAtlases();
+}
+
+
+difont::Glyph* difont::TextureFontImpl::MakeGlyphImpl(FT_GlyphSlot ftGlyph)
+{
+    TextureGlyph* tempGlyph = new TextureGlyph(ftGlyph, this, face.GlyphIndex());
+
+	--remGlyphs;
+
+    return tempGlyph;
+}
+
+
+difont::Glyph* difont::TextureFontImpl::MakeCachedGlyph(unsigned int glyphIndex)
+{
+    // With background rasterisation the glyph waits for its bitmap.
+    if(FindRegion(glyphIndex, 0) < 0 && !workers)
     {
-        glDeleteTextures((GLsizei)textureIDList.size(),
-                         (const GLuint*)&textureIDList[0]);
+        return NULL;
     }
+
+    return new TextureGlyph(this, glyphIndex);
 }
 
 
-difont::Glyph* difont::TextureFontImpl::MakeGlyphImpl(FT_GlyphSlot ftGlyph)
+int difont::TextureFontImpl::FindRegion(unsigned int glyphIndex, unsigned int phase) const
 {
-    glyphHeight = static_cast<int>(charSize.Height() + 0.5);
-    glyphWidth = static_cast<int>(charSize.Width() + 0.5);
+    std::map<unsigned int, int>::const_iterator it =
+        regionIndex.find(glyphIndex * difont::TextureFont::MAX_SUBPIXEL_PHASES + phase);
 
-    if(glyphHeight < 1) glyphHeight = 1;
-    if(glyphWidth < 1) glyphWidth = 1;
-	
-    if(textureIDList.empty())
+    return it == regionIndex.end() ? -1 : it->second;
+}
+
+
+int difont::TextureFontImpl::MakeRegion(FT_GlyphSlot ftGlyph, unsigned int phase)
+{
+    difont::Point advance(ftGlyph->advance.x / 64.0f, ftGlyph->advance.y / 64.0f);
+
+    // Glyphs are loaded at the face size and scaled to the bucket size.
+    if(rasterSize != FontImpl::FaceSize() && ftGlyph->format == ft_glyph_format_outline)
+    {
+        FT_Fixed scale = FT_DivFix(rasterSize, FontImpl::FaceSize());
+        FT_Matrix matrix = { scale, 0, 0, scale };
+        FT_Outline_Transform(&ftGlyph->outline, &matrix);
+        advance = difont::Point(FT_MulFix(ftGlyph->advance.x, scale) / 64.0f,
+                                FT_MulFix(ftGlyph->advance.y, scale) / 64.0f);
+    }
+
+    difont::BBox bBox(ftGlyph);
+
+    /* FIXME: need to propagate the render mode all the way down to
+     * here in order to get FT_RENDER_MODE_MONO aliased fonts.
+     */
+
+    if(ftGlyph->format == ft_glyph_format_outline)
+    {
+        if(phase)
+        {
+            FT_Outline_Translate(&ftGlyph->outline,
+                                 static_cast<FT_Pos>(phase * 64 / subpixelPhases), 0);
+        }
+
+        return RasterizeRegion(ftGlyph, phase, advance, bBox);
+    }
+
+    // Embedded bitmaps are already rendered.
+
+    err = FT_Render_Glyph(ftGlyph, FT_RENDER_MODE_NORMAL);
+    if(err || ftGlyph->format != ft_glyph_format_bitmap)
+    {
+        return -1;
+    }
+
+    FT_Bitmap bitmap = ftGlyph->bitmap;
+
+    if(channels == 3)
+    {
+        std::vector<unsigned char> rgb(bitmap.width * bitmap.rows * 3);
+        difont::LcdRasterizer::Expand(bitmap.buffer, bitmap.width, bitmap.rows, bitmap.pitch,
+                                      rgb.empty() ? NULL : &rgb[0], bitmap.width * 3);
+
+        return AddRegion(face.GlyphIndex(), phase, rgb.empty() ? NULL : &rgb[0],
+                         bitmap.width, bitmap.rows, bitmap.width * 3,
+                         difont::Point(ftGlyph->bitmap_left, ftGlyph->bitmap_top),
+                         advance, bBox);
+    }
+
+    return AddRegion(face.GlyphIndex(), phase, bitmap.buffer,
+                     bitmap.width, bitmap.rows, bitmap.pitch,
+                     difont::Point(ftGlyph->bitmap_left, ftGlyph->bitmap_top),
+                     advance, bBox);
+}
+
+
+int difont::TextureFontImpl::RasterizeRegion(FT_GlyphSlot ftGlyph, unsigned int phase,
+                                             const difont::Point& advance,
+                                             const difont::BBox& bBox)
+{
+    int left, top, width, height;
+    if(channels == 3)
+    {
+        difont::LcdRasterizer::Bounds(&ftGlyph->outline, left, top, width, height);
+    }
+    else
     {
-        textureIDList.push_back(CreateTexture());
-        xOffset = yOffset = padding;
+        difont::SpanRasterizer::Bounds(&ftGlyph->outline, left, top, width, height);
     }
 
-    if(xOffset > (textureWidth - glyphWidth))
+    int index = PlaceRegion(face.GlyphIndex(), phase, width, height,
+                            difont::Point(left, top), advance, bBox);
+    if(index < 0 || !width || !height)
     {
-        xOffset = padding;
-        yOffset += glyphHeight;
+        return index;
+    }
 
-        if(yOffset > (textureHeight - glyphHeight))
+    // Coverage goes straight into the page's pixels, which are uploaded
+    // with the other glyphs added before the next Flush().
+    const TextureRegion& region = regions[index];
+    TexturePage& texture = pages[region.page];
+    assert(region.x >= 0 && region.x + width <= texture.width
+           && region.y >= 0 && region.y + height <= texture.height);
+    int pitch = texture.width * channels;
+    unsigned char *pixels = texture.pixels + region.y * pitch + region.x * channels;
+
+    // err may hold an older failure, so only this glyph's result counts.
+    FT_Error error = 0;
+    if(channels == 3)
+    {
+        error = lcdRasterizer.Render(ftGlyph->library, &ftGlyph->outline,
+                                     left, top, width, height, pixels, pitch);
+    }
+    else if(!rasterizer.Render(&ftGlyph->outline, left, top, width, height,
+                               pixels, pitch))
+    {
+        for(int row = 0; row < height; ++row)
         {
-            textureIDList.push_back(CreateTexture());
-            yOffset = padding;
+            memset(pixels + row * pitch, 0, width);
         }
+
+        error = difont::SpanRasterizer::Render(ftGlyph->library, &ftGlyph->outline,
+                                               left, top, width, height,
+                                               pixels, pitch);
     }
 
-    TextureGlyph* tempGlyph = new TextureGlyph(ftGlyph, textureIDList[textureIDList.size() - 1],
-                                                    xOffset, yOffset, textureWidth, textureHeight);
-    xOffset += static_cast<int>(tempGlyph->BBox().Upper().X() - tempGlyph->BBox().Lower().X() + padding + 0.5);
-	
-	--remGlyphs;
+    if(error)
+    {
+        err = error;
+        regionIndex.erase(region.glyphIndex * difont::TextureFont::MAX_SUBPIXEL_PHASES + phase);
+        regions.pop_back();
+        return -1;
+    }
 
-    return tempGlyph;
+    TouchRows(region.page, region.y, region.y + height);
+
+    return index;
 }
 
 
-void difont::TextureFontImpl::CalculateTextureSize() {
-    if (!maximumGLTextureSize) {
-        maximumGLTextureSize = 512;
-        glGetIntegerv(GL_MAX_TEXTURE_SIZE, (GLint*)&maximumGLTextureSize);
-        assert(maximumGLTextureSize);
+int difont::TextureFontImpl::AddRegion(unsigned int glyphIndex, unsigned int phase,
+                                       const unsigned char *bitmap, int width, int height,
+                                       int pitch, const difont::Point& corner,
+                                       const difont::Point& advance, const difont::BBox& bBox)
+{
+    int index = PlaceRegion(glyphIndex, phase, width, height, corner, advance, bBox);
+    if(index < 0)
+    {
+        return index;
     }
-    maximumGLTextureSize = 2048;
-    textureWidth = NextPowerOf2((remGlyphs * glyphWidth) + (padding * 2));
-    textureWidth = textureWidth > maximumGLTextureSize ? maximumGLTextureSize : textureWidth;
 
-    int h = static_cast<int>((textureWidth - (padding * 2)) / glyphWidth + 0.5);
+    const TextureRegion& region = regions[index];
+    if(region.width && region.height)
+    {
+        WriteRegion(region.page, region.x, region.y, region.width, region.height,
+                    bitmap, pitch);
+    }
 
-    textureHeight = NextPowerOf2(((numGlyphs / h) + 1) * glyphHeight);
-    textureHeight = textureHeight > maximumGLTextureSize ? maximumGLTextureSize : textureHeight;
+    return index;
 }
 
 
-GLuint difont::TextureFontImpl::CreateTexture() {
-	CalculateTextureSize();
+int difont::TextureFontImpl::PlaceRegion(unsigned int glyphIndex, unsigned int phase,
+                                         int width, int height, const difont::Point& corner,
+                                         const difont::Point& advance, const difont::BBox& bBox)
+{
+    TextureRegion region;
+    region.glyphIndex = glyphIndex;
+    region.phase = phase;
+    region.advance = advance;
+    region.bBox = bBox;
 
-    int totalMemory = textureWidth * textureHeight;
-    unsigned char *textureMemory = (unsigned char *)calloc(1, sizeof(unsigned char) * textureWidth * textureHeight);
-	
-    GLuint textID;
-    glGenTextures(1, (GLuint*)&textID);
+    region.page = static_cast<int>(pages.size()) - 1;
+    region.x = region.y = 0;
+    region.width = width;
+    region.height = height;
 
-    difont::gl::BindTexture(textID);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, textureWidth, textureHeight,
-                 0, GL_ALPHA, GL_UNSIGNED_BYTE, textureMemory);
+    if(region.width && region.height)
+    {
+        region.page = AllocateRegion(region.width, region.height,
+                                     region.x, region.y);
+        if(region.page < 0)
+        {
+            return -1;
+        }
+    }
+
+    //      0
+    //      +----+
+    //      |    |
+    //      |    |
+    //      |    |
+    //      +----+
+    //           1
+    region.uv[0].X(static_cast<float>(region.x) / static_cast<float>(textureWidth));
+    region.uv[0].Y(static_cast<float>(region.y) / static_cast<float>(textureHeight));
+    region.uv[1].X(static_cast<float>(region.x + region.width) / static_cast<float>(textureWidth));
+    region.uv[1].Y(static_cast<float>(region.y + region.height) / static_cast<float>(textureHeight));
 
-    delete [] textureMemory;
+    region.corner = corner;
 
-    return textID;
+    int index = static_cast<int>(regions.size());
+    regions.push_back(region);
+    regionIndex[region.glyphIndex * difont::TextureFont::MAX_SUBPIXEL_PHASES + phase] = index;
+    cacheDirty = true;
+
+    return index;
 }
 
 
-bool difont::TextureFontImpl::FaceSize(const unsigned int size, const unsigned int res)
+int difont::TextureFontImpl::MakeRegion(unsigned int glyphIndex, unsigned int phase)
 {
-    if(!textureIDList.empty())
+    FT_GlyphSlot ftGlyph = face.Glyph(glyphIndex, load_flags);
+    if(!ftGlyph)
     {
-        glDeleteTextures((GLsizei)textureIDList.size(), (const GLuint*)&textureIDList[0]);
-        textureIDList.clear();
-        remGlyphs = numGlyphs = face.GlyphCount();
+        err = face.Error();
+        return -1;
     }
 
-    return FontImpl::FaceSize(size, res);
+    return MakeRegion(ftGlyph, phase);
 }
 
 
-template <typename T>
-inline difont::Point difont::TextureFontImpl::RenderI(const T* string, const int len,
-                                          difont::Point position, difont::Point spacing,
-                                          int renderMode)
+int difont::TextureFontImpl::RequestRegion(unsigned int glyphIndex, unsigned int phase)
 {
-	disableTexture2D = false;
-	disableBlend = false;
-    difont::Point tmp = FontImpl::Render(string, len, position, spacing, renderMode);
-    return tmp;
+    int index = FindRegion(glyphIndex, phase);
+    if(index >= 0)
+    {
+        return index;
+    }
+
+    if(workers)
+    {
+        QueueRegion(glyphIndex, phase);
+        return -1;
+    }
+
+    // Out of budget, phase 0 is drawn until a later frame.
+    if(!difont::FrameBudget::Available())
+    {
+        return -1;
+    }
+
+    uint64_t start = difont::FrameBudget::Start();
+    index = MakeRegion(glyphIndex, phase);
+    difont::FrameBudget::Spend(start);
+
+    return index;
 }
 
 
-void difont::TextureFontImpl::PreRender() 
+void difont::TextureFontImpl::QueueRegion(unsigned int glyphIndex, unsigned int phase)
 {
+    if(!queuedRegions.insert(glyphIndex * difont::TextureFont::MAX_SUBPIXEL_PHASES + phase).second)
+    {
+        return;
+    }
+
+    RasterJob job;
+    job.glyphIndex = glyphIndex;
+    job.phase = phase;
+    job.subpixelPhases = subpixelPhases;
+    job.size = FontImpl::FaceSize();
+    job.rasterSize = rasterSize;
+    job.resolution = resolution;
+    job.loadFlags = load_flags;
+    job.generation = generation;
+    job.lcd = channels == 3;
+    memcpy(job.lcdFilter, lcdRasterizer.Filter(), sizeof(job.lcdFilter));
+
+    workers->Queue(job);
 }
 
 
-void difont::TextureFontImpl::PostRender() 
+void difont::TextureFontImpl::WaitForRegion(TextureGlyphImpl *glyph)
 {
+    float x = face.GlyphAdvance(glyph->glyphIndex, load_flags);
+    glyph->advance = difont::Point(x, 0.0f);
+    glyph->bBox = difont::BBox(0.0f, charSize.Descender(), 0.0f,
+                               x, charSize.Ascender(), 0.0f);
+
+    waitingGlyphs.insert(std::make_pair(glyph->glyphIndex, glyph));
+    QueueRegion(glyph->glyphIndex, 0);
 }
 
 
-difont::Point difont::TextureFontImpl::Render(const char * string, const int len,
-                                  difont::Point position, difont::Point spacing,
-                                  int renderMode)
+void difont::TextureFontImpl::ForgetWaitingGlyph(TextureGlyphImpl *glyph)
 {
-    return RenderI(string, len, position, spacing, renderMode);
+    std::pair<std::multimap<unsigned int, TextureGlyphImpl*>::iterator,
+              std::multimap<unsigned int, TextureGlyphImpl*>::iterator> waiting =
+        waitingGlyphs.equal_range(glyph->glyphIndex);
+    for(std::multimap<unsigned int, TextureGlyphImpl*>::iterator it = waiting.first;
+        it != waiting.second; ++it)
+    {
+        if(it->second == glyph)
+        {
+            waitingGlyphs.erase(it);
+            return;
+        }
+    }
 }
 
 
-difont::Point difont::TextureFontImpl::Render(const wchar_t * string, const int len,
-                                  difont::Point position, difont::Point spacing,
-                                  int renderMode)
+void difont::TextureFontImpl::FinishGlyph(TextureGlyphImpl *glyph, int index)
 {
-    
-    return RenderI(string, len, position, spacing, renderMode);
+    if(index < 0)
+    {
+        return;
+    }
+
+    glyph->regions[0] = index;
+    RegionMetrics(regions[index], glyph->advance, glyph->bBox);
+}
+
+
+void difont::TextureFontImpl::LandRegions()
+{
+    if(!workers)
+    {
+        return;
+    }
+
+    std::vector<RasterResult> results;
+    workers->TakeResults(results);
+    bool finished = false;
+
+    for(size_t i = 0; i < results.size(); ++i)
+    {
+        const RasterResult& result = results[i];
+        const RasterJob& job = result.job;
+        if(job.generation != generation)
+        {
+            continue;
+        }
+
+        queuedRegions.erase(job.glyphIndex * difont::TextureFont::MAX_SUBPIXEL_PHASES + job.phase);
+
+        int index = -1;
+        if(!result.err)
+        {
+            index = AddRegion(job.glyphIndex, job.phase,
+                              result.pixels.empty() ? NULL : &result.pixels[0],
+                              result.width, result.height, result.width * channels,
+                              result.corner, result.advance, result.bBox);
+        }
+
+        if(job.phase == 0)
+        {
+            if(index >= 0)
+            {
+                --remGlyphs;
+            }
+
+            std::pair<std::multimap<unsigned int, TextureGlyphImpl*>::iterator,
+                      std::multimap<unsigned int, TextureGlyphImpl*>::iterator> waiting =
+                waitingGlyphs.equal_range(job.glyphIndex);
+            for(std::multimap<unsigned int, TextureGlyphImpl*>::iterator it = waiting.first;
+                it != waiting.second; ++it)
+            {
+                FinishGlyph(it->second, index);
+                finished = true;
+            }
+            waitingGlyphs.erase(waiting.first, waiting.second);
+        }
+    }
+
+    if(finished)
+    {
+        RefreshGlyphMetrics();
+    }
+}
+
+
+void difont::TextureFontImpl::SettleWaitingGlyphs()
+{
+    LandRegions();
+
+    std::multimap<unsigned int, TextureGlyphImpl*> waiting;
+    waiting.swap(waitingGlyphs);
+    CancelWaitingGlyphs();
+
+    for(std::multimap<unsigned int, TextureGlyphImpl*>::iterator it = waiting.begin();
+        it != waiting.end(); ++it)
+    {
+        int index = FindRegion(it->first, 0);
+        if(index < 0)
+        {
+            index = MakeRegion(it->first, 0);
+            if(index >= 0)
+            {
+                --remGlyphs;
+            }
+        }
+
+        FinishGlyph(it->second, index);
+    }
+
+    if(!waiting.empty())
+    {
+        RefreshGlyphMetrics();
+    }
+}
+
+
+void difont::TextureFontImpl::CancelWaitingGlyphs()
+{
+    if(workers)
+    {
+        workers->Cancel();
+    }
+
+    ++generation;
+    queuedRegions.clear();
+    waitingGlyphs.clear();
+}
+
+
+void difont::TextureFontImpl::GlyphsReady(void *font)
+{
+    TextureFontImpl *self = static_cast<TextureFontImpl *>(font);
+    if(self->readyCallback)
+    {
+        self->readyCallback(dynamic_cast<difont::TextureFont *>(self->Interface()),
+                            self->readyUserData);
+    }
+}
+
+
+int difont::TextureFontImpl::AllocateRegion(int width, int height, int& x, int& y)
+{
+    // With mipmaps, bitmaps start on a multiple of the smallest level's
+    // texel size and are at least that far apart, so every texel of every
+    // level covers at most one glyph.
+    int alignment = 1 << mipmapLevels;
+    int gutter = AlignUp(static_cast<int>(padding), alignment);
+    int rowHeight = mipmapLevels ? AlignUp(glyphHeight + gutter, alignment) : glyphHeight;
+
+    if(pages.empty())
+    {
+        CalculateTextureSize();
+        CreateTexture(textureWidth, textureHeight);
+        xOffset = yOffset = gutter;
+        shelfHeight = 0;
+    }
+
+    if(xOffset > (textureWidth - width - gutter))
+    {
+        // An outline's rounded out bounds can be a row taller than the
+        // face's glyph height, so the next row goes below the tallest
+        // bitmap on this one.
+        xOffset = gutter;
+        yOffset = AlignUp(yOffset + std::max(rowHeight, shelfHeight + gutter), alignment);
+        shelfHeight = 0;
+    }
+
+    if(yOffset + height + gutter > textureHeight)
+    {
+        // Every layer of a texture array has the size of the first.
+        if(!arrayPages)
+        {
+            CalculateTextureSize();
+        }
+        CreateTexture(textureWidth, textureHeight);
+        xOffset = yOffset = gutter;
+        shelfHeight = 0;
+    }
+
+    // Too big for even an empty page.
+    if(xOffset + width + gutter > textureWidth || yOffset + height + gutter > textureHeight)
+    {
+        return -1;
+    }
+
+    x = xOffset;
+    y = yOffset;
+    xOffset = AlignUp(xOffset + width + gutter, alignment);
+    shelfHeight = std::max(shelfHeight, height);
+
+    return static_cast<int>(pages.size()) - 1;
+}
+
+
+bool difont::TextureFontImpl::CalculateGlyphSize(const unsigned int size,
+                                                 const unsigned int res)
+{
+    difont::Size glyphSize = charSize;
+    bool temporary = size != charSize.CharSize();
+    if(temporary)
+    {
+        glyphSize = face.NewSize(size, res);
+        if(face.Error())
+        {
+            err = face.Error();
+            return false;
+        }
+    }
+
+    glyphHeight = static_cast<int>(glyphSize.Height() + 0.5);
+    glyphWidth = static_cast<int>(glyphSize.Width() + 0.5);
+
+    if(glyphHeight < 1) glyphHeight = 1;
+    if(glyphWidth < 1) glyphWidth = 1;
+
+    if(temporary)
+    {
+        face.ActivateSize(charSize);
+        face.DoneSize(glyphSize);
+    }
+
+    return true;
+}
+
+
+void difont::TextureFontImpl::CalculateTextureSize() {
+    if (!maximumGLTextureSize) {
+        maximumGLTextureSize = 512;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, (GLint*)&maximumGLTextureSize);
+        assert(maximumGLTextureSize);
+    }
+    maximumGLTextureSize = 2048;
+    textureWidth = NextPowerOf2((remGlyphs * glyphWidth) + (padding * 2));
+    textureWidth = textureWidth > maximumGLTextureSize ? maximumGLTextureSize : textureWidth;
+
+    int h = static_cast<int>((textureWidth - (padding * 2)) / glyphWidth + 0.5);
+
+    textureHeight = NextPowerOf2(((numGlyphs / h) + 1) * glyphHeight);
+    textureHeight = textureHeight > maximumGLTextureSize ? maximumGLTextureSize : textureHeight;
+}
+
+
+void difont::TextureFontImpl::CreateTexture(GLsizei width, GLsizei height,
+                                            const unsigned char *pixels)
+{
+    TexturePage page = AllocatePage(width, height);
+
+    if(pixels)
+    {
+        memcpy(page.pixels, pixels, width * height * channels);
+        BuildMipmaps(page, 0, height);
+    }
+
+    // Glyphs only go into the newest page.
+    if(!pages.empty())
+    {
+        pages.back().sealed = true;
+    }
+
+    pages.push_back(page);
+    CreatePageTexture(static_cast<int>(pages.size()) - 1);
+}
+
+
+difont::TexturePage difont::TextureFontImpl::AllocatePage(GLsizei width, GLsizei height) const
+{
+    TexturePage page;
+    page.textureID = 0;
+    page.width = width;
+    page.height = height;
+    page.pixels = (unsigned char *)calloc(1, sizeof(unsigned char) * width * height * channels);
+    page.dirtyTop = height;
+    page.dirtyBottom = 0;
+    page.sealed = false;
+    page.compressed = false;
+
+    for(unsigned int level = 1; level <= difont::TextureFont::MAX_MIPMAP_LEVELS; ++level)
+    {
+        page.mipmaps[level - 1] = level > mipmapLevels ? NULL
+            : (unsigned char *)calloc(1, LevelSize(width, level) * LevelSize(height, level) * channels);
+    }
+
+    return page;
+}
+
+
+void difont::TextureFontImpl::CreatePageTexture(int index)
+{
+    GLsizei width = pages[index].width;
+    GLsizei height = pages[index].height;
+
+#ifdef GL_TEXTURE_2D_ARRAY
+    if(arrayPages)
+    {
+        if(static_cast<GLsizei>(pages.size()) > arrayLayers)
+        {
+            GrowTextureArray();
+            return;
+        }
+
+        pages[index].textureID = pages[0].textureID;
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for(unsigned int level = 0; level <= mipmapLevels; ++level)
+        {
+            UploadRows(index, level, 0, LevelSize(height, level));
+        }
+        return;
+    }
+#endif
+
+    TexturePage& texture = pages[index];
+    glGenTextures(1, (GLuint*)&texture.textureID);
+
+    difont::gl::BindTexture(texture.textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    mipmapLevels ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+#ifdef GL_TEXTURE_MAX_LEVEL
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipmapLevels);
+#endif
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for(unsigned int level = 0; level <= mipmapLevels; ++level)
+    {
+        glTexImage2D(GL_TEXTURE_2D, level, PageFormat(),
+                     LevelSize(width, level), LevelSize(height, level),
+                     0, PageFormat(), GL_UNSIGNED_BYTE, texture.Level(level));
+    }
+}
+
+
+void difont::TextureFontImpl::GrowTextureArray()
+{
+#ifdef GL_TEXTURE_2D_ARRAY
+    // Double the layers so adding pages stays cheap.
+    GLsizei layers = arrayLayers ? arrayLayers : 1;
+    while(layers < static_cast<GLsizei>(pages.size()))
+    {
+        layers *= 2;
+    }
+
+    GLsizei width = pages[0].width;
+    GLsizei height = pages[0].height;
+
+    // The first page still names the old array, if there was one.
+    GLuint oldTextureID = arrayLayers ? pages[0].textureID : 0;
+
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                    mipmapLevels ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, mipmapLevels);
+    for(unsigned int level = 0; level <= mipmapLevels; ++level)
+    {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, PageFormat(),
+                     LevelSize(width, level), LevelSize(height, level), layers,
+                     0, PageFormat(), GL_UNSIGNED_BYTE, NULL);
+    }
+
+    for(size_t i = 0; i < pages.size(); ++i)
+    {
+        pages[i].textureID = textureID;
+    }
+    arrayLayers = layers;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for(size_t i = 0; i < pages.size(); ++i)
+    {
+        for(unsigned int level = 0; level <= mipmapLevels; ++level)
+        {
+            UploadRows(static_cast<int>(i), level, 0, LevelSize(height, level));
+        }
+    }
+
+    // Quads already drawn this frame move to the new array.
+    if(oldTextureID)
+    {
+        difont::FontMeshSet::ReplaceTextureId(oldTextureID, textureID);
+        glDeleteTextures(1, &oldTextureID);
+    }
+#endif
+}
+
+
+void difont::TextureFontImpl::WriteRegion(int page, int x, int y, int width, int height,
+                                          const unsigned char *bitmap, int pitch)
+{
+    TexturePage& texture = pages[page];
+    assert(x >= 0 && x + width <= texture.width && y >= 0 && y + height <= texture.height);
+    for(int row = 0; row < height; ++row)
+    {
+        memcpy(texture.pixels + ((y + row) * texture.width + x) * channels,
+               bitmap + row * pitch, width * channels);
+    }
+
+    TouchRows(page, y, y + height);
+}
+
+
+void difont::TextureFontImpl::TouchRows(int page, int top, int bottom)
+{
+    TexturePage& texture = pages[page];
+    if(top < texture.dirtyTop)
+    {
+        texture.dirtyTop = top;
+    }
+    if(bottom > texture.dirtyBottom)
+    {
+        texture.dirtyBottom = bottom;
+    }
+}
+
+
+void difont::TextureFontImpl::BuildMipmaps(TexturePage& page, int top, int bottom)
+{
+    // A 2x2 box filter from each level to the next. Whole rows are
+    // filtered; the gutters around the bitmaps are empty, so this is the
+    // same as filtering each bitmap on its own. The channels of RGB
+    // pages are filtered separately.
+    const unsigned char *src = page.pixels;
+    int srcWidth = page.width;
+    int srcHeight = page.height;
+
+    for(unsigned int level = 1; level <= mipmapLevels; ++level)
+    {
+        unsigned char *dst = page.mipmaps[level - 1];
+        int dstWidth = LevelSize(page.width, level);
+        int dstHeight = LevelSize(page.height, level);
+        int dstBottom = bottom >> level;
+        if(dstBottom > dstHeight)
+        {
+            dstBottom = dstHeight;
+        }
+
+        for(int y = top >> level; y < dstBottom; ++y)
+        {
+            const unsigned char *row0 = src + std::min(2 * y, srcHeight - 1) * srcWidth * channels;
+            const unsigned char *row1 = src + std::min(2 * y + 1, srcHeight - 1) * srcWidth * channels;
+            unsigned char *out = dst + y * dstWidth * channels;
+
+            for(int x = 0; x < dstWidth; ++x)
+            {
+                int x0 = std::min(2 * x, srcWidth - 1) * channels;
+                int x1 = std::min(2 * x + 1, srcWidth - 1) * channels;
+                for(int c = 0; c < channels; ++c)
+                {
+                    out[x * channels + c] = static_cast<unsigned char>(
+                        (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+                }
+            }
+        }
+
+        src = dst;
+        srcWidth = dstWidth;
+        srcHeight = dstHeight;
+    }
+}
+
+
+void difont::TextureFontImpl::UploadRows(int page, unsigned int level, int top, int bottom)
+{
+    if(top >= bottom)
+    {
+        return;
+    }
+
+    // Whole rows are contiguous in the pixels, so they upload without
+    // GL_UNPACK_ROW_LENGTH, which OpenGL ES 2 lacks.
+    const TexturePage& texture = pages[page];
+    GLsizei width = LevelSize(texture.width, level);
+    const unsigned char *rows = texture.Level(level) + top * width * channels;
+
+#ifdef GL_TEXTURE_2D_ARRAY
+    if(arrayPages)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture.textureID);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, top, page, width, bottom - top, 1,
+                        PageFormat(), GL_UNSIGNED_BYTE, rows);
+        return;
+    }
+#endif
+
+    difont::gl::BindTexture(texture.textureID);
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, top, width, bottom - top,
+                    PageFormat(), GL_UNSIGNED_BYTE, rows);
+}
+
+
+void difont::TextureFontImpl::Flush()
+{
+    LandRegions();
+
+    int alignment = 1 << mipmapLevels;
+
+    for(size_t i = 0; i < pages.size(); ++i)
+    {
+        TexturePage& page = pages[i];
+        bool compress = compressedPages && !arrayPages && channels == 1
+                        && page.sealed && !page.compressed;
+        if(page.dirtyTop >= page.dirtyBottom && !compress)
+        {
+            continue;
+        }
+
+        // Widen the rows to whole texels of the smallest level.
+        int top = page.dirtyTop & ~(alignment - 1);
+        int bottom = std::min(static_cast<int>(page.height),
+                              AlignUp(page.dirtyBottom, alignment));
+
+        if(top < bottom)
+        {
+            BuildMipmaps(page, top, bottom);
+        }
+
+        if(compress)
+        {
+            CompressPage(static_cast<int>(i));
+        }
+        else
+        {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            for(unsigned int level = 0; level <= mipmapLevels; ++level)
+            {
+                UploadRows(static_cast<int>(i), level, top >> level,
+                           std::min(LevelSize(page.height, level), bottom >> level));
+            }
+        }
+
+        page.dirtyTop = page.height;
+        page.dirtyBottom = 0;
+    }
+}
+
+
+void difont::TextureFontImpl::CompressPage(int index)
+{
+#ifdef DIFONT_COMPRESSED_FORMAT
+    TexturePage& page = pages[index];
+
+    difont::gl::BindTexture(page.textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_ZERO);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_ZERO);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_ZERO);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_RED);
+
+    // One buffer, sized for the full size level, holds each level in turn.
+    std::vector<unsigned char> blocks(difont::BlockEncoder::EncodedSize(page.width, page.height));
+    for(unsigned int level = 0; level <= mipmapLevels; ++level)
+    {
+        GLsizei width = LevelSize(page.width, level);
+        GLsizei height = LevelSize(page.height, level);
+        size_t size = difont::BlockEncoder::EncodedSize(width, height);
+
+        difont::BlockEncoder::Encode(DIFONT_COMPRESSED_BLOCKS, page.Level(level),
+                                     width, height, &blocks[0]);
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, DIFONT_COMPRESSED_FORMAT,
+                               width, height, 0, static_cast<GLsizei>(size), &blocks[0]);
+    }
+
+    page.compressed = true;
+#endif
+}
+
+
+void difont::TextureFontImpl::ReleaseTextures()
+{
+    ReleasePages(pages);
+    arrayLayers = 0;
+}
+
+
+void difont::TextureFontImpl::ReleasePages(std::vector<TexturePage>& atlasPages)
+{
+    for(size_t i = 0; i < atlasPages.size(); ++i)
+    {
+        // The layers of a texture array share one texture.
+        if(i == 0 || atlasPages[i].textureID != atlasPages[i - 1].textureID)
+        {
+            glDeleteTextures(1, &atlasPages[i].textureID);
+        }
+        free(atlasPages[i].pixels);
+        for(unsigned int level = 0; level < difont::TextureFont::MAX_MIPMAP_LEVELS; ++level)
+        {
+            free(atlasPages[i].mipmaps[level]);
+        }
+    }
+
+    atlasPages.clear();
+}
+
+
+void difont::TextureFontImpl::SwapAtlas(StashedAtlas& atlas)
+{
+    std::swap(rasterSize, atlas.rasterSize);
+    std::swap(resolution, atlas.resolution);
+    std::swap(textureWidth, atlas.textureWidth);
+    std::swap(textureHeight, atlas.textureHeight);
+    pages.swap(atlas.pages);
+    std::swap(arrayLayers, atlas.arrayLayers);
+    std::swap(glyphHeight, atlas.glyphHeight);
+    std::swap(glyphWidth, atlas.glyphWidth);
+    std::swap(numGlyphs, atlas.numGlyphs);
+    std::swap(remGlyphs, atlas.remGlyphs);
+    std::swap(xOffset, atlas.xOffset);
+    std::swap(yOffset, atlas.yOffset);
+    std::swap(shelfHeight, atlas.shelfHeight);
+    regions.swap(atlas.regions);
+    regionIndex.swap(atlas.regionIndex);
+    std::swap(cacheDirty, atlas.cacheDirty);
+}
+
+
+void difont::TextureFontImpl::StashAtlas()
+{
+    stashedAtlases.push_front(StashedAtlas());
+    SwapAtlas(stashedAtlases.front());
+}
+
+
+void difont::TextureFontImpl::TrimStashedAtlases(unsigned int keep)
+{
+    if(stashedAtlases.size() <= keep)
+    {
+        return;
+    }
+
+    while(stashedAtlases.size() > keep)
+    {
+        ReleasePages(stashedAtlases.back().pages);
+        stashedAtlases.pop_back();
+    }
+
+    // Glyphs of other sizes may have come from the atlases dropped.
+    ForgetSizes(true);
+}
+
+
+bool difont::TextureFontImpl::RestoreAtlas(unsigned int bucket, unsigned int res)
+{
+    for(std::list<StashedAtlas>::iterator it = stashedAtlases.begin();
+        it != stashedAtlases.end(); ++it)
+    {
+        if(it->rasterSize == bucket && it->resolution == res)
+        {
+            SwapAtlas(*it);
+            stashedAtlases.erase(it);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void difont::TextureFontImpl::ReleaseStashedAtlases()
+{
+    for(std::list<StashedAtlas>::iterator it = stashedAtlases.begin();
+        it != stashedAtlases.end(); ++it)
+    {
+        ReleasePages(it->pages);
+    }
+
+    stashedAtlases.clear();
+}
+
+
+bool difont::TextureFontImpl::IsWaiting(const GlyphImpl* impl, void* context)
+{
+    return typeid(*impl) == typeid(TextureGlyphImpl)
+           && static_cast<const TextureGlyphImpl*>(impl)->regions[0] < 0;
+}
+
+
+difont::TextureFont::AtlasStats difont::TextureFontImpl::AtlasOccupancy() const
+{
+    difont::TextureFont::AtlasStats stats;
+    stats.pages = static_cast<unsigned int>(pages.size());
+    stats.bitmaps = 0;
+    stats.texels = 0;
+    stats.usedTexels = 0;
+
+    for(size_t i = 0; i < pages.size(); ++i)
+    {
+        stats.texels += static_cast<size_t>(pages[i].width) * pages[i].height;
+    }
+
+    for(size_t i = 0; i < regions.size(); ++i)
+    {
+        if(regions[i].width && regions[i].height)
+        {
+            ++stats.bitmaps;
+            stats.usedTexels += static_cast<size_t>(regions[i].width) * regions[i].height;
+        }
+    }
+
+    return stats;
+}
+
+
+// Orders pages by the share of their texels used, least first.
+struct EmptierPage {
+    const std::vector<double> *occupancy;
+
+    bool operator()(int a, int b) const
+    {
+        return (*occupancy)[a] < (*occupancy)[b];
+    }
+};
+
+
+// Orders regions tallest first, then widest.
+struct TallerRegion {
+    const std::vector<difont::TextureRegion> *regions;
+
+    bool operator()(int a, int b) const
+    {
+        const difont::TextureRegion& ra = (*regions)[a];
+        const difont::TextureRegion& rb = (*regions)[b];
+        return ra.height != rb.height ? ra.height > rb.height : ra.width > rb.width;
+    }
+};
+
+
+difont::TextureFont::CompactionStats difont::TextureFontImpl::Compact(unsigned int maxPages)
+{
+    // Bitmaps finished in the background go in first, so they move too.
+    LandRegions();
+
+    difont::TextureFont::CompactionStats stats;
+    stats.before = stats.after = AtlasOccupancy();
+
+    size_t count = pages.size();
+    if(maxPages && maxPages < count)
+    {
+        count = maxPages;
+    }
+    if(count < 2)
+    {
+        return stats;
+    }
+
+    // Repack the emptiest pages, into pages as large as the largest.
+    std::vector<double> occupancy(pages.size(), 0.0);
+    for(size_t i = 0; i < regions.size(); ++i)
+    {
+        const TextureRegion& region = regions[i];
+        if(region.width && region.height)
+        {
+            const TexturePage& page = pages[region.page];
+            occupancy[region.page] += static_cast<double>(region.width) * region.height
+                                    / (static_cast<double>(page.width) * page.height);
+        }
+    }
+
+    std::vector<int> order(pages.size());
+    for(size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = static_cast<int>(i);
+    }
+    EmptierPage emptier = { &occupancy };
+    std::stable_sort(order.begin(), order.end(), emptier);
+
+    std::vector<bool> source(pages.size(), false);
+    GLsizei pageWidth = 0;
+    GLsizei pageHeight = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        source[order[i]] = true;
+        pageWidth = std::max(pageWidth, pages[order[i]].width);
+        pageHeight = std::max(pageHeight, pages[order[i]].height);
+    }
+
+    std::vector<int> moving;
+    for(size_t i = 0; i < regions.size(); ++i)
+    {
+        if(regions[i].width && regions[i].height && source[regions[i].page])
+        {
+            moving.push_back(static_cast<int>(i));
+        }
+    }
+    TallerRegion taller = { &regions };
+    std::stable_sort(moving.begin(), moving.end(), taller);
+
+    // Shelf pack them with the gutter and alignment AllocateRegion keeps,
+    // each row as tall as its first bitmap.
+    int alignment = 1 << mipmapLevels;
+    int gutter = AlignUp(static_cast<int>(padding), alignment);
+
+    std::vector<int> placedPage(moving.size());
+    std::vector<int> placedX(moving.size());
+    std::vector<int> placedY(moving.size());
+    int packedPages = 1;
+    int x = gutter;
+    int y = gutter;
+    int rowHeight = 0;
+
+    for(size_t i = 0; i < moving.size(); ++i)
+    {
+        const TextureRegion& region = regions[moving[i]];
+        if(x + region.width + gutter > pageWidth)
+        {
+            x = gutter;
+            y = AlignUp(y + rowHeight + gutter, alignment);
+            rowHeight = 0;
+        }
+        if(y + region.height + gutter > pageHeight)
+        {
+            ++packedPages;
+            x = y = gutter;
+            rowHeight = 0;
+        }
+
+        placedPage[i] = packedPages - 1;
+        placedX[i] = x;
+        placedY[i] = y;
+        x = AlignUp(x + region.width + gutter, alignment);
+        rowHeight = std::max(rowHeight, region.height);
+    }
+
+    if(static_cast<size_t>(packedPages) >= count)
+    {
+        return stats;
+    }
+
+    // The pages that stay keep their order. The page glyphs are being
+    // added to stays last, unless it is repacked, when the last new page
+    // takes its place.
+    int current = static_cast<int>(pages.size()) - 1;
+    bool currentMoves = source[current];
+    GLuint arrayTextureID = arrayPages ? pages[0].textureID : 0;
+
+    std::vector<TexturePage> compacted;
+    std::vector<int> pageMap(pages.size(), -1);
+    for(int i = 0; i < current; ++i)
+    {
+        if(!source[i])
+        {
+            pageMap[i] = static_cast<int>(compacted.size());
+            compacted.push_back(pages[i]);
+        }
+    }
+
+    int firstNew = static_cast<int>(compacted.size());
+    for(int i = 0; i < packedPages; ++i)
+    {
+        compacted.push_back(AllocatePage(pageWidth, pageHeight));
+        compacted.back().sealed = currentMoves ? i < packedPages - 1 : true;
+    }
+
+    if(!currentMoves)
+    {
+        pageMap[current] = static_cast<int>(compacted.size());
+        compacted.push_back(pages[current]);
+    }
+
+    for(size_t i = 0; i < moving.size(); ++i)
+    {
+        const TextureRegion& region = regions[moving[i]];
+        const TexturePage& from = pages[region.page];
+        TexturePage& to = compacted[firstNew + placedPage[i]];
+
+        for(int row = 0; row < region.height; ++row)
+        {
+            memcpy(to.pixels + ((placedY[i] + row) * to.width + placedX[i]) * channels,
+                   from.pixels + ((region.y + row) * from.width + region.x) * channels,
+                   region.width * channels);
+        }
+    }
+
+    for(int i = 0; i < packedPages; ++i)
+    {
+        BuildMipmaps(compacted[firstNew + i], 0, pageHeight);
+    }
+
+    // The glyphs look their regions up when they are drawn, so moving the
+    // regions moves the glyphs.
+    for(size_t i = 0; i < regions.size(); ++i)
+    {
+        TextureRegion& region = regions[i];
+        if(region.page >= 0)
+        {
+            region.page = pageMap[region.page] >= 0 ? pageMap[region.page]
+                        : static_cast<int>(compacted.size()) - 1;
+        }
+    }
+
+    for(size_t i = 0; i < moving.size(); ++i)
+    {
+        TextureRegion& region = regions[moving[i]];
+        region.page = firstNew + placedPage[i];
+        region.x = placedX[i];
+        region.y = placedY[i];
+
+        float w = static_cast<float>(pageWidth);
+        float h = static_cast<float>(pageHeight);
+        region.uv[0] = difont::Point(region.x / w, region.y / h);
+        region.uv[1] = difont::Point((region.x + region.width) / w, (region.y + region.height) / h);
+    }
+
+    for(size_t i = 0; i < pages.size(); ++i)
+    {
+        if(!source[i])
+        {
+            continue;
+        }
+
+        if(!arrayPages)
+        {
+            glDeleteTextures(1, &pages[i].textureID);
+        }
+        free(pages[i].pixels);
+        for(unsigned int level = 0; level < difont::TextureFont::MAX_MIPMAP_LEVELS; ++level)
+        {
+            free(pages[i].mipmaps[level]);
+        }
+    }
+
+    pages.swap(compacted);
+
+    if(arrayPages)
+    {
+        // The layers have moved down, so every one is uploaded again.
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for(size_t i = 0; i < pages.size(); ++i)
+        {
+            pages[i].textureID = arrayTextureID;
+            for(unsigned int level = 0; level <= mipmapLevels; ++level)
+            {
+                UploadRows(static_cast<int>(i), level, 0, LevelSize(pages[i].height, level));
+            }
+        }
+    }
+    else
+    {
+        for(int i = 0; i < packedPages; ++i)
+        {
+            CreatePageTexture(firstNew + i);
+        }
+    }
+
+    if(currentMoves)
+    {
+        // New glyphs start on a row below the repacked ones, or on a new
+        // page if there's no room for one.
+        textureWidth = pageWidth;
+        textureHeight = pageHeight;
+        xOffset = gutter;
+        yOffset = AlignUp(y + rowHeight + gutter, alignment);
+        shelfHeight = 0;
+
+        int glyphRowHeight = mipmapLevels ? AlignUp(glyphHeight + gutter, alignment) : glyphHeight;
+        if(yOffset > textureHeight - glyphRowHeight)
+        {
+            xOffset = textureWidth;
+        }
+    }
+
+    cacheDirty = true;
+    stats.after = AtlasOccupancy();
+
+    return stats;
+}
+
+
+bool difont::TextureFontImpl::FaceSize(const unsigned int size, const unsigned int res)
+{
+    unsigned int bucket = BucketSize(size);
+
+    // Glyphs waiting for a bitmap are made again when their size is next
+    // used, rather than left blank.
+    EvictGlyphs(IsWaiting, NULL);
+
+    // Another size in the same bucket keeps the atlas. The glyphs hold
+    // metrics at the face size, so each size has its own; the bitmaps
+    // being rasterised in the background still land.
+    if(bucket == rasterSize && res == resolution)
+    {
+        if(!FontImpl::FaceSize(size, res))
+        {
+            rasterSize = 0;
+            return false;
+        }
+
+        quadScale = static_cast<float>(size) / static_cast<float>(bucket);
+        return true;
+    }
+
+    SaveCache();
+    CancelWaitingGlyphs();
+
+    // The atlases of recently used buckets are kept, along with the
+    // glyphs of their sizes.
+    if(rasterSize)
+    {
+        StashAtlas();
+    }
+    else if(!pages.empty())
+    {
+        // Left by a failed change of size, so no glyphs can keep it.
+        ForgetSizes(false);
+        ReleaseTextures();
+    }
+
+    if(RestoreAtlas(bucket, res))
+    {
+        if(!FontImpl::FaceSize(size, res))
+        {
+            rasterSize = 0;
+            return false;
+        }
+
+        quadScale = static_cast<float>(size) / static_cast<float>(bucket);
+        return true;
+    }
+
+    // The current atlas was stashed before looking for the bucket's, so
+    // the one for the bucket could be found. A new one takes the place of
+    // the least recently used.
+    TrimStashedAtlases(MAX_SIZES - 1);
+
+    remGlyphs = numGlyphs = face.GlyphCount();
+    regions.clear();
+    regionIndex.clear();
+    resolution = res;
+    rasterSize = 0;
+
+    // The atlas is laid out for the bucket size, the metrics come from
+    // the face size.
+    if(!FontImpl::FaceSize(size, res) || !CalculateGlyphSize(bucket, res))
+    {
+        return false;
+    }
+
+    rasterSize = bucket;
+    quadScale = static_cast<float>(size) / static_cast<float>(bucket);
+    LoadCache();
+
+    return true;
+}
+
+
+void difont::TextureFontImpl::Refresh()
+{
+    unsigned int size = FontImpl::FaceSize();
+    if(size)
+    {
+        // Nothing made with the old settings can be used.
+        ReleaseStashedAtlases();
+        ForgetSizes(false);
+
+        rasterSize = 0;
+        FaceSize(size, resolution);
+    }
+}
+
+
+void difont::TextureFontImpl::SizeBuckets(float ratio, const unsigned int *sizes,
+                                          unsigned int count)
+{
+    bucketRatio = ratio > 1.0f ? ratio : 0.0f;
+    bucketSizes.assign(sizes, sizes + (sizes ? count : 0));
+    std::sort(bucketSizes.begin(), bucketSizes.end());
+
+    // Only the current atlas is kept, if the size stays in the same
+    // bucket; the other sizes may fall in other buckets now.
+    ReleaseStashedAtlases();
+
+    unsigned int size = FontImpl::FaceSize();
+    if(size && BucketSize(size) != rasterSize)
+    {
+        Refresh();
+    }
+    else
+    {
+        ForgetSizes(true);
+    }
+}
+
+
+unsigned int difont::TextureFontImpl::BucketSize(unsigned int size) const
+{
+    // Bitmap faces can't be rasterised at another size.
+    FT_Face *ftFace = face.GetFTFace();
+    if(!size || !ftFace || !FT_IS_SCALABLE((*ftFace)))
+    {
+        return size;
+    }
+
+    // Round up, so the bitmaps are scaled down rather than blurred up.
+    if(!bucketSizes.empty())
+    {
+        std::vector<unsigned int>::const_iterator it =
+            std::lower_bound(bucketSizes.begin(), bucketSizes.end(), size);
+        return it == bucketSizes.end() ? size : *it;
+    }
+
+    if(bucketRatio > 0.0f)
+    {
+        unsigned int bucket = 1;
+        while(bucket < size)
+        {
+            bucket = std::max(bucket + 1,
+                              static_cast<unsigned int>(bucket * bucketRatio + 0.5f));
+        }
+        return bucket;
+    }
+
+    return size;
+}
+
+
+void difont::TextureFontImpl::RegionMetrics(const TextureRegion& region,
+                                            difont::Point& advance, difont::BBox& bBox)
+{
+    if(bucketRatio == 0.0f && bucketSizes.empty())
+    {
+        advance = region.advance;
+        bBox = region.bBox;
+        return;
+    }
+
+    // The region may come from another size in the bucket, even when the
+    // face size is the bucket size. Advances are read at the face size,
+    // the box is scaled.
+    advance = difont::Point(face.GlyphAdvance(region.glyphIndex, load_flags), 0.0f);
+    bBox = difont::BBox(region.bBox.Lower() * quadScale, region.bBox.Upper() * quadScale);
+}
+
+
+void difont::TextureFontImpl::GlyphLoadFlags(FT_Int flags)
+{
+    if(flags == load_flags)
+    {
+        return;
+    }
+
+    SaveCache();
+    load_flags = flags;
+
+    // Glyphs already loaded were rendered with the old flags.
+    Refresh();
+}
+
+
+void difont::TextureFontImpl::AsyncRasterization(unsigned int threads,
+                                                 difont::TextureFont::GlyphsReadyCallback callback,
+                                                 void* userData)
+{
+    // Finish what the old threads started before replacing them.
+    SettleWaitingGlyphs();
+
+    delete workers;
+    workers = NULL;
+
+    readyCallback = callback;
+    readyUserData = userData;
+
+    if(threads)
+    {
+        workers = new difont::RasterWorkers(face, threads, GlyphsReady, this);
+
+        // A face FreeType opened itself has no data for the threads to
+        // share, and threads may fail to start: stay on this thread.
+        if(!workers->Threads())
+        {
+            delete workers;
+            workers = NULL;
+        }
+    }
+}
+
+
+unsigned int difont::TextureFontImpl::MipmapLevels(unsigned int levels)
+{
+#ifndef GL_TEXTURE_MAX_LEVEL
+    // Without a way to cap the levels, a partial chain is incomplete.
+    levels = 0;
+#endif
+
+    if(levels > difont::TextureFont::MAX_MIPMAP_LEVELS)
+    {
+        levels = difont::TextureFont::MAX_MIPMAP_LEVELS;
+    }
+
+    if(levels == mipmapLevels)
+    {
+        return mipmapLevels;
+    }
+
+    SaveCache();
+    mipmapLevels = levels;
+
+    Refresh();
+
+    return mipmapLevels;
+}
+
+
+bool difont::TextureFontImpl::TextureArrayPages(bool useArray)
+{
+#ifndef GL_TEXTURE_2D_ARRAY
+    useArray = false;
+#endif
+
+    if(useArray == arrayPages)
+    {
+        return arrayPages;
+    }
+
+    SaveCache();
+    arrayPages = useArray;
+
+    Refresh();
+
+    return arrayPages;
+}
+
+
+bool difont::TextureFontImpl::CompressedPages(bool compress)
+{
+#ifndef DIFONT_COMPRESSED_FORMAT
+    compress = false;
+#endif
+
+    if(compress == compressedPages)
+    {
+        return compressedPages;
+    }
+
+    SaveCache();
+    compressedPages = compress;
+
+    Refresh();
+
+    return compressedPages;
+}
+
+
+bool difont::TextureFontImpl::LcdRendering(bool enable, const unsigned char *filter)
+{
+    int wanted = enable ? 3 : 1;
+    const unsigned char *weights = filter ? filter : difont::LcdRasterizer::DEFAULT_FILTER;
+    if(wanted == channels
+       && (!enable || memcmp(weights, lcdRasterizer.Filter(),
+                             difont::LcdRasterizer::FILTER_TAPS) == 0))
+    {
+        return channels == 3;
+    }
+
+    SaveCache();
+    channels = wanted;
+    lcdRasterizer.Filter(weights);
+
+    Refresh();
+
+    return channels == 3;
+}
+
+
+void difont::TextureFontImpl::CacheDirectory(const char* path)
+{
+    std::string directory(path ? path : "");
+    if(directory == cacheDirectory)
+    {
+        return;
+    }
+
+    SaveCache();
+    cacheDirectory = directory;
+
+    Refresh();
+}
+
+
+//
+//  Atlas cache file
+//
+//  The file is a CacheHeader, then a CachePage for each texture, then a
+//  CacheRegion for each glyph bitmap, then the pixels of each texture.
+//  Everything is stored in the native byte order of the device that wrote
+//  it; files from other devices fail the byteOrder check.
+//
+
+namespace {
+    const char CACHE_MAGIC[4] = { 'D', 'F', 'A', 'C' };
+
+    /**
+     * Bump whenever the layout of the file or the way glyphs are
+     * rasterised changes.
+     */
+    const uint32_t CACHE_VERSION = 4;
+
+    const uint32_t CACHE_BYTE_ORDER = 0x01020304;
+
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t headerSize;
+
+        // The key. A file is only used if all of these match.
+        uint64_t fontHash;
+        uint32_t size;
+        uint32_t resolution;
+        int32_t loadFlags;
+        uint32_t subpixelPhases;
+        uint32_t padding;
+        uint32_t mipmapLevels;
+        uint32_t glyphWidth;
+        uint32_t glyphHeight;
+        uint32_t channels;
+        unsigned char lcdFilter[8];
+
+        uint32_t pageCount;
+        uint32_t regionCount;
+        uint32_t glyphCount;
+
+        // Where the next bitmap goes on the last page.
+        int32_t xOffset;
+        int32_t yOffset;
+
+        // The length of the whole file, and a hash of the page and
+        // region tables.
+        uint64_t fileLength;
+        uint64_t tableHash;
+    };
+
+    struct CachePage {
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;
+    };
+
+    struct CacheRegion {
+        uint32_t glyphIndex;
+        uint32_t phase;
+        int32_t page;
+        int32_t x, y, width, height;
+        float corner[2];
+        float advance[2];
+        float lower[3];
+        float upper[3];
+    };
+}
+
+
+std::string difont::TextureFontImpl::CachePath()
+{
+    char name[64];
+    sprintf(name, "difont-%016llx-%u-%u-%x.atlas",
+            static_cast<unsigned long long>(face.ContentHash()),
+            rasterSize, resolution, static_cast<unsigned int>(load_flags));
+
+    std::string path(cacheDirectory);
+    if(!path.empty() && path[path.size() - 1] != '/' && path[path.size() - 1] != '\\')
+    {
+        path += '/';
+    }
+
+    return path + name;
+}
+
+
+bool difont::TextureFontImpl::LoadCache()
+{
+    if(cacheDirectory.empty() || !face.ContentHash())
+    {
+        return false;
+    }
+
+    difont::MappedFile file;
+    if(!file.Open(CachePath().c_str()) || file.Length() < sizeof(CacheHeader))
+    {
+        return false;
+    }
+
+    const unsigned char *data = file.Data();
+
+    CacheHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    if(memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+       || header.version != CACHE_VERSION
+       || header.byteOrder != CACHE_BYTE_ORDER
+       || header.headerSize != sizeof(CacheHeader)
+       || header.fileLength != file.Length()
+       || header.fontHash != face.ContentHash()
+       || header.size != rasterSize
+       || header.resolution != resolution
+       || header.loadFlags != load_flags
+       || header.subpixelPhases != subpixelPhases
+       || header.padding != padding
+       || header.mipmapLevels != mipmapLevels
+       || header.glyphWidth != static_cast<uint32_t>(glyphWidth)
+       || header.glyphHeight != static_cast<uint32_t>(glyphHeight)
+       || header.channels != static_cast<uint32_t>(channels)
+       || (channels == 3 && memcmp(header.lcdFilter, lcdRasterizer.Filter(),
+                                   difont::LcdRasterizer::FILTER_TAPS) != 0)
+       || header.glyphCount > numGlyphs)
+    {
+        return false;
+    }
+
+    // Check the tables fit before hashing them.
+    uint64_t tableLength = static_cast<uint64_t>(header.pageCount) * sizeof(CachePage)
+                         + static_cast<uint64_t>(header.regionCount) * sizeof(CacheRegion);
+    if(tableLength > file.Length() - sizeof(CacheHeader)
+       || Fnv1a64(data + sizeof(CacheHeader), static_cast<size_t>(tableLength)) != header.tableHash)
+    {
+        return false;
+    }
+
+    std::vector<CachePage> cachePages(header.pageCount);
+    std::vector<CacheRegion> cacheRegions(header.regionCount);
+    if(header.pageCount)
+    {
+        memcpy(&cachePages[0], data + sizeof(CacheHeader),
+               header.pageCount * sizeof(CachePage));
+    }
+    if(header.regionCount)
+    {
+        memcpy(&cacheRegions[0], data + sizeof(CacheHeader) + header.pageCount * sizeof(CachePage),
+               header.regionCount * sizeof(CacheRegion));
+    }
+
+    for(size_t i = 0; i < cachePages.size(); ++i)
+    {
+        const CachePage& p = cachePages[i];
+        uint64_t pageLength = static_cast<uint64_t>(p.width) * p.height * channels;
+        if(!p.width || !p.height || p.width > 16384 || p.height > 16384
+           || p.offset > file.Length() || pageLength > file.Length() - p.offset)
+        {
+            return false;
+        }
+
+        // The layers of a texture array must all be the same size.
+        if(arrayPages && (p.width != cachePages[0].width || p.height != cachePages[0].height))
+        {
+            return false;
+        }
+    }
+
+    for(size_t i = 0; i < cacheRegions.size(); ++i)
+    {
+        const CacheRegion& r = cacheRegions[i];
+        if(r.phase >= subpixelPhases || r.glyphIndex >= numGlyphs
+           || r.page >= static_cast<int32_t>(cachePages.size()) || r.page < -1
+           || r.width < 0 || r.height < 0)
+        {
+            return false;
+        }
+
+        if(r.width && r.height)
+        {
+            // Subtracted rather than added, so large values can't wrap.
+            if(r.page < 0 || r.x < 0 || r.y < 0
+               || r.width > static_cast<int32_t>(cachePages[r.page].width) - r.x
+               || r.height > static_cast<int32_t>(cachePages[r.page].height) - r.y)
+            {
+                return false;
+            }
+        }
+    }
+
+    // The header isn't hashed, and the next glyph is written where its
+    // offsets point, so they must be a place AllocateRegion() or a repack
+    // could have left them: on the last page, or just past its right or
+    // bottom edge so the next glyph starts a new row or page.
+    // AllocateRegion() checks each bitmap fits below them.
+    if(!cachePages.empty())
+    {
+        int alignment = 1 << mipmapLevels;
+        int gutter = AlignUp(static_cast<int>(padding), alignment);
+        int width = static_cast<int>(cachePages.back().width);
+        int height = static_cast<int>(cachePages.back().height);
+
+        if(header.xOffset < gutter || header.xOffset > width
+           || header.yOffset < gutter || header.yOffset > AlignUp(height + gutter, alignment)
+           || header.xOffset % alignment || header.yOffset % alignment)
+        {
+            return false;
+        }
+    }
+
+    // The file is good, upload the pages straight from the mapping.
+    for(size_t i = 0; i < cachePages.size(); ++i)
+    {
+        CreateTexture(cachePages[i].width, cachePages[i].height,
+                      data + cachePages[i].offset);
+    }
+
+    for(size_t i = 0; i < cacheRegions.size(); ++i)
+    {
+        const CacheRegion& r = cacheRegions[i];
+
+        TextureRegion region;
+        region.page = r.page;
+        region.glyphIndex = r.glyphIndex;
+        region.phase = r.phase;
+        region.x = r.x;
+        region.y = r.y;
+        region.width = r.width;
+        region.height = r.height;
+        region.corner = difont::Point(r.corner[0], r.corner[1]);
+        region.advance = difont::Point(r.advance[0], r.advance[1]);
+        region.bBox = difont::BBox(r.lower[0], r.lower[1], r.lower[2],
+                                   r.upper[0], r.upper[1], r.upper[2]);
+
+        float w = r.page < 0 ? 1.0f : static_cast<float>(pages[r.page].width);
+        float h = r.page < 0 ? 1.0f : static_cast<float>(pages[r.page].height);
+        region.uv[0] = difont::Point(r.x / w, r.y / h);
+        region.uv[1] = difont::Point((r.x + r.width) / w, (r.y + r.height) / h);
+
+        regionIndex[r.glyphIndex * difont::TextureFont::MAX_SUBPIXEL_PHASES + r.phase] =
+            static_cast<int>(regions.size());
+        regions.push_back(region);
+    }
+
+    if(!pages.empty())
+    {
+        textureWidth = pages.back().width;
+        textureHeight = pages.back().height;
+        xOffset = header.xOffset;
+        yOffset = header.yOffset;
+
+        int lastPage = static_cast<int>(pages.size()) - 1;
+        shelfHeight = 0;
+        for(size_t i = 0; i < regions.size(); ++i)
+        {
+            if(regions[i].page == lastPage && regions[i].y == yOffset)
+            {
+                shelfHeight = std::max(shelfHeight, regions[i].height);
+            }
+        }
+    }
+
+    remGlyphs = numGlyphs - header.glyphCount;
+    cacheDirty = false;
+
+    return true;
+}
+
+
+bool difont::TextureFontImpl::SaveCache()
+{
+    if(cacheDirectory.empty() || !cacheDirty || !rasterSize
+       || !face.ContentHash())
+    {
+        return false;
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.byteOrder = CACHE_BYTE_ORDER;
+    header.headerSize = sizeof(CacheHeader);
+    header.fontHash = face.ContentHash();
+    header.size = rasterSize;
+    header.resolution = resolution;
+    header.loadFlags = load_flags;
+    header.subpixelPhases = subpixelPhases;
+    header.padding = padding;
+    header.mipmapLevels = mipmapLevels;
+    header.glyphWidth = glyphWidth;
+    header.glyphHeight = glyphHeight;
+    header.channels = channels;
+    if(channels == 3)
+    {
+        memcpy(header.lcdFilter, lcdRasterizer.Filter(), difont::LcdRasterizer::FILTER_TAPS);
+    }
+    header.pageCount = static_cast<uint32_t>(pages.size());
+    header.regionCount = static_cast<uint32_t>(regions.size());
+    header.glyphCount = numGlyphs - remGlyphs;
+    header.xOffset = xOffset;
+    header.yOffset = yOffset;
+
+    std::vector<CachePage> cachePages(pages.size());
+    uint64_t offset = sizeof(CacheHeader) + pages.size() * sizeof(CachePage)
+                    + regions.size() * sizeof(CacheRegion);
+    for(size_t i = 0; i < pages.size(); ++i)
+    {
+        cachePages[i].width = pages[i].width;
+        cachePages[i].height = pages[i].height;
+        cachePages[i].offset = offset;
+        offset += static_cast<uint64_t>(pages[i].width) * pages[i].height * channels;
+    }
+    header.fileLength = offset;
+
+    std::vector<CacheRegion> cacheRegions(regions.size());
+    for(size_t i = 0; i < regions.size(); ++i)
+    {
+        const TextureRegion& region = regions[i];
+        CacheRegion& r = cacheRegions[i];
+        memset(&r, 0, sizeof(r));
+        r.glyphIndex = region.glyphIndex;
+        r.phase = region.phase;
+        r.page = region.page;
+        r.x = region.x;
+        r.y = region.y;
+        r.width = region.width;
+        r.height = region.height;
+        r.corner[0] = region.corner.Xf();
+        r.corner[1] = region.corner.Yf();
+        r.advance[0] = region.advance.Xf();
+        r.advance[1] = region.advance.Yf();
+        r.lower[0] = region.bBox.Lower().Xf();
+        r.lower[1] = region.bBox.Lower().Yf();
+        r.lower[2] = region.bBox.Lower().Zf();
+        r.upper[0] = region.bBox.Upper().Xf();
+        r.upper[1] = region.bBox.Upper().Yf();
+        r.upper[2] = region.bBox.Upper().Zf();
+    }
+
+    header.tableHash = FNV1A_64_INIT;
+    if(!cachePages.empty())
+    {
+        header.tableHash = Fnv1a64(&cachePages[0], cachePages.size() * sizeof(CachePage),
+                                   header.tableHash);
+    }
+    if(!cacheRegions.empty())
+    {
+        header.tableHash = Fnv1a64(&cacheRegions[0], cacheRegions.size() * sizeof(CacheRegion),
+                                   header.tableHash);
+    }
+
+    // Write to a temporary file and rename it, so a reader never sees a
+    // partly written cache.
+    std::string path = CachePath();
+    std::string tempPath = path + ".tmp";
+
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if(!file)
+    {
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if(ok && !cachePages.empty())
+    {
+        ok = fwrite(&cachePages[0], sizeof(CachePage), cachePages.size(), file) == cachePages.size();
+    }
+    if(ok && !cacheRegions.empty())
+    {
+        ok = fwrite(&cacheRegions[0], sizeof(CacheRegion), cacheRegions.size(), file) == cacheRegions.size();
+    }
+    for(size_t i = 0; ok && i < pages.size(); ++i)
+    {
+        size_t pageLength = pages[i].width * pages[i].height * channels;
+        ok = fwrite(pages[i].pixels, 1, pageLength, file) == pageLength;
+    }
+
+    if(fclose(file) != 0)
+    {
+        ok = false;
+    }
+
+    // rename() won't replace an existing file on Windows.
+    remove(path.c_str());
+    if(!ok || rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        remove(tempPath.c_str());
+        return false;
+    }
+
+    cacheDirty = false;
+    return true;
+}
+
+
+void difont::TextureFontImpl::SubpixelPhases(unsigned int phases)
+{
+    if(phases < 1)
+    {
+        phases = 1;
+    }
+    else if(phases > difont::TextureFont::MAX_SUBPIXEL_PHASES)
+    {
+        phases = difont::TextureFont::MAX_SUBPIXEL_PHASES;
+    }
+
+    if(phases == subpixelPhases)
+    {
+        return;
+    }
+
+    SaveCache();
+    subpixelPhases = phases;
+
+    // Glyphs already loaded hold regions for the old phase count.
+    Refresh();
+}
+
+
+template <typename T>
+inline difont::Point difont::TextureFontImpl::RenderI(const T* string, const int len,
+                                          difont::Point position, difont::Point spacing,
+                                          int renderMode)
+{
+	disableTexture2D = false;
+	disableBlend = false;
+
+    // Bitmaps finished in the background are drawn this frame.
+    LandRegions();
+
+    difont::Point tmp = RenderGlyphs<T, TextureGlyphImpl>(string, len, position,
+                                                        spacing, renderMode);
+    Flush();
+    return tmp;
+}
+
+
+void difont::TextureFontImpl::PreRender() 
+{
+}
+
+
+void difont::TextureFontImpl::PostRender() 
+{
+}
+
+
+difont::Point difont::TextureFontImpl::Render(const char * string, const int len,
+                                  difont::Point position, difont::Point spacing,
+                                  int renderMode)
+{
+    return RenderI(string, len, position, spacing, renderMode);
+}
+
+
+difont::Point difont::TextureFontImpl::Render(const wchar_t * string, const int len,
+                                  difont::Point position, difont::Point spacing,
+                                  int renderMode)
+{
+    
+    return RenderI(string, len, position, spacing, renderMode);
+}
+
+
+difont::Point difont::TextureFontImpl::RenderRun(const Font::GlyphRun& run,
+                                                 difont::Point position, int renderMode)
+{
+    return RenderI(&run, run.count, position, difont::Point(), renderMode);
 }
 
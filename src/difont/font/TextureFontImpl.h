@@ -28,13 +28,99 @@
 #define _DIFONT_TEXTURE_FONT_IMPL_H_
 
 #include "FontImpl.h"
+#include "AccumulationRasterizer.h"
+#include "LcdRasterizer.h"
+#include "RasterWorkers.h"
+#include <list>
+#include <map>
+#include <set>
+#include <string>
 #include <vector>
 
 namespace difont {
     class TextureGlyph;
+    class TextureGlyphImpl;
+
+    /**
+     * A rasterised glyph bitmap and its location in one of the font's
+     * textures.
+     */
+    struct TextureRegion {
+        /**
+         * The index of the texture that holds the bitmap in the font's
+         * pages, or -1 if no texture has been created yet.
+         */
+        int page;
+
+        /**
+         * The glyph and subpixel phase the bitmap was rasterised from.
+         */
+        unsigned int glyphIndex, phase;
+
+        /**
+         * The position and size of the bitmap within the texture.
+         */
+        int x, y, width, height;
+
+        /**
+         * Vector from the pen position to the topleft corner of the bitmap
+         */
+        difont::Point corner;
+
+        /**
+         * The texture co-ords of the bitmap within the texture.
+         */
+        difont::Point uv[2];
+
+        /**
+         * The advance and bounding box of the glyph as loaded from the
+         * face, so it can be recreated without FreeType.
+         */
+        difont::Point advance;
+        difont::BBox bBox;
+    };
+
+    /**
+     * One of the font's textures, and a copy of its pixels so the atlas
+     * can be written to the cache. With texture array pages every page is
+     * a layer of the same texture.
+     */
+    struct TexturePage {
+        GLuint textureID;
+        GLsizei width, height;
+        unsigned char *pixels;
+
+        /**
+         * The downsampled copies of the pixels, level 1 first, or
+         * <code>NULL</code> for levels that aren't used.
+         */
+        unsigned char *mipmaps[difont::TextureFont::MAX_MIPMAP_LEVELS];
+
+        /**
+         * The rows of the pixels changed since they were last uploaded.
+         * Empty when <code>dirtyTop >= dirtyBottom</code>.
+         */
+        int dirtyTop, dirtyBottom;
+
+        /**
+         * Whether a later page has been started, so no more glyphs go
+         * into this one, and whether the texture has been replaced with
+         * compressed blocks.
+         */
+        bool sealed, compressed;
+
+        /**
+         * Get the pixels of a mipmap level, 0 being the full size.
+         */
+        unsigned char *Level(unsigned int level) const
+        {
+            return level ? mipmaps[level - 1] : pixels;
+        }
+    };
 
     class TextureFontImpl : public FontImpl {
         friend class difont::TextureFont;
+        friend class TextureGlyphImpl;
 
     protected:
         TextureFontImpl(Font *ftFont, const char* fontFilePath);
@@ -62,17 +148,419 @@ namespace difont {
                                      difont::Point position, difont::Point spacing,
                                      int renderMode);
 
+        virtual difont::Point RenderRun(const Font::GlyphRun& run,
+                                        difont::Point position, int renderMode);
+
         void PreRender();
 
 
         void PostRender();
 
+        /**
+         * Set the number of horizontal subpixel phases.
+         */
+        void SubpixelPhases(unsigned int phases);
+
+        /**
+         * Get the number of horizontal subpixel phases.
+         */
+        unsigned int SubpixelPhases() const { return subpixelPhases; }
+
+        /**
+         * Rasterise glyphs on background threads. Zero threads turns it
+         * off; glyphs still waiting are then rasterised straight away.
+         */
+        void AsyncRasterization(unsigned int threads,
+                                difont::TextureFont::GlyphsReadyCallback callback,
+                                void* userData);
+
+        /**
+         * Set the number of mipmap levels built below the full size
+         * texture. Glyphs already loaded are discarded.
+         *
+         * @return  The number of levels in use.
+         */
+        unsigned int MipmapLevels(unsigned int levels);
+
+        /**
+         * Upload the rows of the pages changed since the last flush, with
+         * their mipmaps.
+         */
+        void Flush();
+
+        /**
+         * Use one texture array for all pages instead of a texture per
+         * page. Glyphs already loaded are discarded.
+         *
+         * @return  <code>true</code> if texture array pages are in use.
+         */
+        bool TextureArrayPages(bool useArray);
+
+        /**
+         * Check if the pages are layers of one texture array.
+         */
+        bool TextureArrayPages() const { return arrayPages; }
+
+        /**
+         * Block compress the pages that are full. Glyphs already loaded
+         * are discarded.
+         *
+         * @return  <code>true</code> if full pages will be compressed.
+         */
+        bool CompressedPages(bool compress);
+
+        /**
+         * Rasterise glyphs for LCD screens into RGB pages, with a filter
+         * of <code>LcdRasterizer::FILTER_TAPS</code> weights or
+         * <code>NULL</code> for the default. Glyphs already loaded are
+         * discarded.
+         *
+         * @return  <code>true</code> if glyphs are rasterised for LCDs.
+         */
+        bool LcdRendering(bool enable, const unsigned char *filter);
+
+        /**
+         * Check if glyphs are rasterised for LCD screens.
+         */
+        bool LcdRendering() const { return channels == 3; }
+
+        /**
+         * Round face sizes up to the next of a geometric series of sizes,
+         * or of a list of sizes, when rasterising glyphs. A ratio of 1 or
+         * less and an empty list turn it off.
+         */
+        void SizeBuckets(float ratio, const unsigned int *sizes, unsigned int count);
+
+        /**
+         * Get the size the atlas is rasterised at for a face size.
+         */
+        unsigned int BucketSize(unsigned int size) const;
+
+        /**
+         * Get the scale from the atlas's bitmaps to the face size.
+         */
+        float QuadScale() const { return quadScale; }
+
+        /**
+         * Get the advance and bounding box of a glyph at the face size
+         * from its region, which may have been rasterised at another size.
+         */
+        void RegionMetrics(const TextureRegion& region, difont::Point& advance,
+                           difont::BBox& bBox);
+
+        /**
+         * Count the pages and the texels used in them.
+         */
+        difont::TextureFont::AtlasStats AtlasOccupancy() const;
+
+        /**
+         * Repack the bitmaps of up to <code>maxPages</code> of the least
+         * full pages, or all of them for 0, if that frees any pages.
+         */
+        difont::TextureFont::CompactionStats Compact(unsigned int maxPages);
+
+        /**
+         * Get the texture holding a page, or 0 for no page.
+         */
+        GLuint PageTexture(int page) const
+        {
+            return page < 0 ? 0 : pages[page].textureID;
+        }
+
+        /**
+         * Get the GL format of the pages' pixels.
+         */
+        GLenum PageFormat() const
+        {
+            return channels == 3 ? GL_RGB : GL_ALPHA;
+        }
+
+        /**
+         * Set the glyph loading flags. Glyphs already loaded are discarded.
+         */
+        virtual void GlyphLoadFlags(FT_Int flags);
+
+        /**
+         * Set the directory the glyph atlas is cached in. An empty path
+         * disables the cache.
+         */
+        void CacheDirectory(const char* path);
+
+        /**
+         * Write the glyph atlas to the cache directory if it has changed
+         * since it was loaded or last written.
+         *
+         * @return  <code>true</code> if the cache file was written.
+         */
+        bool SaveCache();
+
     private:
         /**
          * Create an TextureGlyph object for the base class.
          */
         Glyph* MakeGlyphImpl(FT_GlyphSlot ftGlyph);
 
+        /**
+         * Create a TextureGlyph from regions loaded from the cache.
+         */
+        virtual Glyph* MakeCachedGlyph(unsigned int glyphIndex);
+
+        /**
+         * Find the region holding a glyph at a subpixel phase.
+         *
+         * @return  The index of the region, or -1 if there isn't one.
+         */
+        int FindRegion(unsigned int glyphIndex, unsigned int phase) const;
+
+        /**
+         * Rasterise the outline in <code>ftGlyph</code>, shifted right by
+         * <code>phase</code> / <code>subpixelPhases</code> pixels, into
+         * the current texture.
+         *
+         * @return  The index of the new region, or -1 on failure.
+         */
+        int MakeRegion(FT_GlyphSlot ftGlyph, unsigned int phase);
+
+        /**
+         * Rasterise an outline straight into the atlas, without going
+         * through the glyph slot's bitmap, and record its region.
+         *
+         * @return  The index of the new region, or -1 on failure.
+         */
+        int RasterizeRegion(FT_GlyphSlot ftGlyph, unsigned int phase,
+                            const difont::Point& advance, const difont::BBox& bBox);
+
+        /**
+         * Copy a bitmap into the atlas and record its region.
+         *
+         * @return  The index of the new region.
+         */
+        int AddRegion(unsigned int glyphIndex, unsigned int phase,
+                      const unsigned char *bitmap, int width, int height, int pitch,
+                      const difont::Point& corner, const difont::Point& advance,
+                      const difont::BBox& bBox);
+
+        /**
+         * Find room in the atlas for a <code>width</code> x
+         * <code>height</code> bitmap and record its region.
+         *
+         * @return  The index of the new region, or -1 if the bitmap is
+         *          bigger than a page.
+         */
+        int PlaceRegion(unsigned int glyphIndex, unsigned int phase,
+                        int width, int height, const difont::Point& corner,
+                        const difont::Point& advance, const difont::BBox& bBox);
+
+        /**
+         * Get the region for a glyph at a subpixel phase, rasterising it
+         * now or, with background rasterisation, queueing it.
+         *
+         * @return  The index of the region, or -1 if there isn't one yet.
+         */
+        int RequestRegion(unsigned int glyphIndex, unsigned int phase);
+
+        /**
+         * Queue a glyph at a subpixel phase for the background threads,
+         * unless it is already queued.
+         */
+        void QueueRegion(unsigned int glyphIndex, unsigned int phase);
+
+        /**
+         * Give a glyph that has no bitmap yet the advance of the real
+         * glyph and a box the height of the face, and queue its bitmap.
+         */
+        void WaitForRegion(TextureGlyphImpl *glyph);
+
+        /**
+         * Stop waiting for a glyph's bitmap, as the glyph is being deleted.
+         */
+        void ForgetWaitingGlyph(TextureGlyphImpl *glyph);
+
+        /**
+         * Fill in a waiting glyph from its region, if it has one.
+         */
+        void FinishGlyph(TextureGlyphImpl *glyph, int index);
+
+        /**
+         * Add the bitmaps finished by the background threads to the atlas
+         * and fill in the glyphs waiting for them.
+         */
+        void LandRegions();
+
+        /**
+         * Land the finished bitmaps, drop the queued ones and rasterise
+         * the glyphs still waiting on this thread.
+         */
+        void SettleWaitingGlyphs();
+
+        /**
+         * Forget the queued and waiting glyphs, which are about to be
+         * discarded.
+         */
+        void CancelWaitingGlyphs();
+
+        /**
+         * The RasterWorkers callback, called on a worker thread.
+         */
+        static void GlyphsReady(void *font);
+
+        /**
+         * Load the glyph at <code>glyphIndex</code> and rasterise it at the
+         * given subpixel phase.
+         *
+         * @return  The index of the new region, or -1 on failure.
+         */
+        int MakeRegion(unsigned int glyphIndex, unsigned int phase);
+
+        /**
+         * Get a region created by <code>MakeRegion</code>.
+         */
+        const TextureRegion& Region(int index) const { return regions[index]; }
+
+        /**
+         * Find room for a <code>width</code> x <code>height</code> bitmap,
+         * creating a new texture if the current one is full.
+         *
+         * @return  The index of the page that the space was found in, or
+         *          -1 if the bitmap is bigger than a page.
+         */
+        int AllocateRegion(int width, int height, int& x, int& y);
+
+        /**
+         * Copy a bitmap into a page's pixels, to be uploaded by the next
+         * <code>Flush</code>. The bitmap has <code>channels</code> bytes
+         * per pixel and <code>pitch</code> bytes per row.
+         */
+        void WriteRegion(int page, int x, int y, int width, int height,
+                         const unsigned char *bitmap, int pitch);
+
+        /**
+         * Mark the rows from <code>top</code> to <code>bottom</code> of a
+         * page to be uploaded by the next <code>Flush</code>.
+         */
+        void TouchRows(int page, int top, int bottom);
+
+        /**
+         * Rebuild the mipmaps of the full size rows from <code>top</code>
+         * to <code>bottom</code>, which are multiples of the texel size of
+         * the smallest level.
+         */
+        void BuildMipmaps(TexturePage& page, int top, int bottom);
+
+        /**
+         * Replace a page's texture with its pixels and mipmaps block
+         * compressed. The mipmaps must be up to date.
+         */
+        void CompressPage(int page);
+
+        /**
+         * Upload whole rows of one mipmap level of a page.
+         */
+        void UploadRows(int page, unsigned int level, int top, int bottom);
+
+        /**
+         * Grow the texture array so it has a layer for every page,
+         * copying the existing pages into the new texture.
+         */
+        void GrowTextureArray();
+
+        /**
+         * Delete the textures and their pixels.
+         */
+        void ReleaseTextures();
+
+        /**
+         * Delete the textures and pixels of a list of pages.
+         */
+        static void ReleasePages(std::vector<TexturePage>& atlasPages);
+
+        /**
+         * The atlas of another bucket size, kept so that switching back
+         * to it doesn't rasterise its glyphs again.
+         */
+        struct StashedAtlas {
+            StashedAtlas()
+            :   rasterSize(0), resolution(0), textureWidth(0), textureHeight(0),
+                arrayLayers(0), glyphHeight(0), glyphWidth(0), numGlyphs(0),
+                remGlyphs(0), xOffset(0), yOffset(0), shelfHeight(0),
+                cacheDirty(false)
+            {}
+
+            unsigned int rasterSize;
+            unsigned int resolution;
+            GLsizei textureWidth, textureHeight;
+            std::vector<TexturePage> pages;
+            GLsizei arrayLayers;
+            int glyphHeight, glyphWidth;
+            unsigned int numGlyphs, remGlyphs;
+            int xOffset, yOffset, shelfHeight;
+            std::vector<TextureRegion> regions;
+            std::map<unsigned int, int> regionIndex;
+            bool cacheDirty;
+        };
+
+        /**
+         * Exchange the current atlas with a stashed one.
+         */
+        void SwapAtlas(StashedAtlas& atlas);
+
+        /**
+         * Put the current atlas aside, leaving an empty one.
+         */
+        void StashAtlas();
+
+        /**
+         * Make a stashed atlas the current one, if there is one for the
+         * bucket size and resolution.
+         */
+        bool RestoreAtlas(unsigned int bucket, unsigned int res);
+
+        /**
+         * Delete the least recently stashed atlases over a count, and the
+         * glyphs of other sizes that may have come from them.
+         */
+        void TrimStashedAtlases(unsigned int keep);
+
+        /**
+         * Delete the stashed atlases.
+         */
+        void ReleaseStashedAtlases();
+
+        /**
+         * Whether a glyph is a texture glyph still waiting for its bitmap.
+         */
+        static bool IsWaiting(const GlyphImpl* impl, void* context);
+
+        /**
+         * Discard the glyphs and the atlas, after a change to the way
+         * glyphs are rasterised.
+         */
+        void Refresh();
+
+        /**
+         * Get the path of the cache file for the current face, size and
+         * load flags.
+         */
+        std::string CachePath();
+
+        /**
+         * Replace the textures and regions with those in the cache file,
+         * if it exists and matches the current face, size and load flags.
+         *
+         * @return  <code>true</code> if the cache was loaded.
+         */
+        bool LoadCache();
+
+        /**
+         * Get the largest glyph size for a face size. A size other than
+         * the current one is set on a FreeType size of its own for the
+         * time it takes, so it doesn't take the place of a size kept
+         * with its glyphs.
+         *
+         * @return  <code>false</code> if the face can't be set to the size.
+         */
+        bool CalculateGlyphSize(const unsigned int size, const unsigned int res);
+
         /**
          * Get the size of a block of memory required to layout the glyphs
          *
@@ -82,16 +570,32 @@ namespace difont {
         inline void CalculateTextureSize();
 
         /**
-         * Creates a 'blank' OpenGL texture object.
+         * Creates an OpenGL texture object, or a layer of the texture
+         * array, and appends it to the pages. If <code>pixels</code> is
+         * <code>NULL</code> the texture is blank.
          *
-         * The format is GL_ALPHA and the params are
+         * The format is GL_ALPHA, or GL_RGB for LCD rendering, and the
+         * params are
          * GL_TEXTURE_WRAP_S = GL_CLAMP
          * GL_TEXTURE_WRAP_T = GL_CLAMP
          * GL_TEXTURE_MAG_FILTER = GL_LINEAR
-         * GL_TEXTURE_MIN_FILTER = GL_LINEAR
-         * Note that mipmapping is NOT used
+         * GL_TEXTURE_MIN_FILTER = GL_LINEAR, or GL_LINEAR_MIPMAP_LINEAR
+         * with mipmap levels
+         */
+        void CreateTexture(GLsizei width, GLsizei height,
+                           const unsigned char *pixels = NULL);
+
+        /**
+         * Allocate the blank pixels and mipmaps of a page, without a
+         * texture.
+         */
+        TexturePage AllocatePage(GLsizei width, GLsizei height) const;
+
+        /**
+         * Give a page its texture, or its layer of the texture array, and
+         * upload its pixels.
          */
-        inline GLuint CreateTexture();
+        void CreatePageTexture(int index);
 
         /**
          * The maximum texture dimension on this OpenGL implemetation
@@ -109,9 +613,9 @@ namespace difont {
         GLsizei textureHeight;
 
         /**
-         *An array of texture ids
+         * The textures the glyphs are packed into
          */
-        std::vector<GLuint> textureIDList;
+        std::vector<TexturePage> pages;
 
         /**
          * The max height for glyphs in the current font
@@ -146,6 +650,126 @@ namespace difont {
          */
         int yOffset;
 
+        /**
+         * The height of the tallest bitmap on the row at
+         * <code>yOffset</code>.
+         */
+        int shelfHeight;
+
+        /**
+         * The bitmaps of all the glyphs loaded into the textures
+         */
+        std::vector<TextureRegion> regions;
+
+        /**
+         * The number of horizontal subpixel phases glyphs are rasterised at
+         */
+        unsigned int subpixelPhases;
+
+        /**
+         * The resolution passed to the last call to FaceSize
+         */
+        unsigned int resolution;
+
+        /**
+         * The ratio between bucket sizes, or 0 for none
+         */
+        float bucketRatio;
+
+        /**
+         * The bucket sizes, smallest first, used instead of the ratio
+         */
+        std::vector<unsigned int> bucketSizes;
+
+        /**
+         * The size the atlas is rasterised at, and the face size over it
+         */
+        unsigned int rasterSize;
+        float quadScale;
+
+        /**
+         * The number of mipmap levels below the full size pages
+         */
+        unsigned int mipmapLevels;
+
+        /**
+         * Whether the pages are layers of one GL_TEXTURE_2D_ARRAY
+         */
+        bool arrayPages;
+
+        /**
+         * The number of layers allocated in the texture array
+         */
+        GLsizei arrayLayers;
+
+        /**
+         * Whether full pages are block compressed
+         */
+        bool compressedPages;
+
+        /**
+         * The bytes per texel of the pages: 1 for coverage, or 3 for the
+         * red, green and blue stripes of LCD rendering
+         */
+        int channels;
+
+        /**
+         * Rasterises outlines on this thread
+         */
+        difont::AccumulationRasterizer rasterizer;
+
+        /**
+         * Rasterises outlines on this thread for LCD rendering, and holds
+         * its filter
+         */
+        difont::LcdRasterizer lcdRasterizer;
+
+        /**
+         * The background threads, or <code>NULL</code> if glyphs are
+         * rasterised when they are first used
+         */
+        difont::RasterWorkers *workers;
+
+        /**
+         * Bumped whenever queued glyphs are dropped, so late results can
+         * be told apart
+         */
+        unsigned int generation;
+
+        /**
+         * The glyphs and phases queued for the background threads, keyed
+         * like <code>regionIndex</code>
+         */
+        std::set<unsigned int> queuedRegions;
+
+        /**
+         * Glyphs waiting for their phase 0 bitmap, keyed by glyph index
+         */
+        std::multimap<unsigned int, TextureGlyphImpl*> waitingGlyphs;
+
+        difont::TextureFont::GlyphsReadyCallback readyCallback;
+        void *readyUserData;
+
+        /**
+         * Region indices keyed by glyph index and subpixel phase
+         */
+        std::map<unsigned int, int> regionIndex;
+
+        /**
+         * The atlases of recently used bucket sizes, the latest first
+         */
+        std::list<StashedAtlas> stashedAtlases;
+
+        /**
+         * The directory the atlas is cached in, empty if it isn't cached
+         */
+        std::string cacheDirectory;
+
+        /**
+         * Set when regions have been added since the cache was written
+         */
+        bool cacheDirty;
+
         bool preRendered;
 
         bool disableTexture2D;
@@ -0,0 +1,353 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "AccumulationRasterizer.h"
+
+#include FT_OUTLINE_H
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DIFONT_ACCUMULATE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define DIFONT_ACCUMULATE_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace difont;
+
+
+// How far the lines that curves are flattened into may stray, in pixels.
+static const float TOLERANCE = 1.0f / 32.0f;
+
+
+bool AccumulationRasterizer::Render(const FT_Outline* outline, int left, int top,
+                                    int width, int height, unsigned char* pixels,
+                                    int pitch)
+{
+    if(outline->flags & FT_OUTLINE_EVEN_ODD_FILL)
+    {
+        return false;
+    }
+
+    if(!width || !height)
+    {
+        return true;
+    }
+
+    this->left = left;
+    this->top = top;
+    this->width = width;
+    this->height = height;
+
+    // Room for the edges on the right border, and for whole vectors.
+    stride = (width + 2 + 3) & ~3;
+    areas.assign(stride * height, 0.0f);
+
+    FT_Outline_Funcs funcs;
+    funcs.move_to = MoveTo;
+    funcs.line_to = LineTo;
+    funcs.conic_to = ConicTo;
+    funcs.cubic_to = CubicTo;
+    funcs.shift = 0;
+    funcs.delta = 0;
+
+    penX = penY = 0.0f;
+    if(FT_Outline_Decompose(const_cast<FT_Outline*>(outline), &funcs, this))
+    {
+        return false;
+    }
+
+    Accumulate(pixels, pitch);
+    return true;
+}
+
+
+void AccumulationRasterizer::Map(const FT_Vector* point, float& x, float& y) const
+{
+    x = static_cast<float>(point->x) / 64.0f - static_cast<float>(left);
+    y = static_cast<float>(top) - static_cast<float>(point->y) / 64.0f;
+}
+
+
+int AccumulationRasterizer::MoveTo(const FT_Vector* to, void* user)
+{
+    AccumulationRasterizer* self = static_cast<AccumulationRasterizer*>(user);
+    self->Map(to, self->penX, self->penY);
+    return 0;
+}
+
+
+int AccumulationRasterizer::LineTo(const FT_Vector* to, void* user)
+{
+    AccumulationRasterizer* self = static_cast<AccumulationRasterizer*>(user);
+    float x, y;
+    self->Map(to, x, y);
+    self->Line(self->penX, self->penY, x, y);
+    self->penX = x;
+    self->penY = y;
+    return 0;
+}
+
+
+int AccumulationRasterizer::ConicTo(const FT_Vector* control, const FT_Vector* to,
+                                    void* user)
+{
+    AccumulationRasterizer* self = static_cast<AccumulationRasterizer*>(user);
+    float x0 = self->penX, y0 = self->penY;
+    float x1, y1, x2, y2;
+    self->Map(control, x1, y1);
+    self->Map(to, x2, y2);
+
+    // The lines stay within a quarter of the deviation over the square of
+    // their number of the curve, which keeps them within TOLERANCE.
+    float devX = x0 - 2.0f * x1 + x2;
+    float devY = y0 - 2.0f * y1 + y2;
+    float devSquared = devX * devX + devY * devY;
+    int lines = 1 + static_cast<int>(sqrtf(sqrtf(devSquared) * (0.25f / TOLERANCE)));
+
+    float x = x0, y = y0;
+    for(int i = 1; i <= lines; ++i)
+    {
+        float t = static_cast<float>(i) / static_cast<float>(lines);
+        float s = 1.0f - t;
+        float nextX = s * s * x0 + 2.0f * s * t * x1 + t * t * x2;
+        float nextY = s * s * y0 + 2.0f * s * t * y1 + t * t * y2;
+        self->Line(x, y, nextX, nextY);
+        x = nextX;
+        y = nextY;
+    }
+
+    self->penX = x2;
+    self->penY = y2;
+    return 0;
+}
+
+
+int AccumulationRasterizer::CubicTo(const FT_Vector* control1, const FT_Vector* control2,
+                                    const FT_Vector* to, void* user)
+{
+    AccumulationRasterizer* self = static_cast<AccumulationRasterizer*>(user);
+    float x0 = self->penX, y0 = self->penY;
+    float x1, y1, x2, y2, x3, y3;
+    self->Map(control1, x1, y1);
+    self->Map(control2, x2, y2);
+    self->Map(to, x3, y3);
+
+    // As for conics, but a cubic can bend three times as much for the same
+    // deviation of its control points.
+    float devX = x0 - 2.0f * x1 + x2;
+    float devY = y0 - 2.0f * y1 + y2;
+    float devSquared = devX * devX + devY * devY;
+    devX = x1 - 2.0f * x2 + x3;
+    devY = y1 - 2.0f * y2 + y3;
+    if(devX * devX + devY * devY > devSquared)
+    {
+        devSquared = devX * devX + devY * devY;
+    }
+    int lines = 1 + static_cast<int>(sqrtf(sqrtf(devSquared) * (0.75f / TOLERANCE)));
+
+    float x = x0, y = y0;
+    for(int i = 1; i <= lines; ++i)
+    {
+        float t = static_cast<float>(i) / static_cast<float>(lines);
+        float s = 1.0f - t;
+        float a = s * s * s, b = 3.0f * s * s * t, c = 3.0f * s * t * t, d = t * t * t;
+        float nextX = a * x0 + b * x1 + c * x2 + d * x3;
+        float nextY = a * y0 + b * y1 + c * y2 + d * y3;
+        self->Line(x, y, nextX, nextY);
+        x = nextX;
+        y = nextY;
+    }
+
+    self->penX = x3;
+    self->penY = y3;
+    return 0;
+}
+
+
+void AccumulationRasterizer::Line(float x0, float y0, float x1, float y1)
+{
+    if(y0 == y1)
+    {
+        return;
+    }
+
+    // Edges going down add area, edges going up take it away.
+    float direction = 1.0f;
+    if(y0 > y1)
+    {
+        direction = -1.0f;
+        float t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+
+    const float right = static_cast<float>(width);
+    float dxdy = (x1 - x0) / (y1 - y0);
+    float x = x0;
+    if(y0 < 0.0f)
+    {
+        x -= y0 * dxdy;
+    }
+
+    int firstRow = y0 > 0.0f ? static_cast<int>(y0) : 0;
+    int lastRow = height;
+    if(y1 < static_cast<float>(height))
+    {
+        lastRow = static_cast<int>(y1);
+        lastRow += static_cast<float>(lastRow) < y1;
+    }
+
+    for(int row = firstRow; row < lastRow; ++row)
+    {
+        float* cells = &areas[row * stride];
+
+        float rowTop = static_cast<float>(row);
+        float dy = (y1 < rowTop + 1.0f ? y1 : rowTop + 1.0f)
+                 - (y0 > rowTop ? y0 : rowTop);
+        float nextX = x + dxdy * dy;
+        float d = dy * direction;
+
+        // The bounds contain the outline; this only catches rounding.
+        float xa = x < nextX ? x : nextX;
+        float xb = x < nextX ? nextX : x;
+        xa = xa < 0.0f ? 0.0f : (xa > right ? right : xa);
+        xb = xb < 0.0f ? 0.0f : (xb > right ? right : xb);
+
+        // Both are positive, so truncating floors them.
+        int xai = static_cast<int>(xa);
+        float xaFloor = static_cast<float>(xai);
+        int xbi = static_cast<int>(xb);
+        xbi += static_cast<float>(xbi) < xb;
+        float xbCeil = static_cast<float>(xbi);
+
+        if(xbi <= xai + 1)
+        {
+            // Within one pixel: split by the midpoint.
+            float xm = 0.5f * (xa + xb) - xaFloor;
+            cells[xai] += d - d * xm;
+            cells[xai + 1] += d * xm;
+        }
+        else
+        {
+            float s = 1.0f / (xb - xa);
+            float xaFraction = xa - xaFloor;
+            float aFirst = 0.5f * s * (1.0f - xaFraction) * (1.0f - xaFraction);
+            float xbFraction = xb - xbCeil + 1.0f;
+            float aLast = 0.5f * s * xbFraction * xbFraction;
+
+            cells[xai] += d * aFirst;
+            if(xbi == xai + 2)
+            {
+                cells[xai + 1] += d * (1.0f - aFirst - aLast);
+            }
+            else
+            {
+                float aSecond = s * (1.5f - xaFraction);
+                cells[xai + 1] += d * (aSecond - aFirst);
+                for(int xi = xai + 2; xi < xbi - 1; ++xi)
+                {
+                    cells[xi] += d * s;
+                }
+                float aBeforeLast = aSecond + static_cast<float>(xbi - xai - 3) * s;
+                cells[xbi - 1] += d * (1.0f - aBeforeLast - aLast);
+            }
+            cells[xbi] += d * aLast;
+        }
+
+        x = nextX;
+    }
+}
+
+
+void AccumulationRasterizer::Accumulate(unsigned char* pixels, int pitch)
+{
+    for(int row = 0; row < height; ++row)
+    {
+        const float* cells = &areas[row * stride];
+        unsigned char* out = pixels + row * pitch;
+
+#if defined(DIFONT_ACCUMULATE_SSE2)
+        const __m128 magnitude = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        const __m128 scale = _mm_set1_ps(256.0f);
+        const __m128 opaque = _mm_set1_ps(255.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        __m128 sum = _mm_setzero_ps();
+
+        for(int x = 0; x < width; x += 4)
+        {
+            // Running sum of four cells in two shifted adds.
+            __m128 v = _mm_loadu_ps(cells + x);
+            v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4)));
+            v = _mm_add_ps(v, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 8)));
+            v = _mm_add_ps(v, sum);
+            sum = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3));
+
+            __m128 coverage = _mm_min_ps(_mm_mul_ps(_mm_and_ps(v, magnitude), scale), opaque);
+            __m128i levels = _mm_cvttps_epi32(_mm_add_ps(coverage, half));
+            levels = _mm_packs_epi32(levels, levels);
+            levels = _mm_packus_epi16(levels, levels);
+            int packed = _mm_cvtsi128_si32(levels);
+
+            memcpy(out + x, &packed, width - x < 4 ? width - x : 4);
+        }
+#elif defined(DIFONT_ACCUMULATE_NEON)
+        const float32x4_t zero = vdupq_n_f32(0.0f);
+        const float32x4_t scale = vdupq_n_f32(256.0f);
+        const float32x4_t opaque = vdupq_n_f32(255.0f);
+        const float32x4_t half = vdupq_n_f32(0.5f);
+        float32x4_t sum = zero;
+
+        for(int x = 0; x < width; x += 4)
+        {
+            float32x4_t v = vld1q_f32(cells + x);
+            v = vaddq_f32(v, vextq_f32(zero, v, 3));
+            v = vaddq_f32(v, vextq_f32(zero, v, 2));
+            v = vaddq_f32(v, sum);
+            sum = vdupq_n_f32(vgetq_lane_f32(v, 3));
+
+            float32x4_t coverage = vminq_f32(vmulq_f32(vabsq_f32(v), scale), opaque);
+            uint32x4_t levels = vcvtq_u32_f32(vaddq_f32(coverage, half));
+            uint16x4_t narrow = vmovn_u32(levels);
+            uint8x8_t bytes = vmovn_u16(vcombine_u16(narrow, narrow));
+            uint32_t packed = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+
+            memcpy(out + x, &packed, width - x < 4 ? width - x : 4);
+        }
+#else
+        float sum = 0.0f;
+        for(int x = 0; x < width; ++x)
+        {
+            sum += cells[x];
+            float coverage = (sum < 0.0f ? -sum : sum) * 256.0f;
+            coverage = coverage < 255.0f ? coverage : 255.0f;
+            out[x] = static_cast<unsigned char>(coverage + 0.5f);
+        }
+#endif
+    }
+}
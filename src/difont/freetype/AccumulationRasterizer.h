@@ -0,0 +1,117 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_ACCUMULATION_RASTERIZER_H_
+#define _DIFONT_ACCUMULATION_RASTERIZER_H_
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <vector>
+
+namespace difont {
+    /**
+     * AccumulationRasterizer is a coverage rasteriser for glyph sized
+     * outlines. Each edge adds the signed area it covers in every pixel to
+     * a float buffer, and a running sum along each row, vectorised with
+     * SSE2 or NEON where available, turns the areas into coverage.
+     *
+     * It is faster than FreeType's general purpose rasteriser for glyph
+     * sized outlines. Curves are flattened into lines within 1/32 pixel,
+     * where FreeType 2.4 allows a quarter pixel, so curved edges can differ
+     * from FT_Render_Glyph by up to 40% coverage while being closer to the
+     * true outline; straight edges match. tools/difont-rastercheck checks
+     * both.
+     *
+     * Keep one per thread: the buffer is reused between glyphs.
+     */
+    class AccumulationRasterizer {
+    public:
+        /**
+         * Rasterise an outline into pixels found by
+         * <code>SpanRasterizer::Bounds</code>. Every pixel of the area is
+         * written.
+         *
+         * @param outline  The outline.
+         * @param left     The first column.
+         * @param top      The row above the first row.
+         * @param width    The width in pixels.
+         * @param height   The height in pixels.
+         * @param pixels   The top left pixel.
+         * @param pitch    The bytes from one row of pixels to the next.
+         * @return  <code>false</code> if the outline needs FreeType's
+         *          rasteriser, because it is filled even-odd or could not
+         *          be decomposed. The pixels are then unchanged.
+         */
+        bool Render(const FT_Outline* outline, int left, int top,
+                    int width, int height, unsigned char* pixels, int pitch);
+
+    private:
+        /**
+         * Add the area covered by a line, in pixels down from the top left.
+         */
+        void Line(float x0, float y0, float x1, float y1);
+
+        /**
+         * Turn the areas into coverage.
+         */
+        void Accumulate(unsigned char* pixels, int pitch);
+
+        /**
+         * FT_Outline_Decompose callbacks. The points are in 26.6 outline
+         * coordinates.
+         */
+        static int MoveTo(const FT_Vector* to, void* user);
+        static int LineTo(const FT_Vector* to, void* user);
+        static int ConicTo(const FT_Vector* control, const FT_Vector* to, void* user);
+        static int CubicTo(const FT_Vector* control1, const FT_Vector* control2,
+                           const FT_Vector* to, void* user);
+
+        /**
+         * Convert a point to pixels down from the top left.
+         */
+        void Map(const FT_Vector* point, float& x, float& y) const;
+
+        /**
+         * The area of each pixel, <code>stride</code> floats per row. The
+         * column after the last catches the edges on the right border.
+         */
+        std::vector<float> areas;
+        int stride;
+
+        /**
+         * The area being rasterised.
+         */
+        int left, top, width, height;
+
+        /**
+         * The current point, in pixels.
+         */
+        float penX, penY;
+    };
+}
+
+#endif  //  _DIFONT_ACCUMULATION_RASTERIZER_H_
@@ -32,6 +32,11 @@ difont::Charmap::Charmap(difont::Face* face)
 :   ftFace(*(face->GetFTFace())),
     err(0)
 {
+    for(unsigned int i = 0; i < PLANE_COUNT; i++)
+    {
+        planes[i] = NULL;
+    }
+
     if(!ftFace->charmap)
     {
         if(!ftFace->num_charmaps)
@@ -46,16 +51,13 @@ difont::Charmap::Charmap(difont::Face* face)
 
     ftEncoding = ftFace->charmap->encoding;
 
-    for(unsigned int i = 0; i < difont::Charmap::MAX_PRECOMPUTED; i++)
-    {
-        charIndexCache[i] = FT_Get_Char_Index(ftFace, i);
-    }
+    Precompute();
 }
 
 
 difont::Charmap::~Charmap()
 {
-    charMap.clear();
+    Clear();
 }
 
 
@@ -72,34 +74,73 @@ bool difont::Charmap::CharMap(FT_Encoding encoding)
     if(!err)
     {
         ftEncoding = encoding;
-        charMap.clear();
+        Clear();
+        Precompute();
     }
 
     return !err;
 }
 
 
-unsigned int difont::Charmap::GlyphListIndex(const unsigned int characterCode)
+difont::Charmap::Entry* difont::Charmap::Insert(const unsigned int characterCode)
 {
-    return charMap[characterCode];//.find(characterCode);
+    unsigned int plane = characterCode >> 16;
+
+    if(plane >= PLANE_COUNT)
+    {
+        return &overflow[characterCode];
+    }
+
+    if(!planes[plane])
+    {
+        planes[plane] = new Entry*[BLOCK_SIZE];
+        for(unsigned int i = 0; i < BLOCK_SIZE; i++)
+        {
+            planes[plane][i] = NULL;
+        }
+    }
+
+    Entry*& block = planes[plane][(characterCode >> 8) & 0xff];
+    if(!block)
+    {
+        block = new Entry[BLOCK_SIZE];
+    }
+
+    return block + (characterCode & 0xff);
 }
 
 
-unsigned int difont::Charmap::FontIndex(const unsigned int characterCode)
+void difont::Charmap::Clear()
 {
-    if(characterCode < difont::Charmap::MAX_PRECOMPUTED)
+    for(unsigned int i = 0; i < PLANE_COUNT; i++)
     {
-        return charIndexCache[characterCode];
+        if(planes[i])
+        {
+            for(unsigned int j = 0; j < BLOCK_SIZE; j++)
+            {
+                delete[] planes[i][j];
+            }
+
+            delete[] planes[i];
+            planes[i] = NULL;
+        }
     }
 
-    return FT_Get_Char_Index(ftFace, characterCode);
+    overflow.clear();
+}
+
+
+void difont::Charmap::Precompute()
+{
+    for(unsigned int i = 0; i < BLOCK_SIZE; i++)
+    {
+        Insert(i)->fontIndex = FT_Get_Char_Index(ftFace, i);
+    }
 }
 
 
 void difont::Charmap::InsertIndex(const unsigned int characterCode,
                             const size_t containerIndex)
 {
-    //charMap.insert(characterCode, static_cast<GlyphIndex>(containerIndex));
-    charMap[characterCode] = static_cast<GlyphIndex>(containerIndex);
+    Insert(characterCode)->glyphListIndex = static_cast<unsigned int>(containerIndex);
 }
-
@@ -41,10 +41,11 @@ typedef signed long GlyphIndex;
  * difont::Charmap takes care of specifying the encoding for a font and mapping
  * character codes to glyph indices.
  *
- * It doesn't preprocess all indices, only on an as needed basis. This may
- * seem like a performance penalty but it is quicker than using the 'raw'
- * freetype calls and will save significant amounts of memory when dealing
- * with unicode encoding
+ * It doesn't preprocess all indices, only on an as needed basis. Indices
+ * live in a two level page table, Unicode plane then 256 entry block, whose
+ * blocks are only allocated once a character in them gets a glyph. This
+ * keeps lookups to a few loads for any script and saves significant
+ * amounts of memory when dealing with unicode encoding.
  *
  * @see "Freetype 2 Documentation"
  *
@@ -103,7 +104,7 @@ namespace difont {
          * @return      The GlyphContainer index for the character or zero
          *              if it wasn't found
          */
-        unsigned int GlyphListIndex(const unsigned int characterCode);
+        inline unsigned int GlyphListIndex(const unsigned int characterCode);
 
         /**
          * Get the font glyph index of the input character.
@@ -112,7 +113,19 @@ namespace difont {
          *                      the current encoding eg apple roman.
          * @return      The glyph index for the character.
          */
-        unsigned int FontIndex(const unsigned int characterCode);
+        inline unsigned int FontIndex(const unsigned int characterCode);
+
+        /**
+         * Get the font glyph index of the input character if it is already
+         * known, without looking it up in the face or remembering it, so
+         * several threads may call it at once.
+         *
+         * @param characterCode The character code of the requested glyph.
+         * @param fontIndex     Set to the glyph index if it is known.
+         * @return      <code>true</code> if the index was known.
+         */
+        inline bool KnownFontIndex(const unsigned int characterCode,
+                                   unsigned int& fontIndex);
 
         /**
          * Set the GlyphContainer index of the character code.
@@ -144,25 +157,118 @@ namespace difont {
         const FT_Face ftFace;
 
         /**
-         * A structure that maps glyph indices to character codes
+         * What is known about one character code. Font indices are looked
+         * up on first use.
+         */
+        struct Entry
+        {
+            Entry() : glyphListIndex(0), fontIndex(UNKNOWN_INDEX) {}
+
+            unsigned int glyphListIndex;
+            unsigned int fontIndex;
+        };
+
+        /**
+         * Find the entry for a character code without allocating one.
          *
-         * < character code, face glyph index>
+         * @return  The entry or <code>NULL</code>.
+         */
+        inline Entry* Find(const unsigned int characterCode);
+
+        /**
+         * Find the entry for a character code, allocating its block.
+         */
+        Entry* Insert(const unsigned int characterCode);
+
+        /**
+         * Free every block and the overflow map.
          */
-        typedef std::map<CharacterCode, GlyphIndex> CharacterMap;
-        //typedef FTCharToGlyphIndexMap CharacterMap;
-        CharacterMap charMap;
+        void Clear();
+
+        /**
+         * Fill in the font indices of the first block.
+         */
+        void Precompute();
+
+        static const unsigned int UNKNOWN_INDEX = 0xffffffff;
+        static const unsigned int BLOCK_SIZE = 256;
+        static const unsigned int PLANE_COUNT = 17;
 
         /**
-         * Precomputed font indices.
+         * Planes of 256 blocks of 256 entries, <code>NULL</code> until used.
          */
-        static const unsigned int MAX_PRECOMPUTED = 128;
-        unsigned int charIndexCache[MAX_PRECOMPUTED];
+        Entry** planes[PLANE_COUNT];
+
+        /**
+         * Character codes past the last Unicode plane.
+         *
+         * < character code, entry>
+         */
+        typedef std::map<CharacterCode, Entry> CharacterMap;
+        CharacterMap overflow;
 
         /**
          * Current error code.
          */
         FT_Error err;
     };
+
+
+    inline Charmap::Entry* Charmap::Find(const unsigned int characterCode)
+    {
+        unsigned int plane = characterCode >> 16;
+
+        if(plane < PLANE_COUNT)
+        {
+            Entry** blocks = planes[plane];
+            Entry* block = blocks ? blocks[(characterCode >> 8) & 0xff] : NULL;
+            return block ? block + (characterCode & 0xff) : NULL;
+        }
+
+        CharacterMap::iterator it = overflow.find(characterCode);
+        return it == overflow.end() ? NULL : &it->second;
+    }
+
+
+    inline unsigned int Charmap::GlyphListIndex(const unsigned int characterCode)
+    {
+        const Entry* entry = Find(characterCode);
+        return entry ? entry->glyphListIndex : 0;
+    }
+
+
+    inline unsigned int Charmap::FontIndex(const unsigned int characterCode)
+    {
+        // Only characters that already have an entry remember their index,
+        // so stray codes don't allocate blocks.
+        Entry* entry = Find(characterCode);
+        if(entry && entry->fontIndex != UNKNOWN_INDEX)
+        {
+            return entry->fontIndex;
+        }
+
+        unsigned int index = FT_Get_Char_Index(ftFace, characterCode);
+        if(entry)
+        {
+            entry->fontIndex = index;
+        }
+
+        return index;
+    }
+
+
+    inline bool Charmap::KnownFontIndex(const unsigned int characterCode,
+                                        unsigned int& fontIndex)
+    {
+        const Entry* entry = Find(characterCode);
+        if(entry && entry->fontIndex != UNKNOWN_INDEX)
+        {
+            fontIndex = entry->fontIndex;
+            return true;
+        }
+
+        return false;
+    }
 }
 
 #endif  //  __difont::Charmap__
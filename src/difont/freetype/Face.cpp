@@ -26,23 +26,64 @@
 
 #include "Face.h"
 #include "Library.h"
+#include "Hash.h"
+#include "KerningTable.h"
+#include "MappedFile.h"
+#include "Thread.h"
 
+#include FT_ADVANCES_H
+#include FT_SIZES_H
 #include FT_TRUETYPE_TABLES_H
 
 using namespace difont;
 
+
+/**
+ * FreeType needs faces made and done with one at a time per library, so
+ * fonts can be made and deleted on any thread.
+ */
+static Mutex& LibraryMutex()
+{
+    static Mutex mutex;
+    return mutex;
+}
+
+
 Face::Face(const char* fontFilePath, bool precomputeKerning)
 :   numGlyphs(0),
+    glyphIndex(0),
     fontEncodingList(0),
+    filePath(fontFilePath),
+    file(0),
+    bufferBytes(0),
+    bufferSize(0),
+    contentHash(0),
+    kerningTable(0),
     kerningCache(0),
     err(0)
 {
     const FT_Long DEFAULT_FACE_INDEX = 0;
     ftFace = new FT_Face;
 
-    err = FT_New_Face(*difont::Library::Instance().GetLibrary(), fontFilePath,
-                      DEFAULT_FACE_INDEX, ftFace);
-	
+    file = difont::FaceRegistry::Acquire(fontFilePath);
+    if(file)
+    {
+        bufferBytes = file->Data();
+        bufferSize = file->Length();
+        contentHash = file->ContentHash();
+
+        MutexLock lock(LibraryMutex());
+        err = FT_New_Memory_Face(*difont::Library::Instance().GetLibrary(),
+                                 (FT_Byte const *)bufferBytes, (FT_Long)bufferSize,
+                                 DEFAULT_FACE_INDEX, ftFace);
+    }
+    else
+    {
+        MutexLock lock(LibraryMutex());
+        err = FT_New_Face(*difont::Library::Instance().GetLibrary(), fontFilePath,
+                          DEFAULT_FACE_INDEX, ftFace);
+    }
+
     if(err)
     {
         delete ftFace;
@@ -51,28 +92,33 @@ Face::Face(const char* fontFilePath, bool precomputeKerning)
     }
 
     numGlyphs = (*ftFace)->num_glyphs;
-    hasKerningTable = (FT_HAS_KERNING((*ftFace)) != 0);
-
-    if(hasKerningTable && precomputeKerning)
-    {
-        BuildKerningCache();
-    }
+    LoadKerning(precomputeKerning);
 }
 
 
 Face::Face(const unsigned char *pBufferBytes, size_t bufferSizeInBytes,
                bool precomputeKerning)
 :   numGlyphs(0),
+    glyphIndex(0),
     fontEncodingList(0),
+    file(0),
+    bufferBytes(pBufferBytes),
+    bufferSize(bufferSizeInBytes),
+    contentHash(0),
+    kerningTable(0),
     kerningCache(0),
     err(0)
 {
     const FT_Long DEFAULT_FACE_INDEX = 0;
     ftFace = new FT_Face;
 
-    err = FT_New_Memory_Face(*difont::Library::Instance().GetLibrary(),
-                             (FT_Byte const *)pBufferBytes, (FT_Long)bufferSizeInBytes,
-                             DEFAULT_FACE_INDEX, ftFace);
+    {
+        MutexLock lock(LibraryMutex());
+        err = FT_New_Memory_Face(*difont::Library::Instance().GetLibrary(),
+                                 (FT_Byte const *)pBufferBytes, (FT_Long)bufferSizeInBytes,
+                                 DEFAULT_FACE_INDEX, ftFace);
+    }
+
     if(err)
     {
         delete ftFace;
@@ -81,17 +127,14 @@ Face::Face(const unsigned char *pBufferBytes, size_t bufferSizeInBytes,
     }
 
     numGlyphs = (*ftFace)->num_glyphs;
-    hasKerningTable = (FT_HAS_KERNING((*ftFace)) != 0);
-
-    if(hasKerningTable && precomputeKerning)
-    {
-        BuildKerningCache();
-    }
+    LoadKerning(precomputeKerning);
 }
 
 
 Face::~Face()
 {
+    KerningTable::Release(kerningTable);
+
     if(kerningCache)
     {
         delete[] kerningCache;
@@ -99,10 +142,14 @@ Face::~Face()
 
     if(ftFace)
     {
+        MutexLock lock(LibraryMutex());
         FT_Done_Face(*ftFace);
         delete ftFace;
         ftFace = 0;
     }
+
+    // The face reads from the mapping until it is done.
+    difont::FaceRegistry::Release(file);
 }
 
 
@@ -136,6 +183,47 @@ const difont::Size& Face::Size(const unsigned int size, const unsigned int res)
 }
 
 
+const difont::Size& Face::NewSize(const unsigned int size, const unsigned int res)
+{
+    FT_Size previous = (*ftFace)->size;
+    FT_Size ftSize;
+
+    err = FT_New_Size(*ftFace, &ftSize);
+    if(err)
+    {
+        return charSize;
+    }
+
+    FT_Activate_Size(ftSize);
+
+    difont::Size newSize;
+    newSize.CharSize(ftFace, size, res, res);
+    err = newSize.Error();
+    if(err)
+    {
+        FT_Done_Size(ftSize);
+        FT_Activate_Size(previous);
+        return charSize;
+    }
+
+    charSize = newSize;
+    return charSize;
+}
+
+
+void Face::ActivateSize(const difont::Size& size)
+{
+    FT_Activate_Size(size.FTSize());
+    charSize = size;
+}
+
+
+void Face::DoneSize(const difont::Size& size)
+{
+    FT_Done_Size(size.FTSize());
+}
+
+
 unsigned int Face::CharMapCount() const
 {
     return (*ftFace)->num_charmaps;
@@ -166,6 +254,14 @@ difont::Point Face::KernAdvance(unsigned int index1, unsigned int index2)
         return difont::Point(0.0f, 0.0f);
     }
 
+    if(kerningTable)
+    {
+        int units = kerningTable->Kern(index1, index2);
+        x = units ? static_cast<float>(FT_MulFix(units,
+                        (*ftFace)->size->metrics.x_scale)) / 64.0f : 0.0f;
+        return difont::Point(x, 0.0f);
+    }
+
     if(kerningCache && index1 < Face::MAX_PRECOMPUTED
         && index2 < Face::MAX_PRECOMPUTED)
     {
@@ -191,6 +287,19 @@ difont::Point Face::KernAdvance(unsigned int index1, unsigned int index2)
 }
 
 
+float Face::GlyphAdvance(unsigned int index, FT_Int load_flags)
+{
+    // Leaves err alone, a missing advance isn't worth failing a render.
+    FT_Fixed advance = 0;
+    if(FT_Get_Advance(*ftFace, index, load_flags, &advance))
+    {
+        return 0.0f;
+    }
+
+    return static_cast<float>((advance + 512) >> 10) / 64.0f;
+}
+
+
 FT_GlyphSlot Face::Glyph(unsigned int index, FT_Int load_flags)
 {
     err = FT_Load_Glyph(*ftFace, index, load_flags);
@@ -199,10 +308,54 @@ FT_GlyphSlot Face::Glyph(unsigned int index, FT_Int load_flags)
         return NULL;
     }
 
+    glyphIndex = index;
     return (*ftFace)->glyph;
 }
 
 
+uint64_t Face::ContentHash()
+{
+    if(contentHash)
+    {
+        return contentHash;
+    }
+
+    if(bufferBytes)
+    {
+        contentHash = Fnv1a64(bufferBytes, bufferSize);
+    }
+    else
+    {
+        difont::MappedFile file;
+        if(file.Open(filePath.c_str()))
+        {
+            contentHash = Fnv1a64(file.Data(), file.Length());
+        }
+    }
+
+    return contentHash;
+}
+
+
+void Face::LoadKerning(bool precomputeKerning)
+{
+    // sfnt kerning is read once and shared by faces with the same file.
+    if(FT_IS_SFNT((*ftFace)))
+    {
+        kerningTable = KerningTable::Acquire(*ftFace, ContentHash());
+        hasKerningTable = !kerningTable->Empty();
+        return;
+    }
+
+    hasKerningTable = (FT_HAS_KERNING((*ftFace)) != 0);
+
+    if(hasKerningTable && precomputeKerning)
+    {
+        BuildKerningCache();
+    }
+}
+
+
 void Face::BuildKerningCache()
 {
     FT_Vector kernAdvance;
@@ -30,8 +30,12 @@
 #include FT_FREETYPE_H
 #include FT_GLYPH_H
 
+#include <string>
+#include <stdint.h>
+
 #include  <difont/difont.h>
 
+#include "FaceRegistry.h"
 #include "Size.h"
 
 /**
@@ -41,12 +45,18 @@
  *
  */
 namespace difont {
+    class KerningTable;
+
     class Face {
     public:
         /**
-         * Opens and reads a face file. Error is set.
+         * Opens and reads a face file. Error is set. The file is mapped
+         * into memory once and shared with other faces opened from it.
          *
          * @param fontFilePath  font file path.
+         * @param precomputeKerning  cache kerning for low glyph indices of
+         *                           faces FreeType kerns, which are those
+         *                           that aren't sfnt.
          */
         Face(const char* fontFilePath, bool precomputeKerning = true);
 
@@ -55,6 +65,7 @@ namespace difont {
          *
          * @param pBufferBytes  the in-memory buffer
          * @param bufferSizeInBytes  the length of the buffer in bytes
+         * @param precomputeKerning  as above.
          */
         Face(const unsigned char *pBufferBytes, size_t bufferSizeInBytes,
              bool precomputeKerning = true);
@@ -105,6 +116,26 @@ namespace difont {
          */
         const difont::Size& Size(const unsigned int size, const unsigned int res);
 
+        /**
+         * Make a new FreeType size for the face, set its char size and make
+         * it the active size. On failure the active size is left alone.
+         *
+         * @param size      the face size in points (1/72 inch)
+         * @param res       the resolution of the target device.
+         * @return          <code>difont::Size</code> object
+         */
+        const difont::Size& NewSize(const unsigned int size, const unsigned int res);
+
+        /**
+         * Make a size returned by Size() or NewSize() the active one again.
+         */
+        void ActivateSize(const difont::Size& size);
+
+        /**
+         * Free a size made by NewSize() that isn't active.
+         */
+        void DoneSize(const difont::Size& size);
+
         /**
          * Get the number of character maps in this face.
          *
@@ -120,20 +151,70 @@ namespace difont {
         FT_Encoding* CharMapList();
 
         /**
-         * Gets the kerning vector between two glyphs
+         * Gets the kerning vector between two glyphs. Kerning of sfnt faces
+         * comes from their shared KerningTable, scaled to the current size.
          */
         difont::Point KernAdvance(unsigned int index1, unsigned int index2);
 
+        /**
+         * Whether KernAdvance() only reads shared tables, so several threads
+         * may call it at once. Other faces ask FreeType for their kerning.
+         */
+        bool SharedKerning() const { return !hasKerningTable || kerningTable; }
+
+        /**
+         * Gets the horizontal advance of a glyph, rounded to 1/64 pixel
+         * like that of a loaded glyph. FreeType can usually read it from
+         * the metrics tables without loading the glyph.
+         */
+        float GlyphAdvance(unsigned int index, FT_Int load_flags);
+
         /**
          * Loads and creates a Freetype glyph.
          */
         FT_GlyphSlot Glyph(unsigned int index, FT_Int load_flags);
 
+        /**
+         * Gets the index of the glyph that was last loaded into the face's
+         * glyph slot by <code>Glyph()</code>.
+         */
+        unsigned int GlyphIndex() const { return glyphIndex; }
+
         /**
          * Gets the number of glyphs in the current face.
          */
         unsigned int GlyphCount() const { return numGlyphs; }
 
+        /**
+         * Gets the path of the font file, or an empty string if the face
+         * was read from memory.
+         */
+        const std::string& FilePath() const { return filePath; }
+
+        /**
+         * Gets the font data the face was read from, the client's buffer
+         * or the shared mapping of the font file. It stays valid for the
+         * life of the face.
+         *
+         * @return  The data, or <code>NULL</code> if the file couldn't be
+         *          mapped and FreeType read it instead.
+         */
+        const unsigned char* Data() const { return bufferBytes; }
+
+        /**
+         * Gets the length of the font data in bytes.
+         */
+        size_t DataSize() const { return bufferSize; }
+
+        /**
+         * Gets a hash of the font file or buffer this face was read from.
+         * It's computed the first time it's asked for.
+         *
+         * @return  A 64 bit FNV-1a hash of the font data, or zero if the
+         *          data can't be read.
+         */
+        uint64_t ContentHash();
+
         /**
          * Queries for errors.
          *
@@ -157,13 +238,50 @@ namespace difont {
          */
         int numGlyphs;
 
+        /**
+         * The index of the glyph currently held in the glyph slot
+         */
+        unsigned int glyphIndex;
+
         FT_Encoding* fontEncodingList;
 
+        /**
+         * The font file path, if the face was read from a file
+         */
+        std::string filePath;
+
+        /**
+         * The shared mapping of the font file, if the face was read from
+         * a file
+         */
+        const difont::FaceRegistry::File* file;
+
+        /**
+         * The font data, the client's buffer or the file's mapping
+         */
+        const unsigned char *bufferBytes;
+        size_t bufferSize;
+
+        /**
+         * The hash returned by ContentHash(), zero until it is computed
+         */
+        uint64_t contentHash;
+
         /**
          * This face has kerning tables
          */
         bool hasKerningTable;
 
+        /**
+         * The kerning of an sfnt face, in font units
+         */
+        difont::KerningTable* kerningTable;
+
+        /**
+         * Find the face's kerning.
+         */
+        void LoadKerning(bool precomputeKerning);
+
         /**
          * If this face has kerning tables, we can cache them.
          */
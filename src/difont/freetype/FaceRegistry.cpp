@@ -0,0 +1,114 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "FaceRegistry.h"
+#include "Hash.h"
+#include "Thread.h"
+
+using namespace difont;
+
+
+static Mutex& RegistryMutex()
+{
+    static Mutex mutex;
+    return mutex;
+}
+
+
+static std::map<std::string, FaceRegistry::File*>& Registry()
+{
+    static std::map<std::string, FaceRegistry::File*> files;
+    return files;
+}
+
+
+FaceRegistry::File::File()
+:   contentHash(0),
+    references(1)
+{}
+
+
+const FaceRegistry::File* FaceRegistry::Acquire(const char* filePath)
+{
+    std::string path(filePath);
+
+    {
+        MutexLock lock(RegistryMutex());
+        FileMap::iterator it = Registry().find(path);
+        if(it != Registry().end())
+        {
+            ++it->second->references;
+            return it->second;
+        }
+    }
+
+    // Mapped and hashed outside the lock, so other files aren't held up.
+    File* file = new File();
+    if(!file->mapping.Open(filePath))
+    {
+        delete file;
+        return NULL;
+    }
+
+    file->path = path;
+    file->contentHash = Fnv1a64(file->Data(), file->Length());
+
+    // Another face may have mapped the same file meanwhile.
+    MutexLock lock(RegistryMutex());
+    std::pair<FileMap::iterator, bool> added =
+        Registry().insert(std::make_pair(path, file));
+    if(!added.second)
+    {
+        delete file;
+        file = added.first->second;
+        ++file->references;
+    }
+
+    return file;
+}
+
+
+void FaceRegistry::Release(const File* constFile)
+{
+    if(!constFile)
+    {
+        return;
+    }
+
+    File* file = const_cast<File*>(constFile);
+
+    {
+        MutexLock lock(RegistryMutex());
+        if(--file->references)
+        {
+            return;
+        }
+
+        Registry().erase(file->path);
+    }
+
+    delete file;
+}
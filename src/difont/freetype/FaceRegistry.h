@@ -0,0 +1,101 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_FACE_REGISTRY_H_
+#define _DIFONT_FACE_REGISTRY_H_
+
+#include <map>
+#include <stdint.h>
+#include <string>
+
+#include "MappedFile.h"
+
+/**
+ * FaceRegistry maps each font file into memory once and shares the
+ * mapping between every face read from it, so a file opened by several
+ * fonts is read and kept resident once. Each face still has its own
+ * FT_Face over the shared bytes, as an FT_Face carries the size, charmap
+ * and glyph slot of the font using it.
+ */
+namespace difont {
+    class FaceRegistry {
+    public:
+        /**
+         * A mapped font file.
+         */
+        class File {
+            friend class FaceRegistry;
+
+        public:
+            /**
+             * Get the contents of the file.
+             */
+            const unsigned char* Data() const { return mapping.Data(); }
+
+            /**
+             * Get the length of the file in bytes.
+             */
+            size_t Length() const { return mapping.Length(); }
+
+            /**
+             * Get the hash of the file's contents, computed when it was
+             * mapped.
+             */
+            uint64_t ContentHash() const { return contentHash; }
+
+        private:
+            File();
+
+            File(const File&);
+            File& operator=(const File&);
+
+            difont::MappedFile mapping;
+            std::string path;
+            uint64_t contentHash;
+            int references;
+        };
+
+        /**
+         * Get a font file, mapping it if no face has it mapped.
+         *
+         * @param filePath  the font file path.
+         * @return          The file, to be passed to Release(), or
+         *                  <code>NULL</code> if it can't be mapped.
+         */
+        static const File* Acquire(const char* filePath);
+
+        /**
+         * Drop a reference taken by Acquire(), unmapping the file after
+         * the last.
+         */
+        static void Release(const File* file);
+
+    private:
+        typedef std::map<std::string, File*> FileMap;
+    };
+}
+
+#endif  //  _DIFONT_FACE_REGISTRY_H_
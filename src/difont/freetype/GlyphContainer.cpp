@@ -29,13 +29,52 @@
 #include "GlyphContainer.h"
 #include "Face.h"
 #include "Charmap.h"
+#include "GlyphImpl.h"
+#include "Thread.h"
+
+using difont::Mutex;
+using difont::MutexLock;
+
+// The bytes held by all containers, and the budget for them.
+static size_t globalBytes = 0;
+static size_t globalBudget = 0;
+
+static Mutex& GlobalMutex()
+{
+    static Mutex mutex;
+    return mutex;
+}
+
+
+static void AddGlobalBytes(size_t added, size_t removed)
+{
+    MutexLock lock(GlobalMutex());
+    globalBytes = globalBytes + added - removed;
+}
+
+
+static bool GlobalOverBudget()
+{
+    MutexLock lock(GlobalMutex());
+    return globalBudget && globalBytes > globalBudget;
+}
 
 
 difont::GlyphContainer::GlyphContainer(Face* f)
 :   face(f),
+glyphCount(0),
+bytes(0),
+budget(0),
 err(0)
 {
     glyphs.push_back(NULL);
+    advances.push_back(0.0f);
+    bBoxes.push_back(difont::BBox());
+    impls.push_back(NULL);
+    fontIndices.push_back(0);
+    footprints.push_back(0);
+    newer.push_back(0);
+    older.push_back(0);
     charMap = new difont::Charmap(face);
 }
 
@@ -50,6 +89,15 @@ difont::GlyphContainer::~GlyphContainer()
 
     glyphs.clear();
     delete charMap;
+
+    AddGlobalBytes(0, bytes);
+}
+
+
+void difont::GlyphContainer::GlobalBudget(size_t b)
+{
+    MutexLock lock(GlobalMutex());
+    globalBudget = b;
 }
 
 
@@ -67,33 +115,230 @@ unsigned int difont::GlyphContainer::FontIndex(const unsigned int charCode) cons
 }
 
 
-void difont::GlyphContainer::Add(difont::Glyph* tempGlyph, const unsigned int charCode)
+unsigned int difont::GlyphContainer::NewSlot(difont::Glyph* tempGlyph, float advance,
+                                             const difont::BBox& bBox,
+                                             const unsigned int fontIndex)
 {
-    charMap->InsertIndex(charCode, glyphs.size());
+    unsigned int slot = static_cast<unsigned int>(glyphs.size());
+
     glyphs.push_back(tempGlyph);
+    advances.push_back(advance);
+    bBoxes.push_back(bBox);
+    impls.push_back(NULL);
+    fontIndices.push_back(fontIndex);
+    footprints.push_back(0);
+    newer.push_back(0);
+    older.push_back(0);
+
+    // Characters sharing a glyph share the first one's slot by index.
+    if(fontIndex < fontIndexSlots.size() && !fontIndexSlots[fontIndex])
+    {
+        fontIndexSlots[fontIndex] = slot;
+    }
+
+    return slot;
+}
+
+
+void difont::GlyphContainer::SetSlot(const unsigned int slot, bool direct)
+{
+    difont::Glyph* glyph = glyphs[slot];
+
+    advances[slot] = glyph->Advance();
+    bBoxes[slot] = glyph->BBox();
+    impls[slot] = direct ? glyph->impl : NULL;
+
+    Hold(slot);
+}
+
+
+void difont::GlyphContainer::Hold(const unsigned int slot)
+{
+    difont::Glyph* glyph = glyphs[slot];
+
+    footprints[slot] = sizeof(*glyph) + glyph->impl->Footprint();
+    bytes += footprints[slot];
+    ++glyphCount;
+    AddGlobalBytes(footprints[slot], 0);
+
+    Link(slot);
+}
+
+
+void difont::GlyphContainer::Release(const unsigned int slot)
+{
+    Unlink(slot);
+
+    bytes -= footprints[slot];
+    --glyphCount;
+    AddGlobalBytes(0, footprints[slot]);
+    footprints[slot] = 0;
+}
+
+
+void difont::GlyphContainer::Evict(const unsigned int slot)
+{
+    Release(slot);
+
+    delete glyphs[slot];
+    glyphs[slot] = NULL;
+    impls[slot] = NULL;
+}
+
+
+unsigned int difont::GlyphContainer::Trim(const unsigned int keep)
+{
+    unsigned int evicted = 0;
+    while((budget && bytes > budget) || GlobalOverBudget())
+    {
+        // Only this container's glyphs can go, even for the global budget.
+        unsigned int slot = newer[0];
+        if(slot == 0 || slot == keep)
+        {
+            break;
+        }
+
+        Evict(slot);
+        ++evicted;
+    }
+
+    return evicted;
+}
+
+
+unsigned int difont::GlyphContainer::EvictIf(bool (*test)(const difont::GlyphImpl* impl,
+                                                          void* context),
+                                             void* context)
+{
+    unsigned int evicted = 0;
+    for(unsigned int i = 1; i < glyphs.size(); ++i)
+    {
+        if(glyphs[i] && test(glyphs[i]->impl, context))
+        {
+            Evict(i);
+            ++evicted;
+        }
+    }
+
+    return evicted;
+}
+
+
+void difont::GlyphContainer::Add(difont::Glyph* tempGlyph, const unsigned int charCode,
+                                 bool direct)
+{
+    // Inserted first, so the character's font index is remembered.
+    charMap->InsertIndex(charCode, glyphs.size());
+
+    unsigned int slot = NewSlot(tempGlyph, 0.0f, difont::BBox(),
+                                charMap->FontIndex(charCode));
+    SetSlot(slot, direct);
+}
+
+
+void difont::GlyphContainer::AddMetrics(const unsigned int charCode, float advance,
+                                        const difont::BBox& bBox)
+{
+    charMap->InsertIndex(charCode, glyphs.size());
+
+    NewSlot(NULL, advance, bBox, charMap->FontIndex(charCode));
+}
+
+
+unsigned int difont::GlyphContainer::AddFontIndex(difont::Glyph* tempGlyph,
+                                                  const unsigned int fontIndex,
+                                                  bool direct)
+{
+    unsigned int slot = NewSlot(tempGlyph, 0.0f, difont::BBox(), fontIndex);
+    SetSlot(slot, direct);
+
+    return slot;
+}
+
+
+unsigned int difont::GlyphContainer::AddFontIndexMetrics(const unsigned int fontIndex,
+                                                         float advance,
+                                                         const difont::BBox& bBox)
+{
+    return NewSlot(NULL, advance, bBox, fontIndex);
+}
+
+
+void difont::GlyphContainer::Replace(difont::Glyph* tempGlyph, const unsigned int charCode,
+                                     bool direct)
+{
+    ReplaceSlot(charMap->GlyphListIndex(charCode), tempGlyph, direct);
+}
+
+
+void difont::GlyphContainer::ReplaceSlot(const unsigned int slot,
+                                         difont::Glyph* tempGlyph, bool direct)
+{
+    if(glyphs[slot])
+    {
+        Release(slot);
+    }
+
+    delete glyphs[slot];
+    glyphs[slot] = tempGlyph;
+
+    SetSlot(slot, direct);
+}
+
+
+void difont::GlyphContainer::IndexFontIndices()
+{
+    if(!fontIndexSlots.empty() || face->GlyphCount() == 0)
+    {
+        return;
+    }
+
+    fontIndexSlots.resize(face->GlyphCount(), 0);
+    for(unsigned int i = 1; i < fontIndices.size(); ++i)
+    {
+        unsigned int fontIndex = fontIndices[i];
+        if(fontIndex < fontIndexSlots.size() && !fontIndexSlots[fontIndex])
+        {
+            fontIndexSlots[fontIndex] = i;
+        }
+    }
+}
+
+
+void difont::GlyphContainer::RefreshMetrics()
+{
+    for(size_t i = 1; i < glyphs.size(); ++i)
+    {
+        if(!glyphs[i])
+        {
+            continue;
+        }
+
+        advances[i] = glyphs[i]->Advance();
+        bBoxes[i] = glyphs[i]->BBox();
+    }
 }
 
 
 const difont::Glyph* const difont::GlyphContainer::Glyph(const unsigned int charCode) const
 {
-    unsigned int index = charMap->GlyphListIndex(charCode);
-    return glyphs[index];
+    return glyphs[charMap->GlyphListIndex(charCode)];
 }
 
 
 difont::BBox difont::GlyphContainer::BBox(const unsigned int charCode) const
 {
-    return Glyph(charCode)->BBox();
+    return bBoxes[charMap->GlyphListIndex(charCode)];
 }
 
 
 float difont::GlyphContainer::Advance(const unsigned int charCode,
                                       const unsigned int nextCharCode)
 {
-    unsigned int left = charMap->FontIndex(charCode);
+    unsigned int slot = charMap->GlyphListIndex(charCode);
     unsigned int right = charMap->FontIndex(nextCharCode);
 
-    return face->KernAdvance(left, right).Xf() + Glyph(charCode)->Advance();
+    return face->KernAdvance(fontIndices[slot], right).Xf() + advances[slot];
 }
 
 
@@ -101,17 +346,15 @@ difont::Point difont::GlyphContainer::Render(const unsigned int charCode,
                                              const unsigned int nextCharCode,
                                              difont::Point penPosition, int renderMode)
 {
-    unsigned int left = charMap->FontIndex(charCode);
+    unsigned int slot = charMap->GlyphListIndex(charCode);
     unsigned int right = charMap->FontIndex(nextCharCode);
 
-    difont::Point kernAdvance = face->KernAdvance(left, right);
+    difont::Point kernAdvance = face->KernAdvance(fontIndices[slot], right);
 
-    if(!face->Error())
+    if(glyphs[slot])
     {
-        unsigned int index = charMap->GlyphListIndex(charCode);
-        kernAdvance += glyphs[index]->Render(penPosition, renderMode);
+        kernAdvance += glyphs[slot]->Render(penPosition, renderMode);
     }
     
     return kernAdvance;
 }
-
@@ -33,15 +33,25 @@
 
 #include  <difont/difont.h>
 
+#include "Charmap.h"
+
 /**
  * GlyphContainer holds the post processed Glyph objects.
  *
+ * Alongside the glyphs it keeps their metrics in flat arrays indexed by
+ * slot, so measuring and rendering a string doesn't go through a virtual
+ * call per glyph.
+ *
+ * The glyphs can be held to a budget of bytes. Over it, the least recently
+ * used glyphs are deleted; their slots keep the metrics, so only drawing
+ * them again makes a new glyph.
+ *
  * @see Glyph
  */
 namespace difont {
     class Face;
     class Glyph;
-    class Charmap;
+    class GlyphImpl;
 
     class GlyphContainer
     {
@@ -77,20 +87,203 @@ namespace difont {
          */
         unsigned int FontIndex(const unsigned int characterCode) const;
 
+        /**
+         * Get the font index of the input character without changing the
+         * container. Characters with a slot always have a known index.
+         *
+         * @return      <code>true</code> and the index in
+         *              <code>fontIndex</code> if it was known.
+         */
+        bool KnownFontIndex(const unsigned int characterCode,
+                            unsigned int& fontIndex) const
+        {
+            return charMap->KnownFontIndex(characterCode, fontIndex);
+        }
+
         /**
          * Adds a glyph to this glyph list.
          *
          * @param glyph         The Glyph to be inserted into the container
          * @param characterCode The char code of the glyph NOT the glyph index.
+         * @param direct        <code>true</code> if the glyph is exactly
+         *                      the font's own glyph type, so its
+         *                      implementation can be rendered directly.
+         */
+        void Add(Glyph* glyph, const unsigned int characterCode,
+                 bool direct = false);
+
+        /**
+         * Replaces the glyph for a char code, deleting the old one.
+         *
+         * @param glyph         The Glyph to be inserted into the container
+         * @param characterCode The char code of a glyph already added.
+         * @param direct        As for Add().
+         */
+        void Replace(Glyph* glyph, const unsigned int characterCode,
+                     bool direct = false);
+
+        /**
+         * Replaces the glyph in a slot, deleting the old one.
+         *
+         * @param slot          A slot from Slot() or FontIndexSlot().
+         * @param glyph         The Glyph to be inserted into the container
+         * @param direct        As for Add().
+         */
+        void ReplaceSlot(const unsigned int slot, Glyph* glyph,
+                         bool direct = false);
+
+        /**
+         * Adds a glyph by its font index, for glyphs drawn from shaped runs
+         * that may have no character code.
+         *
+         * @param glyph         The Glyph to be inserted into the container
+         * @param fontIndex     The glyph's index in the face.
+         * @param direct        As for Add().
+         * @return              The glyph's slot.
+         */
+        unsigned int AddFontIndex(Glyph* glyph, const unsigned int fontIndex,
+                                  bool direct = false);
+
+        /**
+         * Adds a glyph's metrics by its font index, without a glyph.
+         *
+         * @return              The glyph's slot.
+         */
+        unsigned int AddFontIndexMetrics(const unsigned int fontIndex, float advance,
+                                         const difont::BBox& bBox);
+
+        /**
+         * Start looking glyphs up by font index, indexing the slots added
+         * so far. Until it is called FontIndexSlot() finds nothing, so
+         * fonts only used with text don't keep the table.
+         */
+        void IndexFontIndices();
+
+        /**
+         * Get the slot holding the glyph with a font index.
+         *
+         * @param fontIndex     The glyph's index in the face.
+         * @return              The slot, or zero if the glyph hasn't been
+         *                      loaded or IndexFontIndices() hasn't been
+         *                      called.
+         */
+        unsigned int FontIndexSlot(const unsigned int fontIndex) const
+        {
+            return fontIndex < fontIndexSlots.size() ? fontIndexSlots[fontIndex] : 0;
+        }
+
+        /**
+         * Adds a character's metrics without a glyph, for measuring text
+         * that may never be drawn. Add the glyph later with Replace().
+         *
+         * @param characterCode The char code of the glyph NOT the glyph index.
+         * @param advance       The glyph's horizontal advance.
+         * @param bBox          The glyph's bounding box.
+         */
+        void AddMetrics(const unsigned int characterCode, float advance,
+                        const difont::BBox& bBox);
+
+        /**
+         * Read every glyph's metrics again, for fonts whose glyphs change
+         * after they have been added.
          */
-        void Add(Glyph* glyph, const unsigned int characterCode);
+        void RefreshMetrics();
+
+        /**
+         * Mark the glyph in a slot as the most recently used. The slot must
+         * hold a glyph.
+         */
+        void Touch(const unsigned int slot)
+        {
+            if(older[0] != slot)
+            {
+                Unlink(slot);
+                Link(slot);
+            }
+        }
+
+        /**
+         * Set the most bytes the glyphs in this container may use. It is
+         * applied by the next Trim().
+         *
+         * @param bytes  The budget, or 0 for no limit.
+         */
+        void Budget(size_t bytes) { budget = bytes; }
+
+        /**
+         * Delete the least recently used glyphs until the container is
+         * within its budget and all containers are within the global one.
+         *
+         * @param keep  A slot whose glyph is about to be used and must not
+         *              be deleted.
+         * @return      The number of glyphs deleted.
+         */
+        unsigned int Trim(const unsigned int keep);
+
+        /**
+         * Delete the glyphs a test picks, keeping their metrics, so they
+         * are made again when next drawn.
+         *
+         * @param test      returns <code>true</code> for the implementation
+         *                  of a glyph to delete.
+         * @param context   passed to the test.
+         * @return          The number of glyphs deleted.
+         */
+        unsigned int EvictIf(bool (*test)(const difont::GlyphImpl* impl, void* context),
+                             void* context);
+
+        /**
+         * Set the most bytes the glyphs of all containers may use together.
+         *
+         * @param bytes  The budget, or 0 for no limit.
+         */
+        static void GlobalBudget(size_t bytes);
+
+        /**
+         * The number of glyphs held, not counting slots with only metrics.
+         */
+        unsigned int GlyphCount() const { return glyphCount; }
+
+        /**
+         * The bytes used by the glyphs held.
+         */
+        size_t Bytes() const { return bytes; }
+
+        /**
+         * Get the slot holding a character's glyph.
+         *
+         * @param characterCode The char code of the glyph NOT the glyph index
+         * @return              The slot, or zero if the glyph hasn't been
+         *                      loaded.
+         */
+        unsigned int Slot(const unsigned int characterCode) const
+        {
+            return charMap->GlyphListIndex(characterCode);
+        }
+
+        /**
+         * Slot accessors. The slot must come from Slot() and be non zero.
+         * SlotGlyph() is <code>NULL</code> for slots holding only metrics.
+         */
+        float SlotAdvance(const unsigned int slot) const { return advances[slot]; }
+        const difont::BBox& SlotBBox(const unsigned int slot) const { return bBoxes[slot]; }
+        unsigned int SlotFontIndex(const unsigned int slot) const { return fontIndices[slot]; }
+        difont::Glyph* SlotGlyph(const unsigned int slot) const { return glyphs[slot]; }
+
+        /**
+         * Get the implementation of a slot's glyph.
+         *
+         * @return  The implementation, or <code>NULL</code> if the glyph
+         *          must be rendered through its virtual interface.
+         */
+        difont::GlyphImpl* SlotImpl(const unsigned int slot) const { return impls[slot]; }
 
         /**
          * Get a glyph from the glyph list
          *
          * @param characterCode The char code of the glyph NOT the glyph index
          * @return              An Glyph or <code>null</code> is it hasn't been
-         * loaded.
+         * loaded, or only its metrics have.
          */
         const difont::Glyph* const Glyph(const unsigned int characterCode) const;
 
@@ -140,11 +333,82 @@ namespace difont {
          */
         difont::Charmap* charMap;
 
+        /**
+         * Append a slot for a glyph or only its metrics.
+         *
+         * @return  The new slot.
+         */
+        unsigned int NewSlot(difont::Glyph* glyph, float advance,
+                             const difont::BBox& bBox, const unsigned int fontIndex);
+
+        /**
+         * Fill in the metrics of a slot from its glyph.
+         */
+        void SetSlot(const unsigned int slot, bool direct);
+
+        /**
+         * Add or remove the glyph in a slot from the recently used list
+         * and the byte counts.
+         */
+        void Hold(const unsigned int slot);
+        void Release(const unsigned int slot);
+
+        /**
+         * Delete the glyph in a slot, keeping its metrics.
+         */
+        void Evict(const unsigned int slot);
+
+        /**
+         * Recently used list links, slot zero being the list head.
+         */
+        void Link(const unsigned int slot)
+        {
+            older[slot] = older[0];
+            newer[slot] = 0;
+            newer[older[0]] = slot;
+            older[0] = slot;
+        }
+
+        void Unlink(const unsigned int slot)
+        {
+            older[newer[slot]] = older[slot];
+            newer[older[slot]] = newer[slot];
+        }
+
         /**
          * A structure to hold the glyphs
          */
         GlyphVector glyphs;
 
+        /**
+         * Per slot glyph metrics, implementations and font indices.
+         */
+        std::vector<float> advances;
+        std::vector<difont::BBox> bBoxes;
+        std::vector<difont::GlyphImpl*> impls;
+        std::vector<unsigned int> fontIndices;
+
+        /**
+         * The slot of each font index, once IndexFontIndices() is called.
+         */
+        std::vector<unsigned int> fontIndexSlots;
+
+        /**
+         * Per slot bytes used by the glyph, and the recently used list.
+         * From slot zero, <code>older</code> leads to the most recently
+         * used glyph and <code>newer</code> to the least.
+         */
+        std::vector<size_t> footprints;
+        std::vector<unsigned int> newer;
+        std::vector<unsigned int> older;
+
+        /**
+         * The glyphs held, their bytes and the budget for them.
+         */
+        unsigned int glyphCount;
+        size_t bytes;
+        size_t budget;
+
         /**
          * Current error code. Zero means no error.
          */
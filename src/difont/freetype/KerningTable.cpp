@@ -0,0 +1,665 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <set>
+
+#include "KerningTable.h"
+#include "Thread.h"
+
+#include FT_TRUETYPE_TABLES_H
+#include FT_TRUETYPE_TAGS_H
+
+using namespace difont;
+
+
+static const uint32_t KERN_FEATURE = 0x6B65726E; // 'kern'
+
+typedef std::map<uint64_t, KerningTable*> TableMap;
+
+
+static Mutex& RegistryMutex()
+{
+    static Mutex mutex;
+    return mutex;
+}
+
+
+static TableMap& Registry()
+{
+    static TableMap tables;
+    return tables;
+}
+
+
+// Big endian reads that return zero past the end of the table, so a
+// damaged table reads as an empty one rather than out of bounds.
+static inline unsigned int U16(const std::vector<unsigned char>& table, size_t offset)
+{
+    return offset + 2 <= table.size() ? (table[offset] << 8) | table[offset + 1] : 0;
+}
+
+
+static inline uint32_t U32(const std::vector<unsigned char>& table, size_t offset)
+{
+    return (static_cast<uint32_t>(U16(table, offset)) << 16) | U16(table, offset + 2);
+}
+
+
+static inline int S16(const std::vector<unsigned char>& table, size_t offset)
+{
+    return static_cast<int16_t>(U16(table, offset));
+}
+
+
+static bool LoadTable(FT_Face face, FT_ULong tag, std::vector<unsigned char>& table)
+{
+    FT_ULong length = 0;
+    if(FT_Load_Sfnt_Table(face, tag, 0, NULL, &length) || !length)
+    {
+        return false;
+    }
+
+    table.resize(length);
+    return !FT_Load_Sfnt_Table(face, tag, 0, &table[0], &length);
+}
+
+
+// The glyphs of a coverage table, in coverage index order.
+static void ReadCoverage(const std::vector<unsigned char>& table, size_t offset,
+                         std::vector<unsigned int>& glyphs)
+{
+    unsigned int format = U16(table, offset);
+    unsigned int count = U16(table, offset + 2);
+
+    if(format == 1)
+    {
+        for(unsigned int i = 0; i < count; ++i)
+        {
+            glyphs.push_back(U16(table, offset + 4 + 2 * i));
+        }
+    }
+    else if(format == 2)
+    {
+        for(unsigned int i = 0; i < count; ++i)
+        {
+            size_t range = offset + 4 + 6 * i;
+            unsigned int start = U16(table, range);
+            unsigned int end = U16(table, range + 2);
+            for(unsigned int glyph = start;
+                glyph <= end && glyphs.size() <= 0xffff; ++glyph)
+            {
+                glyphs.push_back(glyph);
+            }
+        }
+    }
+}
+
+
+// The glyph classes of a class definition table, other than class zero.
+static void ReadClasses(const std::vector<unsigned char>& table, size_t offset,
+                        std::vector<std::pair<unsigned int, unsigned int> >& classes)
+{
+    unsigned int format = U16(table, offset);
+
+    if(format == 1)
+    {
+        unsigned int start = U16(table, offset + 2);
+        unsigned int count = U16(table, offset + 4);
+        for(unsigned int i = 0; i < count && start + i <= 0xffff; ++i)
+        {
+            unsigned int glyphClass = U16(table, offset + 6 + 2 * i);
+            if(glyphClass)
+            {
+                classes.push_back(std::make_pair(start + i, glyphClass));
+            }
+        }
+    }
+    else if(format == 2)
+    {
+        unsigned int count = U16(table, offset + 2);
+        for(unsigned int i = 0; i < count; ++i)
+        {
+            size_t range = offset + 4 + 6 * i;
+            unsigned int start = U16(table, range);
+            unsigned int end = U16(table, range + 2);
+            unsigned int glyphClass = U16(table, range + 4);
+            for(unsigned int glyph = start;
+                glyphClass && glyph <= end && classes.size() <= 0xffff; ++glyph)
+            {
+                classes.push_back(std::make_pair(glyph, glyphClass));
+            }
+        }
+    }
+
+    std::sort(classes.begin(), classes.end());
+}
+
+
+// The size of a GPOS value record in bytes.
+static inline unsigned int ValueSize(unsigned int format)
+{
+    unsigned int size = 0;
+    for(format &= 0xff; format; format >>= 1)
+    {
+        size += (format & 1) * 2;
+    }
+
+    return size;
+}
+
+
+static void ReadKernPairs(const std::vector<unsigned char>& table, size_t offset,
+                          bool replace, std::map<uint32_t, int>& values)
+{
+    unsigned int count = U16(table, offset);
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        size_t pair = offset + 8 + 6 * i;
+        uint32_t glyphs = (U16(table, pair) << 16) | U16(table, pair + 2);
+        int value = S16(table, pair + 4);
+
+        if(replace)
+        {
+            values[glyphs] = value;
+        }
+        else
+        {
+            values[glyphs] += value;
+        }
+    }
+}
+
+
+struct PairBefore
+{
+    template <typename T>
+    bool operator()(const T& pair, uint32_t glyphs) const
+    {
+        return pair.glyphs < glyphs;
+    }
+};
+
+
+struct PairOrder
+{
+    template <typename T>
+    bool operator()(const T& a, const T& b) const
+    {
+        return a.glyphs < b.glyphs;
+    }
+};
+
+
+struct GlyphBefore
+{
+    template <typename T>
+    bool operator()(const T& glyphClass, unsigned int glyph) const
+    {
+        return glyphClass.glyph < glyph;
+    }
+};
+
+
+KerningTable* KerningTable::Acquire(FT_Face face, uint64_t contentHash)
+{
+    if(contentHash)
+    {
+        MutexLock lock(RegistryMutex());
+        TableMap::iterator it = Registry().find(contentHash);
+        if(it != Registry().end())
+        {
+            ++it->second->references;
+            return it->second;
+        }
+    }
+
+    KerningTable* table = new KerningTable(face, contentHash);
+
+    if(contentHash)
+    {
+        // Another face may have read the same table meanwhile.
+        MutexLock lock(RegistryMutex());
+        std::pair<TableMap::iterator, bool> added =
+            Registry().insert(std::make_pair(contentHash, table));
+        if(!added.second)
+        {
+            delete table;
+            table = added.first->second;
+            ++table->references;
+        }
+    }
+
+    return table;
+}
+
+
+void KerningTable::Release(KerningTable* table)
+{
+    if(!table)
+    {
+        return;
+    }
+
+    if(table->contentHash)
+    {
+        MutexLock lock(RegistryMutex());
+        if(--table->references)
+        {
+            return;
+        }
+
+        Registry().erase(table->contentHash);
+    }
+
+    delete table;
+}
+
+
+KerningTable::KerningTable(FT_Face face, uint64_t hash)
+:   contentHash(hash),
+    references(1)
+{
+    // Like shapers do, the kern table only counts without GPOS kerning.
+    std::vector<unsigned char> table;
+    if(LoadTable(face, TTAG_GPOS, table) && LoadGpos(table))
+    {
+        return;
+    }
+
+    if(LoadTable(face, TTAG_kern, table))
+    {
+        LoadKern(table);
+    }
+}
+
+
+KerningTable::~KerningTable()
+{}
+
+
+int KerningTable::Kern(unsigned int left, unsigned int right) const
+{
+    if(left > 0xffff || right > 0xffff)
+    {
+        return 0;
+    }
+
+    uint32_t glyphs = (left << 16) | right;
+    std::vector<Pair>::const_iterator listed =
+        std::lower_bound(pairs.begin(), pairs.end(), glyphs, PairBefore());
+    std::vector<Pair>::const_iterator pair = listed;
+
+    int value = 0;
+    for(; pair != pairs.end() && pair->glyphs == glyphs; ++pair)
+    {
+        value += pair->value;
+    }
+
+    // Lookups add up. Within one the first class subtable covering the
+    // left glyph applies, unless the lookup lists the pair: individual
+    // pairs are assumed to come before classes, as font tools write them.
+    bool applied = false;
+    unsigned int lookup = 0;
+
+    for(size_t i = 0; i < classes.size(); ++i)
+    {
+        const ClassKerning& kerning = classes[i];
+        if(applied && kerning.lookup == lookup)
+        {
+            continue;
+        }
+
+        std::vector<Pair>::const_iterator it = listed;
+        while(it != pair && it->lookup != kerning.lookup)
+        {
+            ++it;
+        }
+
+        if(it != pair)
+        {
+            continue;
+        }
+
+        int first = FindClass(kerning.first, left);
+        if(first < 0)
+        {
+            continue;
+        }
+
+        int second = FindClass(kerning.second, right);
+        if(second < 0)
+        {
+            second = 0;
+        }
+
+        value += kerning.values[first * kerning.secondClasses + second];
+        applied = true;
+        lookup = kerning.lookup;
+    }
+
+    return value;
+}
+
+
+int KerningTable::FindClass(const std::vector<GlyphClass>& classes,
+                            unsigned int glyph)
+{
+    std::vector<GlyphClass>::const_iterator it =
+        std::lower_bound(classes.begin(), classes.end(), glyph, GlyphBefore());
+    if(it == classes.end() || it->glyph != glyph)
+    {
+        return -1;
+    }
+
+    return it->glyphClass;
+}
+
+
+bool KerningTable::LoadGpos(const std::vector<unsigned char>& table)
+{
+    if(U16(table, 0) != 1)
+    {
+        return false;
+    }
+
+    // Every lookup of every kern feature, whatever the script.
+    size_t featureList = U16(table, 6);
+    size_t lookupList = U16(table, 8);
+    std::set<unsigned int> lookups;
+
+    unsigned int featureCount = U16(table, featureList);
+    for(unsigned int i = 0; i < featureCount; ++i)
+    {
+        size_t record = featureList + 2 + 6 * i;
+        if(U32(table, record) != KERN_FEATURE)
+        {
+            continue;
+        }
+
+        size_t feature = featureList + U16(table, record + 4);
+        unsigned int count = U16(table, feature + 2);
+        for(unsigned int j = 0; j < count; ++j)
+        {
+            lookups.insert(U16(table, feature + 4 + 2 * j));
+        }
+    }
+
+    if(lookups.empty())
+    {
+        return false;
+    }
+
+    // Lookups apply in list order, and add up in Kern().
+    unsigned int lookupCount = U16(table, lookupList);
+
+    for(std::set<unsigned int>::iterator it = lookups.begin();
+        it != lookups.end() && *it < lookupCount; ++it)
+    {
+        size_t lookup = lookupList + U16(table, lookupList + 2 + 2 * *it);
+        unsigned int type = U16(table, lookup);
+        unsigned int subtableCount = U16(table, lookup + 4);
+        std::map<uint32_t, int> lookupPairs;
+
+        for(unsigned int i = 0; i < subtableCount; ++i)
+        {
+            size_t subtable = lookup + U16(table, lookup + 6 + 2 * i);
+            unsigned int subtableType = type;
+
+            if(type == 9)
+            {
+                // Extension, pointing at the real subtable.
+                if(U16(table, subtable) != 1)
+                {
+                    continue;
+                }
+
+                subtableType = U16(table, subtable + 2);
+                subtable += U32(table, subtable + 4);
+            }
+
+            if(subtableType == 2)
+            {
+                LoadPairPos(table, subtable, *it, lookupPairs);
+            }
+        }
+
+        AddPairs(lookupPairs, *it);
+    }
+
+    SortPairs();
+    return true;
+}
+
+
+void KerningTable::LoadPairPos(const std::vector<unsigned char>& table,
+                               size_t offset, unsigned int lookup,
+                               std::map<uint32_t, int>& lookupPairs)
+{
+    unsigned int format = U16(table, offset);
+    unsigned int valueFormat1 = U16(table, offset + 4);
+    unsigned int valueFormat2 = U16(table, offset + 6);
+
+    // Only the first glyph's x advance is kerning.
+    if(!(valueFormat1 & 0x0004))
+    {
+        return;
+    }
+
+    unsigned int xAdvance = ValueSize(valueFormat1 & 0x0003);
+    unsigned int recordSize = ValueSize(valueFormat1) + ValueSize(valueFormat2);
+
+    std::vector<unsigned int> coverage;
+    ReadCoverage(table, offset + U16(table, offset + 2), coverage);
+
+    if(format == 1)
+    {
+        unsigned int pairSetCount = U16(table, offset + 8);
+        for(unsigned int i = 0; i < pairSetCount && i < coverage.size(); ++i)
+        {
+            size_t pairSet = offset + U16(table, offset + 10 + 2 * i);
+            unsigned int count = U16(table, pairSet);
+
+            for(unsigned int j = 0; j < count; ++j)
+            {
+                size_t record = pairSet + 2 + j * (2 + recordSize);
+                uint32_t glyphs = (coverage[i] << 16) | U16(table, record);
+
+                // Within a lookup the first subtable with the pair wins.
+                lookupPairs.insert(std::make_pair(glyphs,
+                                   S16(table, record + 2 + xAdvance)));
+            }
+        }
+    }
+    else if(format == 2)
+    {
+        std::vector<std::pair<unsigned int, unsigned int> > firstClasses;
+        std::vector<std::pair<unsigned int, unsigned int> > secondClasses;
+        ReadClasses(table, offset + U16(table, offset + 8), firstClasses);
+        ReadClasses(table, offset + U16(table, offset + 10), secondClasses);
+
+        ClassKerning kerning;
+        kerning.lookup = lookup;
+        unsigned int firstCount = U16(table, offset + 12);
+        kerning.secondClasses = U16(table, offset + 14);
+
+        // A damaged table may claim far more records than it holds.
+        size_t records = offset + 16;
+        size_t recordCount = static_cast<size_t>(firstCount) * kerning.secondClasses;
+        if(records + recordCount * recordSize > table.size())
+        {
+            return;
+        }
+
+        bool kerned = false;
+        kerning.values.resize(recordCount);
+        for(size_t i = 0; i < kerning.values.size(); ++i)
+        {
+            kerning.values[i] = static_cast<int16_t>(
+                S16(table, records + i * recordSize + xAdvance));
+            kerned = kerned || kerning.values[i];
+        }
+
+        if(!kerned)
+        {
+            return;
+        }
+
+        // Covered glyphs missing from the first class definition are in
+        // class zero.
+        std::sort(coverage.begin(), coverage.end());
+        size_t c = 0;
+        for(size_t i = 0; i < coverage.size(); ++i)
+        {
+            while(c < firstClasses.size() && firstClasses[c].first < coverage[i])
+            {
+                ++c;
+            }
+
+            GlyphClass glyphClass;
+            glyphClass.glyph = static_cast<uint16_t>(coverage[i]);
+            glyphClass.glyphClass = c < firstClasses.size()
+                && firstClasses[c].first == coverage[i]
+                ? static_cast<uint16_t>(firstClasses[c].second) : 0;
+
+            if(glyphClass.glyphClass < firstCount)
+            {
+                kerning.first.push_back(glyphClass);
+            }
+        }
+
+        for(size_t i = 0; i < secondClasses.size(); ++i)
+        {
+            if(secondClasses[i].second < kerning.secondClasses)
+            {
+                GlyphClass glyphClass;
+                glyphClass.glyph = static_cast<uint16_t>(secondClasses[i].first);
+                glyphClass.glyphClass = static_cast<uint16_t>(secondClasses[i].second);
+                kerning.second.push_back(glyphClass);
+            }
+        }
+
+        classes.push_back(kerning);
+    }
+}
+
+
+void KerningTable::LoadKern(const std::vector<unsigned char>& table)
+{
+    std::map<uint32_t, int> values;
+
+    if(U16(table, 0) == 0)
+    {
+        // Microsoft kern table.
+        unsigned int count = U16(table, 2);
+        size_t subtable = 4;
+        for(unsigned int i = 0; i < count; ++i)
+        {
+            unsigned int length = U16(table, subtable + 2);
+            unsigned int coverage = U16(table, subtable + 4);
+
+            // Format 0, horizontal, kerning values rather than minimums,
+            // along the line.
+            if((coverage >> 8) == 0 && (coverage & 0x0007) == 0x0001)
+            {
+                ReadKernPairs(table, subtable + 6, (coverage & 0x0008) != 0,
+                              values);
+            }
+
+            if(length < 6)
+            {
+                break;
+            }
+
+            subtable += length;
+        }
+    }
+    else if(U32(table, 0) == 0x00010000)
+    {
+        // Apple kern table.
+        uint32_t count = U32(table, 4);
+        size_t subtable = 8;
+        for(uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t length = U32(table, subtable);
+            unsigned int coverage = U16(table, subtable + 4);
+
+            // Format 0, horizontal, along the line and not a variation.
+            if((coverage & 0x00ff) == 0 && (coverage & 0xe000) == 0)
+            {
+                ReadKernPairs(table, subtable + 8, false, values);
+            }
+
+            if(length < 8)
+            {
+                break;
+            }
+
+            subtable += length;
+        }
+    }
+
+    AddPairs(values, 0);
+    SortPairs();
+}
+
+
+void KerningTable::AddPairs(const std::map<uint32_t, int>& values,
+                            unsigned int lookup)
+{
+    for(std::map<uint32_t, int>::const_iterator it = values.begin();
+        it != values.end(); ++it)
+    {
+        Pair pair;
+        pair.glyphs = it->first;
+        pair.lookup = lookup;
+        pair.value = it->second;
+        pairs.push_back(pair);
+    }
+}
+
+
+void KerningTable::SortPairs()
+{
+    // Zero pairs matter when they are exceptions to class kerning.
+    if(classes.empty())
+    {
+        std::vector<Pair>::iterator end = pairs.begin();
+        for(std::vector<Pair>::iterator it = pairs.begin(); it != pairs.end(); ++it)
+        {
+            if(it->value)
+            {
+                *end++ = *it;
+            }
+        }
+
+        pairs.erase(end, pairs.end());
+    }
+
+    // Pairs are added lookup by lookup, so a stable sort keeps each
+    // pair's lookups in order.
+    std::stable_sort(pairs.begin(), pairs.end(), PairOrder());
+}
@@ -0,0 +1,182 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_KERNING_TABLE_H_
+#define _DIFONT_KERNING_TABLE_H_
+
+#include "ft2build.h"
+#include FT_FREETYPE_H
+
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * KerningTable holds the pair kerning of a face in font units, read once
+ * from the kern feature of its GPOS table or, failing that, its kern
+ * table. Looking a pair up never calls into FreeType, and the table is
+ * shared by every face with the same contents, whatever their size.
+ */
+namespace difont {
+    class KerningTable {
+    public:
+        /**
+         * Get the table for a face, reading it if no face with the same
+         * contents has.
+         *
+         * @param face          an sfnt face.
+         * @param contentHash   the hash of the face's file, or zero to not
+         *                      share the table.
+         * @return              The table, to be passed to Release().
+         */
+        static KerningTable* Acquire(FT_Face face, uint64_t contentHash);
+
+        /**
+         * Drop a reference taken by Acquire().
+         */
+        static void Release(KerningTable* table);
+
+        /**
+         * Get the kerning between two glyphs.
+         *
+         * @param left   glyph index of the first glyph.
+         * @param right  glyph index of the second glyph.
+         * @return       The horizontal adjustment in font units.
+         */
+        int Kern(unsigned int left, unsigned int right) const;
+
+        /**
+         * Queries whether the face has any kerning.
+         */
+        bool Empty() const { return pairs.empty() && classes.empty(); }
+
+    private:
+        /**
+         * Read the kerning of a face.
+         */
+        KerningTable(FT_Face face, uint64_t contentHash);
+
+        ~KerningTable();
+
+        KerningTable(const KerningTable&);
+        KerningTable& operator=(const KerningTable&);
+
+        /**
+         * Read the GPOS kern feature.
+         *
+         * @return  <code>true</code> if the face has one.
+         */
+        bool LoadGpos(const std::vector<unsigned char>& table);
+
+        /**
+         * Read the format 0 subtables of a kern table.
+         */
+        void LoadKern(const std::vector<unsigned char>& table);
+
+        /**
+         * Read a GPOS pair adjustment subtable.
+         */
+        void LoadPairPos(const std::vector<unsigned char>& table, size_t offset,
+                         unsigned int lookup, std::map<uint32_t, int>& lookupPairs);
+
+        /**
+         * Add the pairs one lookup, or a kern table, lists.
+         */
+        void AddPairs(const std::map<uint32_t, int>& values, unsigned int lookup);
+
+        /**
+         * Sort the pairs once they are all added, dropping zero ones unless
+         * they are exceptions to class kerning.
+         */
+        void SortPairs();
+
+        /**
+         * A kerned pair, the left glyph in the high 16 bits of the key.
+         */
+        struct Pair
+        {
+            uint32_t glyphs;
+            /* The lookup listing the pair */
+            unsigned int lookup;
+            int value;
+        };
+
+        /**
+         * A glyph and the class it belongs to.
+         */
+        struct GlyphClass
+        {
+            uint16_t glyph;
+            uint16_t glyphClass;
+        };
+
+        /**
+         * A GPOS class pair subtable.
+         */
+        struct ClassKerning
+        {
+            /* The lookup the subtable belongs to */
+            unsigned int lookup;
+            /* The covered first glyphs and their classes, by glyph */
+            std::vector<GlyphClass> first;
+            /* Second glyphs not in class zero, by glyph */
+            std::vector<GlyphClass> second;
+            unsigned int secondClasses;
+            /* Values by first class then second class */
+            std::vector<int16_t> values;
+        };
+
+        /**
+         * Find the class of a glyph.
+         *
+         * @return  The class or -1 if the glyph isn't listed.
+         */
+        static int FindClass(const std::vector<GlyphClass>& classes,
+                             unsigned int glyph);
+
+        /**
+         * Individually kerned pairs, sorted by glyphs then lookup
+         */
+        std::vector<Pair> pairs;
+
+        /**
+         * Class kerning, in lookup order
+         */
+        std::vector<ClassKerning> classes;
+
+        /**
+         * The key the table is shared under
+         */
+        uint64_t contentHash;
+
+        /**
+         * Number of faces using the table
+         */
+        int references;
+    };
+}
+
+#endif  //  _DIFONT_KERNING_TABLE_H_
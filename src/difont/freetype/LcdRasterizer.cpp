@@ -0,0 +1,172 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "LcdRasterizer.h"
+#include "SpanRasterizer.h"
+
+#include FT_OUTLINE_H
+
+#include <string.h>
+
+using namespace difont;
+
+
+const unsigned char LcdRasterizer::DEFAULT_FILTER[LcdRasterizer::FILTER_TAPS] =
+{
+    0x08, 0x4D, 0x56, 0x4D, 0x08
+};
+
+
+// Division rounding towards minus and plus infinity, for columns left of
+// the pen.
+static inline int FloorDiv(int n, int d)
+{
+    return n >= 0 ? n / d : -((d - 1 - n) / d);
+}
+
+
+static inline int CeilDiv(int n, int d)
+{
+    return -FloorDiv(-n, d);
+}
+
+
+LcdRasterizer::LcdRasterizer()
+{
+    Filter(NULL);
+}
+
+
+void LcdRasterizer::Filter(const unsigned char* filter)
+{
+    memcpy(weights, filter ? filter : DEFAULT_FILTER, sizeof(weights));
+}
+
+
+void LcdRasterizer::Bounds(const FT_Outline* outline, int& left, int& top,
+                           int& width, int& height)
+{
+    SpanRasterizer::Bounds(outline, left, top, width, height);
+    if(!width || !height)
+    {
+        width = height = 0;
+        return;
+    }
+
+    // The stripes the stretched outline covers, widened by the filter and
+    // rounded out to whole pixels.
+    FT_BBox cbox;
+    FT_Outline_Get_CBox(outline, &cbox);
+
+    int first = static_cast<int>(((cbox.xMin * 3) & ~63) >> 6) - FILTER_TAPS / 2;
+    int last = static_cast<int>(((cbox.xMax * 3 + 63) & ~63) >> 6) + FILTER_TAPS / 2;
+
+    left = FloorDiv(first, 3);
+    width = CeilDiv(last, 3) - left;
+}
+
+
+FT_Error LcdRasterizer::Render(FT_Library library, FT_Outline* outline,
+                               int left, int top, int width, int height,
+                               unsigned char* pixels, int pitch)
+{
+    if(!width || !height)
+    {
+        return 0;
+    }
+
+    int count = width * 3;
+    stripes.resize(count * height);
+
+    // Stretch the outline so each stripe is a whole pixel. Multiplying
+    // the points keeps them exact, so dividing puts them back.
+    for(short i = 0; i < outline->n_points; ++i)
+    {
+        outline->points[i].x *= 3;
+    }
+
+    FT_Error err = 0;
+    if(!coverage.Render(outline, left * 3, top, count, height, &stripes[0], count))
+    {
+        memset(&stripes[0], 0, stripes.size());
+        err = SpanRasterizer::Render(library, outline, left * 3, top, count, height,
+                                     &stripes[0], count);
+    }
+
+    for(short i = 0; i < outline->n_points; ++i)
+    {
+        outline->points[i].x /= 3;
+    }
+
+    if(err)
+    {
+        return err;
+    }
+
+    for(int row = 0; row < height; ++row)
+    {
+        FilterRow(&stripes[row * count], count, pixels + row * pitch);
+    }
+
+    return 0;
+}
+
+
+void LcdRasterizer::Expand(const unsigned char* gray, int width, int height,
+                           int grayPitch, unsigned char* pixels, int pitch)
+{
+    for(int row = 0; row < height; ++row)
+    {
+        const unsigned char* src = gray + row * grayPitch;
+        unsigned char* dst = pixels + row * pitch;
+        for(int x = 0; x < width; ++x)
+        {
+            dst[3 * x] = dst[3 * x + 1] = dst[3 * x + 2] = src[x];
+        }
+    }
+}
+
+
+void LcdRasterizer::FilterRow(const unsigned char* row, int count,
+                              unsigned char* pixels) const
+{
+    // Stripes beyond the ends of the row are empty.
+    for(int i = 0; i < count; ++i)
+    {
+        unsigned int sum = 0;
+        for(int tap = 0; tap < FILTER_TAPS; ++tap)
+        {
+            int j = i + tap - FILTER_TAPS / 2;
+            if(j >= 0 && j < count)
+            {
+                sum += weights[tap] * row[j];
+            }
+        }
+
+        sum >>= 8;
+        pixels[i] = static_cast<unsigned char>(sum > 255 ? 255 : sum);
+    }
+}
@@ -0,0 +1,142 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_LCD_RASTERIZER_H_
+#define _DIFONT_LCD_RASTERIZER_H_
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <vector>
+
+#include "AccumulationRasterizer.h"
+
+namespace difont {
+    /**
+     * LcdRasterizer renders glyph outlines for LCD screens with RGB
+     * stripes. The outline is rasterised at three times its width, one
+     * column per colour stripe, and a five tap filter spreads each
+     * stripe's coverage over its neighbours to hide colour fringes. Each
+     * pixel of the result is three bytes: the coverage of its red, green
+     * and blue stripes, left to right.
+     *
+     * This is what FreeType's FT_RENDER_MODE_LCD does with an LCD filter,
+     * which the bundled FreeType is built without.
+     *
+     * Keep one per thread: the buffers are reused between glyphs.
+     */
+    class LcdRasterizer {
+    public:
+        /**
+         * The number of weights in a filter.
+         */
+        static const int FILTER_TAPS = 5;
+
+        /**
+         * FreeType's default filter, FT_LCD_FILTER_DEFAULT.
+         */
+        static const unsigned char DEFAULT_FILTER[FILTER_TAPS];
+
+        LcdRasterizer();
+
+        /**
+         * Set the filter. The weights apply to the stripes two to the left
+         * through two to the right, in 256ths; they should add up to 256
+         * to keep full coverage at 255.
+         *
+         * @param weights  <code>FILTER_TAPS</code> weights, or
+         *                 <code>NULL</code> for <code>DEFAULT_FILTER</code>.
+         */
+        void Filter(const unsigned char* weights);
+
+        /**
+         * Get the filter weights.
+         */
+        const unsigned char* Filter() const { return weights; }
+
+        /**
+         * Find the pixels an outline covers, with room either side for the
+         * filter to spread into.
+         *
+         * @param outline  The outline.
+         * @param left     Set to the first column, like bitmap_left.
+         * @param top      Set to the row above the first row, like
+         *                 bitmap_top.
+         * @param width    Set to the width in pixels.
+         * @param height   Set to the height in pixels.
+         */
+        static void Bounds(const FT_Outline* outline, int& left, int& top,
+                           int& width, int& height);
+
+        /**
+         * Rasterise an outline into RGB pixels found by <code>Bounds</code>.
+         * Every pixel of the area is written. The outline is stretched
+         * while it is rasterised and put back afterwards.
+         *
+         * @param library  The library to rasterise outlines filled even-odd
+         *                 with.
+         * @param outline  The outline.
+         * @param left     The first column.
+         * @param top      The row above the first row.
+         * @param width    The width in pixels.
+         * @param height   The height in pixels.
+         * @param pixels   The top left pixel, three bytes.
+         * @param pitch    The bytes from one row of pixels to the next.
+         * @return  Zero, or the FreeType error.
+         */
+        FT_Error Render(FT_Library library, FT_Outline* outline,
+                        int left, int top, int width, int height,
+                        unsigned char* pixels, int pitch);
+
+        /**
+         * Copy a gray bitmap, such as an embedded bitmap, into RGB pixels,
+         * giving every stripe of a pixel its coverage.
+         */
+        static void Expand(const unsigned char* gray, int width, int height,
+                           int grayPitch, unsigned char* pixels, int pitch);
+
+    private:
+        /**
+         * Filter one row of stripe coverage into RGB pixels.
+         */
+        void FilterRow(const unsigned char* row, int count,
+                       unsigned char* pixels) const;
+
+        unsigned char weights[FILTER_TAPS];
+
+        /**
+         * Rasterises the stretched outline
+         */
+        difont::AccumulationRasterizer coverage;
+
+        /**
+         * The coverage of each stripe, three per pixel
+         */
+        std::vector<unsigned char> stripes;
+    };
+}
+
+#endif  //  _DIFONT_LCD_RASTERIZER_H_
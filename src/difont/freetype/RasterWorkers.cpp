@@ -0,0 +1,282 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "RasterWorkers.h"
+#include "AccumulationRasterizer.h"
+#include "Face.h"
+#include "LcdRasterizer.h"
+#include "SpanRasterizer.h"
+
+#include FT_OUTLINE_H
+
+#include <string.h>
+
+using namespace difont;
+
+
+RasterWorkers::RasterWorkers(difont::Face& face, unsigned int count,
+                             ReadyCallback readyCallback, void* readyUserData)
+:   data(face.Data()),
+    length(face.DataSize()),
+    callback(readyCallback),
+    userData(readyUserData),
+    stopping(false)
+{
+    if(!data)
+    {
+        return;
+    }
+
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        difont::Thread* thread = new difont::Thread;
+        if(!thread->Start(Work, this))
+        {
+            delete thread;
+            break;
+        }
+
+        threads.push_back(thread);
+    }
+}
+
+
+RasterWorkers::~RasterWorkers()
+{
+    {
+        MutexLock lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    wake.Broadcast();
+
+    for(size_t i = 0; i < threads.size(); ++i)
+    {
+        delete threads[i];
+    }
+}
+
+
+void RasterWorkers::Queue(const RasterJob& job)
+{
+    {
+        MutexLock lock(mutex);
+        jobs.push_back(job);
+    }
+    wake.Signal();
+}
+
+
+void RasterWorkers::Cancel()
+{
+    MutexLock lock(mutex);
+    jobs.clear();
+}
+
+
+void RasterWorkers::TakeResults(std::vector<RasterResult>& finished)
+{
+    MutexLock lock(mutex);
+    finished.swap(results);
+    results.clear();
+}
+
+
+void RasterWorkers::Work(void* argument)
+{
+    RasterWorkers* workers = static_cast<RasterWorkers*>(argument);
+
+    FT_Library library = NULL;
+    FT_Face face = NULL;
+    FT_Error err = FT_Init_FreeType(&library);
+    if(!err)
+    {
+        err = FT_New_Memory_Face(library, workers->data,
+                                 static_cast<FT_Long>(workers->length), 0, &face);
+    }
+
+    // The size the face is set to
+    unsigned int size = 0;
+    unsigned int resolution = 0;
+
+    AccumulationRasterizer rasterizer;
+    LcdRasterizer lcdRasterizer;
+
+    for(;;)
+    {
+        RasterJob job;
+        {
+            MutexLock lock(workers->mutex);
+            while(workers->jobs.empty() && !workers->stopping)
+            {
+                workers->wake.Wait(workers->mutex);
+            }
+
+            if(workers->stopping)
+            {
+                break;
+            }
+
+            job = workers->jobs.front();
+            workers->jobs.pop_front();
+        }
+
+        RasterResult result;
+        result.job = job;
+        result.width = result.height = 0;
+        result.err = err;
+
+        if(!result.err && (job.size != size || job.resolution != resolution))
+        {
+            result.err = FT_Set_Char_Size(face, 0L, job.size * 64,
+                                          job.resolution, job.resolution);
+            size = result.err ? 0 : job.size;
+            resolution = job.resolution;
+        }
+
+        if(!result.err)
+        {
+            Rasterise(face, rasterizer, lcdRasterizer, job, result);
+        }
+
+        bool first;
+        {
+            MutexLock lock(workers->mutex);
+            first = workers->results.empty();
+            workers->results.push_back(result);
+        }
+
+        if(first && workers->callback)
+        {
+            workers->callback(workers->userData);
+        }
+    }
+
+    if(face)
+    {
+        FT_Done_Face(face);
+    }
+    if(library)
+    {
+        FT_Done_FreeType(library);
+    }
+}
+
+
+void RasterWorkers::Rasterise(FT_Face face, AccumulationRasterizer& rasterizer,
+                              LcdRasterizer& lcdRasterizer,
+                              const RasterJob& job, RasterResult& result)
+{
+    // This follows TextureFontImpl::MakeRegion, so the bitmaps are the same
+    // as those made on the render thread.
+    result.err = FT_Load_Glyph(face, job.glyphIndex, job.loadFlags);
+    if(result.err)
+    {
+        return;
+    }
+
+    FT_GlyphSlot slot = face->glyph;
+    result.advance = difont::Point(slot->advance.x / 64.0f, slot->advance.y / 64.0f);
+
+    if(job.rasterSize != job.size && slot->format == ft_glyph_format_outline)
+    {
+        FT_Fixed scale = FT_DivFix(job.rasterSize, job.size);
+        FT_Matrix matrix = { scale, 0, 0, scale };
+        FT_Outline_Transform(&slot->outline, &matrix);
+        result.advance = difont::Point(FT_MulFix(slot->advance.x, scale) / 64.0f,
+                                       FT_MulFix(slot->advance.y, scale) / 64.0f);
+    }
+
+    result.bBox = difont::BBox(slot);
+
+    if(slot->format == ft_glyph_format_outline)
+    {
+        if(job.phase)
+        {
+            FT_Outline_Translate(&slot->outline,
+                                 static_cast<FT_Pos>(job.phase * 64 / job.subpixelPhases), 0);
+        }
+
+        int left, top;
+        if(job.lcd)
+        {
+            LcdRasterizer::Bounds(&slot->outline, left, top, result.width, result.height);
+            result.pixels.resize(result.width * result.height * 3);
+            result.corner = difont::Point(left, top);
+
+            lcdRasterizer.Filter(job.lcdFilter);
+            result.err = lcdRasterizer.Render(slot->library, &slot->outline,
+                                              left, top, result.width, result.height,
+                                              result.pixels.empty() ? NULL : &result.pixels[0],
+                                              result.width * 3);
+            return;
+        }
+
+        SpanRasterizer::Bounds(&slot->outline, left, top, result.width, result.height);
+        result.pixels.assign(result.width * result.height, 0);
+        result.corner = difont::Point(left, top);
+        if(!result.pixels.empty()
+           && !rasterizer.Render(&slot->outline, left, top, result.width, result.height,
+                                 &result.pixels[0], result.width))
+        {
+            result.err = SpanRasterizer::Render(slot->library, &slot->outline,
+                                                left, top, result.width, result.height,
+                                                &result.pixels[0], result.width);
+        }
+        return;
+    }
+
+    result.err = FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
+    if(result.err || slot->format != ft_glyph_format_bitmap)
+    {
+        result.err = result.err ? result.err : FT_Err_Invalid_Glyph_Format;
+        return;
+    }
+
+    const FT_Bitmap& bitmap = slot->bitmap;
+    result.width = bitmap.width;
+    result.height = bitmap.rows;
+    if(job.lcd)
+    {
+        result.pixels.resize(result.width * result.height * 3);
+        if(!result.pixels.empty())
+        {
+            LcdRasterizer::Expand(bitmap.buffer, result.width, result.height, bitmap.pitch,
+                                  &result.pixels[0], result.width * 3);
+        }
+    }
+    else
+    {
+        result.pixels.resize(result.width * result.height);
+        for(int row = 0; row < result.height; ++row)
+        {
+            memcpy(&result.pixels[row * result.width],
+                   bitmap.buffer + row * bitmap.pitch, result.width);
+        }
+    }
+
+    result.corner = difont::Point(slot->bitmap_left, slot->bitmap_top);
+}
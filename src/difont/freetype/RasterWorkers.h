@@ -0,0 +1,199 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_RASTER_WORKERS_H_
+#define _DIFONT_RASTER_WORKERS_H_
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <deque>
+#include <vector>
+
+#include  <difont/difont.h>
+
+#include "Thread.h"
+
+namespace difont {
+    class AccumulationRasterizer;
+    class Face;
+    class LcdRasterizer;
+
+    /**
+     * A glyph bitmap for RasterWorkers to make, and everything needed to
+     * make it the same way the font would.
+     */
+    struct RasterJob {
+        unsigned int glyphIndex;
+        unsigned int phase;
+        unsigned int subpixelPhases;
+        unsigned int size;
+        unsigned int resolution;
+
+        /**
+         * The size to scale the glyph to, which differs from
+         * <code>size</code> when sizes are bucketed.
+         */
+        unsigned int rasterSize;
+        FT_Int loadFlags;
+
+        /**
+         * Whether the glyph is rasterised for LCD screens, and the filter.
+         */
+        bool lcd;
+        unsigned char lcdFilter[5];
+
+        /**
+         * Lets the font ignore results for glyphs it has since discarded.
+         */
+        unsigned int generation;
+    };
+
+    /**
+     * A finished RasterJob.
+     */
+    struct RasterResult {
+        RasterJob job;
+
+        /**
+         * Zero if the glyph was rasterised.
+         */
+        FT_Error err;
+
+        /**
+         * The bitmap, <code>width</code> pixels per row of one byte, or
+         * three for LCD rendering.
+         */
+        std::vector<unsigned char> pixels;
+        int width, height;
+
+        /**
+         * Vector from the pen position to the topleft corner of the bitmap
+         */
+        difont::Point corner;
+
+        difont::Point advance;
+        difont::BBox bBox;
+    };
+
+    /**
+     * RasterWorkers rasterises glyphs on background threads.
+     *
+     * Each thread has its own FT_Library and FT_Face, read from the same
+     * font data as the font's face, so no FreeType object is shared with
+     * the render thread.
+     */
+    class RasterWorkers {
+    public:
+        /**
+         * Called on a worker thread when a result is ready and the
+         * previous results have been taken.
+         */
+        typedef void (*ReadyCallback)(void* userData);
+
+        /**
+         * Start the threads.
+         *
+         * @param face      The face to read the font data of. A font read
+         *                  from memory must keep its buffer valid while the
+         *                  workers exist.
+         * @param threads   The number of threads.
+         * @param callback  Called when results are ready, or
+         *                  <code>NULL</code>.
+         * @param userData  Passed to <code>callback</code>.
+         */
+        RasterWorkers(difont::Face& face, unsigned int threads,
+                      ReadyCallback callback, void* userData);
+
+        /**
+         * Destructor
+         *
+         * Drops the jobs that haven't started and waits for the rest.
+         */
+        ~RasterWorkers();
+
+        /**
+         * Add a job to the end of the queue.
+         */
+        void Queue(const RasterJob& job);
+
+        /**
+         * Drop the jobs that haven't started.
+         */
+        void Cancel();
+
+        /**
+         * Move the finished results into <code>finished</code>.
+         */
+        void TakeResults(std::vector<RasterResult>& finished);
+
+        /**
+         * @return  The number of threads running, which is 0 if the face's
+         *          data couldn't be shared or no thread could be started.
+         *          Jobs queued then never finish.
+         */
+        unsigned int Threads() const { return static_cast<unsigned int>(threads.size()); }
+
+    private:
+        RasterWorkers(const RasterWorkers&);
+        RasterWorkers& operator=(const RasterWorkers&);
+
+        /**
+         * The body of each thread.
+         */
+        static void Work(void* workers);
+
+        /**
+         * Rasterise one glyph with a thread's face and rasterisers.
+         */
+        static void Rasterise(FT_Face face, AccumulationRasterizer& rasterizer,
+                              LcdRasterizer& lcdRasterizer,
+                              const RasterJob& job, RasterResult& result);
+
+        /**
+         * The font data, owned by the face
+         */
+        const unsigned char* data;
+        size_t length;
+
+        ReadyCallback callback;
+        void* userData;
+
+        /**
+         * Guards the queue, the results and <code>stopping</code>
+         */
+        difont::Mutex mutex;
+        difont::Condition wake;
+
+        std::deque<RasterJob> jobs;
+        std::vector<RasterResult> results;
+        bool stopping;
+
+        std::vector<difont::Thread*> threads;
+    };
+}
+
+#endif  //  _DIFONT_RASTER_WORKERS_H_
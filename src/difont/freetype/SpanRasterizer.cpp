@@ -0,0 +1,113 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "SpanRasterizer.h"
+
+#include FT_OUTLINE_H
+
+#include <string.h>
+
+using namespace difont;
+
+
+struct SpanTarget {
+    unsigned char* pixels;
+    int pitch;
+    int height;
+};
+
+
+static void GraySpans(int y, int count, const FT_Span* spans, void* user)
+{
+    // FreeType counts rows up from the baseline, the pixels go down.
+    const SpanTarget* target = static_cast<const SpanTarget*>(user);
+    unsigned char* row = target->pixels + (target->height - 1 - y) * target->pitch;
+
+    for(int i = 0; i < count; ++i)
+    {
+        const FT_Span& span = spans[i];
+        if(span.coverage)
+        {
+            memset(row + span.x, span.coverage, span.len);
+        }
+    }
+}
+
+
+void SpanRasterizer::Bounds(const FT_Outline* outline, int& left, int& top,
+                            int& width, int& height)
+{
+    FT_BBox cbox;
+    FT_Outline_Get_CBox(outline, &cbox);
+
+    FT_Pos xMin = cbox.xMin & ~63;
+    FT_Pos yMin = cbox.yMin & ~63;
+    FT_Pos xMax = (cbox.xMax + 63) & ~63;
+    FT_Pos yMax = (cbox.yMax + 63) & ~63;
+
+    left = static_cast<int>(xMin >> 6);
+    top = static_cast<int>(yMax >> 6);
+    width = static_cast<int>((xMax - xMin) >> 6);
+    height = static_cast<int>((yMax - yMin) >> 6);
+}
+
+
+FT_Error SpanRasterizer::Render(FT_Library library, FT_Outline* outline,
+                                int left, int top, int width, int height,
+                                unsigned char* pixels, int pitch)
+{
+    if(!width || !height)
+    {
+        return 0;
+    }
+
+    SpanTarget target;
+    target.pixels = pixels;
+    target.pitch = pitch;
+    target.height = height;
+
+    FT_Raster_Params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = FT_RASTER_FLAG_AA | FT_RASTER_FLAG_DIRECT | FT_RASTER_FLAG_CLIP;
+    params.gray_spans = GraySpans;
+    params.user = &target;
+    params.clip_box.xMin = 0;
+    params.clip_box.yMin = 0;
+    params.clip_box.xMax = width;
+    params.clip_box.yMax = height;
+
+    // Move the bottom left pixel to the origin while rasterising, as the
+    // smooth renderer does. The rasteriser rounds negative coordinates
+    // differently, so this keeps the coverage the same.
+    FT_Pos xShift = static_cast<FT_Pos>(left) * 64;
+    FT_Pos yShift = static_cast<FT_Pos>(top - height) * 64;
+
+    FT_Outline_Translate(outline, -xShift, -yShift);
+    FT_Error err = FT_Outline_Render(library, outline, &params);
+    FT_Outline_Translate(outline, xShift, yShift);
+
+    return err;
+}
@@ -0,0 +1,77 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_SPAN_RASTERIZER_H_
+#define _DIFONT_SPAN_RASTERIZER_H_
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+namespace difont {
+    /**
+     * SpanRasterizer renders glyph outlines with FreeType's anti-aliased
+     * rasteriser straight into a caller's pixels, through a gray spans
+     * callback, instead of into the glyph slot's own bitmap. The coverage
+     * is the same as FT_Render_Glyph with FT_RENDER_MODE_NORMAL.
+     */
+    class SpanRasterizer {
+    public:
+        /**
+         * Find the pixels an outline covers, rounded out to whole pixels
+         * as the smooth renderer rounds them.
+         *
+         * @param outline  The outline.
+         * @param left     Set to the first column, like bitmap_left.
+         * @param top      Set to the row above the first row, like
+         *                 bitmap_top.
+         * @param width    Set to the width in pixels.
+         * @param height   Set to the height in pixels.
+         */
+        static void Bounds(const FT_Outline* outline, int& left, int& top,
+                           int& width, int& height);
+
+        /**
+         * Rasterise an outline into pixels found by <code>Bounds</code>.
+         * Only covered pixels are written, so the area must be cleared.
+         *
+         * @param library  The library to rasterise with. FreeType's
+         *                 rasteriser isn't shared between threads.
+         * @param outline  The outline.
+         * @param left     The first column.
+         * @param top      The row above the first row.
+         * @param width    The width in pixels; nothing outside is written.
+         * @param height   The height in pixels.
+         * @param pixels   The top left pixel.
+         * @param pitch    The bytes from one row of pixels to the next.
+         * @return  Zero, or the FreeType error.
+         */
+        static FT_Error Render(FT_Library library, FT_Outline* outline,
+                               int left, int top, int width, int height,
+                               unsigned char* pixels, int pitch);
+    };
+}
+
+#endif  //  _DIFONT_SPAN_RASTERIZER_H_
@@ -106,6 +106,12 @@ BitmapGlyphImpl::~BitmapGlyphImpl()
 }
 
 
+size_t BitmapGlyphImpl::Footprint() const
+{
+    return sizeof(*this) + (data ? destPitch * destHeight : 0);
+}
+
+
 const difont::Point& BitmapGlyphImpl::RenderImpl(const difont::Point& pen, int renderMode)
 {
     if(data)
@@ -33,6 +33,7 @@ namespace difont {
     class BitmapGlyphImpl : public GlyphImpl
     {
         friend class BitmapGlyph;
+        friend class FontImpl;
 
     protected:
         BitmapGlyphImpl(FT_GlyphSlot glyph);
@@ -41,6 +42,8 @@ namespace difont {
 
         virtual const difont::Point& RenderImpl(const difont::Point& pen, int renderMode);
 
+        virtual size_t Footprint() const;
+
     private:
         /**
          * The width of the glyph 'image'
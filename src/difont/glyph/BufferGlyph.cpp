@@ -28,7 +28,10 @@
 #include  <difont/difont.h>
 
 #include "Internals.h"
+#include "CoverageBlit.h"
 #include "BufferGlyphImpl.h"
+#include "AccumulationRasterizer.h"
+#include "SpanRasterizer.h"
 
 
 //
@@ -61,23 +64,57 @@ const difont::Point& BufferGlyph::Render(const difont::Point& pen, int renderMod
 BufferGlyphImpl::BufferGlyphImpl(FT_GlyphSlot glyph, Buffer *p)
 :   GlyphImpl(glyph),
     has_bitmap(false),
+    width(0),
+    height(0),
+    pixels(0),
     buffer(p)
 {
-    err = FT_Render_Glyph(glyph, FT_RENDER_MODE_NORMAL);
-    if(err || glyph->format != ft_glyph_format_bitmap)
+    if(glyph->format == ft_glyph_format_outline)
     {
-        return;
-    }
+        // Rasterise into our own pixels rather than the slot's bitmap,
+        // which would only be copied.
+        int left, top;
+        difont::SpanRasterizer::Bounds(&glyph->outline, left, top, width, height);
+        pixels = new unsigned char[width * height];
+
+        difont::AccumulationRasterizer rasterizer;
+        if(!rasterizer.Render(&glyph->outline, left, top, width, height,
+                              pixels, width))
+        {
+            memset(pixels, 0, width * height);
+            err = difont::SpanRasterizer::Render(glyph->library, &glyph->outline,
+                                                 left, top, width, height,
+                                                 pixels, width);
+        }
 
-    bitmap = glyph->bitmap;
-    pixels = new unsigned char[bitmap.pitch * bitmap.rows];
-    memcpy(pixels, bitmap.buffer, bitmap.pitch * bitmap.rows);
+        if(err)
+        {
+            return;
+        }
 
-    if(bitmap.width && bitmap.rows)
+        corner = difont::Point(left, top);
+    }
+    else
     {
-        has_bitmap = true;
+        err = FT_Render_Glyph(glyph, FT_RENDER_MODE_NORMAL);
+        if(err || glyph->format != ft_glyph_format_bitmap)
+        {
+            return;
+        }
+
+        FT_Bitmap bitmap = glyph->bitmap;
+        width = bitmap.width;
+        height = bitmap.rows;
+        pixels = new unsigned char[width * height];
+        for(int y = 0; y < height; ++y)
+        {
+            memcpy(pixels + y * width, bitmap.buffer + y * bitmap.pitch, width);
+        }
+
         corner = difont::Point(glyph->bitmap_left, glyph->bitmap_top);
     }
+
+    has_bitmap = width && height;
 }
 
 
@@ -87,6 +124,12 @@ BufferGlyphImpl::~BufferGlyphImpl()
 }
 
 
+size_t BufferGlyphImpl::Footprint() const
+{
+    return sizeof(*this) + (pixels ? width * height : 0);
+}
+
+
 const difont::Point& BufferGlyphImpl::RenderImpl(const difont::Point& pen, int renderMode)
 {
     if(has_bitmap)
@@ -94,27 +137,10 @@ const difont::Point& BufferGlyphImpl::RenderImpl(const difont::Point& pen, int r
         difont::Point pos(buffer->Pos() + pen + corner);
         int dx = (int)(pos.Xf() + 0.5f);
         int dy = buffer->Height() - (int)(pos.Yf() + 0.5f);
-        unsigned char * dest = buffer->Pixels() + dx + dy * buffer->Width();
 
-        for(int y = 0; y < bitmap.rows; y++)
-        {
-            // FIXME: change the loop bounds instead of doing this test
-            if(y + dy < 0 || y + dy >= buffer->Height()) continue;
-
-            for(int x = 0; x < bitmap.width; x++)
-            {
-                if(x + dx < 0 || x + dx >= buffer->Width()) continue;
-
-                unsigned char p = pixels[y * bitmap.pitch + x];
-
-                if(p)
-                {
-                    dest[y * buffer->Width() + x] = p;
-                }
-            }
-        }
+        difont::AddCoverage(buffer->Pixels(), buffer->Width(), buffer->Height(),
+                            dx, dy, pixels, width, height);
     }
 
     return advance;
 }
-
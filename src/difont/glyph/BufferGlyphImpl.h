@@ -31,6 +31,7 @@
 namespace difont {
     class BufferGlyphImpl : public GlyphImpl {
         friend class BufferGlyph;
+        friend class FontImpl;
 
     protected:
         BufferGlyphImpl(FT_GlyphSlot glyph, Buffer *p);
@@ -39,9 +40,11 @@ namespace difont {
 
         virtual const difont::Point& RenderImpl(const difont::Point& pen, int renderMode);
 
+        virtual size_t Footprint() const;
+
     private:
         bool has_bitmap;
-        FT_Bitmap bitmap;
+        int width, height;
         unsigned char *pixels;
         difont::Point corner;
 
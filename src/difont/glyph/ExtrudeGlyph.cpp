@@ -131,6 +131,12 @@ ExtrudeGlyphImpl::~ExtrudeGlyphImpl()
 }
 
 
+size_t ExtrudeGlyphImpl::Footprint() const
+{
+    return sizeof(*this) + (vectoriser ? vectoriser->Footprint() : 0);
+}
+
+
 const difont::Point& ExtrudeGlyphImpl::RenderImpl(const difont::Point& pen,
                                               int renderMode)
 {
@@ -43,6 +43,8 @@ namespace difont {
 
         virtual const difont::Point& RenderImpl(const difont::Point& pen, int renderMode);
 
+        virtual size_t Footprint() const;
+
     private:
         /**
          * Private rendering methods.
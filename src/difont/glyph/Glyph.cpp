@@ -106,3 +106,9 @@ FT_Error difont::GlyphImpl::Error() const
     return err;
 }
 
+
+size_t difont::GlyphImpl::Footprint() const
+{
+    return sizeof(*this);
+}
+
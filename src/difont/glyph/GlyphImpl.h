@@ -32,6 +32,7 @@
 namespace difont {
     class GlyphImpl {
         friend class Glyph;
+        friend class GlyphContainer;
 
     protected:
         GlyphImpl(FT_GlyphSlot glyph, bool useDisplayList = true);
@@ -44,6 +45,12 @@ namespace difont {
 
         FT_Error Error() const;
 
+        /**
+         * The memory used by this glyph, in bytes. Glyphs holding more
+         * than their metrics add the size of their data.
+         */
+        virtual size_t Footprint() const;
+
         /**
          * The advance distance for this glyph
          */
@@ -92,6 +92,12 @@ OutlineGlyphImpl::~OutlineGlyphImpl()
 }
 
 
+size_t OutlineGlyphImpl::Footprint() const
+{
+    return sizeof(*this) + (vectoriser ? vectoriser->Footprint() : 0);
+}
+
+
 const difont::Point& OutlineGlyphImpl::RenderImpl(const difont::Point& pen,
                                               int renderMode)
 {
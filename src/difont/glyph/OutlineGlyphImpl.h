@@ -34,6 +34,7 @@ namespace difont {
 
     class OutlineGlyphImpl : public GlyphImpl {
         friend class OutlineGlyph;
+        friend class FontImpl;
 
     protected:
         OutlineGlyphImpl(FT_GlyphSlot glyph, float outset,
@@ -43,6 +44,8 @@ namespace difont {
 
         virtual const difont::Point& RenderImpl(const difont::Point& pen, int renderMode);
 
+        virtual size_t Footprint() const;
+
     private:
         /**
          * Renders contours of vectoriser.
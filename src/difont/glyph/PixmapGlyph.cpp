@@ -113,6 +113,12 @@ difont::PixmapGlyphImpl::~PixmapGlyphImpl()
 }
 
 
+size_t difont::PixmapGlyphImpl::Footprint() const
+{
+    return sizeof(*this) + (data ? destWidth * destHeight * 2 : 0);
+}
+
+
 const difont::Point& difont::PixmapGlyphImpl::RenderImpl(const difont::Point& pen,
                                                          int renderMode)
 {
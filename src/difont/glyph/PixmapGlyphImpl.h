@@ -32,6 +32,7 @@
 namespace difont {
     class PixmapGlyphImpl : public GlyphImpl {
         friend class PixmapGlyph;
+        friend class FontImpl;
 
     protected:
         PixmapGlyphImpl(FT_GlyphSlot glyph);
@@ -40,6 +41,8 @@ namespace difont {
 
         virtual const difont::Point& RenderImpl(const difont::Point& pen, int renderMode);
 
+        virtual size_t Footprint() const;
+
     private:
         /**
          * The width of the glyph 'image'
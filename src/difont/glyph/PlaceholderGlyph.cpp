@@ -0,0 +1,59 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include  <difont/difont.h>
+
+#include "Internals.h"
+#include "PlaceholderGlyph.h"
+
+
+difont::PlaceholderGlyph::PlaceholderGlyph(float x, const difont::BBox& box)
+:   Glyph(static_cast<FT_GlyphSlot>(NULL)),
+    advance(x, 0.0f),
+    bBox(box)
+{}
+
+
+difont::PlaceholderGlyph::~PlaceholderGlyph()
+{}
+
+
+const difont::Point& difont::PlaceholderGlyph::Render(const difont::Point& pen, int renderMode)
+{
+    return advance;
+}
+
+
+float difont::PlaceholderGlyph::Advance() const
+{
+    return advance.Xf();
+}
+
+
+const difont::BBox& difont::PlaceholderGlyph::BBox() const
+{
+    return bBox;
+}
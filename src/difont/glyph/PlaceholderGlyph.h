@@ -0,0 +1,59 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef _DIFONT_PLACEHOLDER_GLYPH_H_
+#define _DIFONT_PLACEHOLDER_GLYPH_H_
+
+#include  <difont/difont.h>
+
+namespace difont {
+    /**
+     * PlaceholderGlyph stands in for a glyph that hasn't been made yet. It
+     * draws nothing, but advances the pen as far as the real glyph will.
+     */
+    class PlaceholderGlyph : public Glyph {
+    public:
+        /**
+         * @param advance  The advance of the real glyph.
+         * @param box      A box to report until the real glyph is made.
+         */
+        PlaceholderGlyph(float advance, const difont::BBox& box);
+
+        virtual ~PlaceholderGlyph();
+
+        virtual const difont::Point& Render(const difont::Point& pen, int renderMode);
+
+        virtual float Advance() const;
+
+        virtual const difont::BBox& BBox() const;
+
+    private:
+        difont::Point advance;
+        difont::BBox bBox;
+    };
+}
+
+#endif  //  _DIFONT_PLACEHOLDER_GLYPH_H_
@@ -88,6 +88,12 @@ PolygonGlyphImpl::~PolygonGlyphImpl()
 }
 
 
+size_t PolygonGlyphImpl::Footprint() const
+{
+    return sizeof(*this) + (vectoriser ? vectoriser->Footprint() : 0);
+}
+
+
 const difont::Point& PolygonGlyphImpl::RenderImpl(const difont::Point& pen,
                                               int renderMode)
 {
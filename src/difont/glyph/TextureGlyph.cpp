@@ -30,6 +30,7 @@
 
 #include "Internals.h"
 #include "TextureGlyphImpl.h"
+#include "TextureFontImpl.h"
 
 
 //
@@ -38,6 +39,17 @@
 
 using namespace difont;
 
+TextureGlyph::TextureGlyph(FT_GlyphSlot glyph, TextureFontImpl *font,
+                           unsigned int glyphIndex) :
+Glyph(new TextureGlyphImpl(glyph, font, glyphIndex))
+{}
+
+
+TextureGlyph::TextureGlyph(TextureFontImpl *font, unsigned int glyphIndex) :
+Glyph(new TextureGlyphImpl(font, glyphIndex))
+{}
+
+
 TextureGlyph::TextureGlyph(FT_GlyphSlot glyph, int id, int xOffset,
                            int yOffset, int width, int height) :
 Glyph(new TextureGlyphImpl(glyph, id, xOffset, yOffset, width, height))
@@ -59,13 +71,59 @@ const difont::Point& TextureGlyph::Render(const difont::Point& pen, int renderMo
 //  FTGLTextureGlyphImpl
 //
 
+TextureGlyphImpl::TextureGlyphImpl(FT_GlyphSlot glyph, TextureFontImpl *f,
+                                   unsigned int index)
+:   GlyphImpl(glyph), font(f), textureID(0), ownRegion(NULL), glyphIndex(index)
+{
+    for(unsigned int i = 0; i < TextureFont::MAX_SUBPIXEL_PHASES; ++i)
+    {
+        regions[i] = -1;
+    }
+
+    regions[0] = font->MakeRegion(glyph, 0);
+    if(regions[0] < 0)
+    {
+        err = font->err;
+    }
+}
+
+
+TextureGlyphImpl::TextureGlyphImpl(TextureFontImpl *f, unsigned int index)
+:   GlyphImpl(NULL), font(f), textureID(0), ownRegion(NULL), glyphIndex(index)
+{
+    for(unsigned int i = 0; i < TextureFont::MAX_SUBPIXEL_PHASES; ++i)
+    {
+        regions[i] = font->FindRegion(glyphIndex, i);
+    }
+
+    if(regions[0] >= 0)
+    {
+        font->RegionMetrics(font->Region(regions[0]), advance, bBox);
+    }
+    else
+    {
+        // Being rasterised in the background.
+        font->WaitForRegion(this);
+    }
+}
+
+
 TextureGlyphImpl::TextureGlyphImpl(FT_GlyphSlot glyph, int id, int xOffset,
                                    int yOffset, int width, int height)
-:   GlyphImpl(glyph), destWidth(0), destHeight(0), glTextureID(id)
+:   GlyphImpl(glyph), font(NULL), textureID(id), ownRegion(new TextureRegion),
+    glyphIndex(0)
 {
-    /* FIXME: need to propagate the render mode all the way down to
-     * here in order to get FT_RENDER_MODE_MONO aliased fonts.
-     */
+    for(unsigned int i = 0; i < TextureFont::MAX_SUBPIXEL_PHASES; ++i)
+    {
+        regions[i] = -1;
+    }
+
+    ownRegion->page = 0;
+    ownRegion->glyphIndex = glyphIndex;
+    ownRegion->phase = 0;
+    ownRegion->x = xOffset;
+    ownRegion->y = yOffset;
+    ownRegion->width = ownRegion->height = 0;
 
     err = FT_Render_Glyph(glyph, FT_RENDER_MODE_NORMAL);
     if(err || glyph->format != ft_glyph_format_bitmap)
@@ -73,67 +131,138 @@ TextureGlyphImpl::TextureGlyphImpl(FT_GlyphSlot glyph, int id, int xOffset,
         return;
     }
 
-    FT_Bitmap      bitmap = glyph->bitmap;
+    FT_Bitmap bitmap = glyph->bitmap;
+    ownRegion->width = bitmap.width;
+    ownRegion->height = bitmap.rows;
 
-    destWidth  = bitmap.width;
-    destHeight = bitmap.rows;
-
-    if (destWidth && destHeight)
+    if(ownRegion->width && ownRegion->height)
     {
-          //      glPixelStorei(GL_PACK_ALIGNMENT, 1);
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        difont::gl::BindTexture(glTextureID);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, xOffset, yOffset, destWidth, destHeight, GL_ALPHA, GL_UNSIGNED_BYTE, bitmap.buffer);
+        difont::gl::BindTexture(textureID);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, xOffset, yOffset, bitmap.width, bitmap.rows,
+                        GL_ALPHA, GL_UNSIGNED_BYTE, bitmap.buffer);
     }
-    //      0
-    //      +----+
-    //      |    |
-    //      |    |
-    //      |    |
-    //      +----+
-    //           1
-    uv[0].X(static_cast<float>(xOffset) / static_cast<float>(width));
-    uv[0].Y(static_cast<float>(yOffset) / static_cast<float>(height));
-    uv[1].X(static_cast<float>(xOffset + destWidth) / static_cast<float>(width));
-    uv[1].Y(static_cast<float>(yOffset + destHeight) / static_cast<float>(height));
-
-    corner = difont::Point(glyph->bitmap_left, glyph->bitmap_top);
+
+    ownRegion->uv[0].X(static_cast<float>(xOffset) / static_cast<float>(width));
+    ownRegion->uv[0].Y(static_cast<float>(yOffset) / static_cast<float>(height));
+    ownRegion->uv[1].X(static_cast<float>(xOffset + ownRegion->width) / static_cast<float>(width));
+    ownRegion->uv[1].Y(static_cast<float>(yOffset + ownRegion->height) / static_cast<float>(height));
+
+    ownRegion->corner = difont::Point(glyph->bitmap_left, glyph->bitmap_top);
+    ownRegion->advance = advance;
+    ownRegion->bBox = bBox;
+    regions[0] = 0;
 }
 
 
 TextureGlyphImpl::~TextureGlyphImpl()
-{}
+{
+    if(!font)
+    {
+        delete ownRegion;
+        return;
+    }
+
+    // A glyph evicted from the cache may still be waiting for its bitmap.
+    if(regions[0] < 0)
+    {
+        font->ForgetWaitingGlyph(this);
+    }
+}
 
 
 const difont::Point& TextureGlyphImpl::RenderImpl(const difont::Point& pen,
                                                   int renderMode)
 {
-    float dx, dy;
+    float dx;
+    unsigned int phase = 0;
+
+    dx = floor(pen.Xf());
+
+    if(!font)
+    {
+        if(regions[0] < 0)
+        {
+            return advance;
+        }
+
+        return RenderRegion(*ownRegion, textureID, dx, pen, 1.0f, 0.0f);
+    }
+
+    unsigned int phases = font->SubpixelPhases();
+    if(phases > 1)
+    {
+        phase = static_cast<unsigned int>((pen.Xf() - dx) * phases + 0.5f);
+        if(phase == phases)
+        {
+            phase = 0;
+            dx += 1.0f;
+        }
+
+        if(regions[phase] < 0)
+        {
+            regions[phase] = font->RequestRegion(glyphIndex, phase);
+        }
+
+        if(regions[phase] < 0)
+        {
+            phase = 0;
+        }
+    }
+
+    if(regions[phase] < 0)
+    {
+        return advance;
+    }
+
+    const TextureRegion& region = font->Region(regions[phase]);
+
+    // The layer is only used when the pages are a texture array.
+    float layer = font->TextureArrayPages() ? static_cast<float>(region.page) : 0.0f;
+
+    // Bitmaps rasterised at a bucket size are scaled to the face size.
+    return RenderRegion(region, font->PageTexture(region.page), dx, pen,
+                        font->QuadScale(), layer);
+}
+
+
+const difont::Point& TextureGlyphImpl::RenderRegion(const TextureRegion& region,
+                                                    unsigned int texture, float dx,
+                                                    const difont::Point& pen,
+                                                    float scale, float layer)
+{
+    float dy;
 
-    dx = floor(pen.Xf() + corner.Xf());
-    dy = floor(pen.Yf() + corner.Yf());
+    dx += region.corner.Xf() * scale;
+    dy = floor(pen.Yf() + region.corner.Yf() * scale);
+
+    const difont::Point *uv = region.uv;
+    float destWidth = static_cast<float>(region.width) * scale;
+    float destHeight = static_cast<float>(region.height) * scale;
 
     difont::FontVertex v1, v2, v3, v4;
 
-    v1.SetTexCoord2f(uv[0].Xf(), uv[0].Yf());
+    v1.SetTexCoord3f(uv[0].Xf(), uv[0].Yf(), layer);
     v1.SetVertex2f(dx, dy);
 
-    v2.SetTexCoord2f(uv[0].Xf(), uv[1].Yf());
+    v2.SetTexCoord3f(uv[0].Xf(), uv[1].Yf(), layer);
     v2.SetVertex2f(dx, dy - destHeight);
 
-    v3.SetTexCoord2f(uv[1].Xf(), uv[1].Yf());
+    v3.SetTexCoord3f(uv[1].Xf(), uv[1].Yf(), layer);
     v3.SetVertex2f(dx + destWidth, dy - destHeight);
 
-    v4.SetTexCoord2f(uv[1].Xf(), uv[0].Yf());
+    v4.SetTexCoord3f(uv[1].Xf(), uv[0].Yf(), layer);
     v4.SetVertex2f(dx + destWidth, dy);
 
-    difont::FontMeshSet::AddMesh(GL_QUADS);
-    difont::FontMeshSet::SetTextureId(glTextureID);
-    difont::FontMeshSet::AddVertex(v1);
-    difont::FontMeshSet::AddVertex(v2);
-    difont::FontMeshSet::AddVertex(v3);
-    difont::FontMeshSet::AddVertex(v4);
+    difont::FontMeshSet::AddQuad(texture, v1, v2, v3, v4);
     
     return advance;
 }
 
+
+size_t TextureGlyphImpl::Footprint() const
+{
+    // The bitmaps belong to the font's atlas, and outlive the glyph so it
+    // can be made again without rasterising; see Font::GlyphCacheBudget().
+    return sizeof(*this) + (ownRegion ? sizeof(*ownRegion) : 0);
+}
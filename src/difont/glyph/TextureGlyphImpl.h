@@ -30,48 +30,72 @@
 #include "GlyphImpl.h"
 
 namespace difont {
+    struct TextureRegion;
+
     class TextureGlyphImpl : public GlyphImpl {
         friend class TextureGlyph;
+        friend class FontImpl;
         friend class TextureFontImpl;
 
     protected:
+        TextureGlyphImpl(FT_GlyphSlot glyph, TextureFontImpl *font,
+                         unsigned int glyphIndex);
+
+        TextureGlyphImpl(TextureFontImpl *font, unsigned int glyphIndex);
+
         TextureGlyphImpl(FT_GlyphSlot glyph, int id, int xOffset,
-                           int yOffset, int width, int height);
+                         int yOffset, int width, int height);
 
         virtual ~TextureGlyphImpl();
 
         virtual const difont::Point& RenderImpl(const difont::Point& pen, int renderMode);
 
+        virtual size_t Footprint() const;
+
     private:
         /**
-         * Kept for backwards compatability with FTGL.
+         * Add the quad for a bitmap to the mesh.
+         *
+         * @param region   The bitmap.
+         * @param texture  The texture holding it.
+         * @param dx       The pen position, in whole pixels.
+         * @param pen      The pen position.
+         * @param scale    How much to scale the bitmap by.
+         * @param layer    The layer of a texture array holding it.
+         * @return  The advance distance for this glyph.
          */
-        static void ResetActiveTexture() {}
+        const difont::Point& RenderRegion(const TextureRegion& region,
+                                          unsigned int texture, float dx,
+                                          const difont::Point& pen,
+                                          float scale, float layer);
 
         /**
-         * The width of the glyph 'image'
+         * Kept for backwards compatability with FTGL.
          */
-        int destWidth;
+        static void ResetActiveTexture() {}
 
         /**
-         * The height of the glyph 'image'
+         * The font whose textures hold this glyph's bitmaps, or NULL for a
+         * glyph in a texture of its creator's.
          */
-        int destHeight;
+        TextureFontImpl *font;
 
         /**
-         * Vector from the pen position to the topleft corner of the pixmap
+         * Without a font, the texture and the bitmap in it.
          */
-        difont::Point corner;
+        int textureID;
+        TextureRegion *ownRegion;
 
         /**
-         * The texture co-ords of this glyph within the texture.
+         * The index of this glyph in the font face.
          */
-        difont::Point uv[2];
+        unsigned int glyphIndex;
 
         /**
-         * The texture index that this glyph is contained in.
+         * The font region holding the bitmap for each subpixel phase, or -1
+         * if that phase hasn't been rasterised.
          */
-        int glTextureID;
+        int regions[TextureFont::MAX_SUBPIXEL_PHASES];
     };
 }
 
@@ -42,6 +42,14 @@ void difont::Contour::AddPoint(difont::Point point)
 }
 
 
+size_t difont::Contour::Footprint() const
+{
+    return sizeof(*this) + sizeof(difont::Point)
+        * (pointList.capacity() + outsetPointList.capacity()
+           + frontPointList.capacity() + backPointList.capacity());
+}
+
+
 void difont::Contour::AddOutsetPoint(difont::Point point)
 {
     outsetPointList.push_back(point);
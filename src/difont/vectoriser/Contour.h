@@ -113,6 +113,11 @@ namespace difont {
          */
         size_t PointCount() const { return pointList.size(); }
 
+        /**
+         * The memory used by this contour, in bytes.
+         */
+        size_t Footprint() const;
+
         /**
          * Make sure the glyph has the proper parity and create the front/back
          * outset contour.
@@ -1,4 +1,5 @@
 #include "FontMesh.h"
+#include "difont/opengl/OpenGLInterface.h"
 
 #include <stdio.h>
 #include <assert.h>
@@ -29,6 +30,14 @@ void difont::FontVertex::SetVertex2f(float x, float y) {
 void difont::FontVertex::SetTexCoord2f(float s, float t) {
     texCoord[0] = s;
     texCoord[1] = t;
+    texCoord[2] = 0.0f;
+}
+
+
+void difont::FontVertex::SetTexCoord3f(float s, float t, float r) {
+    texCoord[0] = s;
+    texCoord[1] = t;
+    texCoord[2] = r;
 }
 
 
@@ -89,6 +98,33 @@ void difont::FontMeshSet::AddVertex(difont::FontVertex vertex) {
 }
 
 
+void difont::FontMeshSet::AddQuad(unsigned int texId,
+                                  const difont::FontVertex& v1, const difont::FontVertex& v2,
+                                  const difont::FontVertex& v3, const difont::FontVertex& v4) {
+    difont::FontMesh *last = meshCount ? &meshes[meshCount - 1] : NULL;
+    if (!last || last->primitive != GL_QUADS || last->textureId != texId
+        || last->currIndex + 4 > DIFONT_MESH_MAX_VERTICES) {
+        AddMesh(GL_QUADS);
+        SetTextureId(texId);
+        last = &meshes[meshCount - 1];
+    }
+
+    last->AddVertex(v1);
+    last->AddVertex(v2);
+    last->AddVertex(v3);
+    last->AddVertex(v4);
+}
+
+
+void difont::FontMeshSet::ReplaceTextureId(unsigned int oldTexId, unsigned int newTexId) {
+    for (int i = 0; i < meshCount; ++i) {
+        if (meshes[i].textureId == oldTexId) {
+            meshes[i].textureId = newTexId;
+        }
+    }
+}
+
+
 void difont::FontMeshSet::End() {
 }
 
@@ -8,7 +8,7 @@ namespace difont {
     public:
         FontVertex() {
             position[0] = position[1] = position[2] = 0.0f;
-            texCoord[0] = texCoord[1] = 0.0f;
+            texCoord[0] = texCoord[1] = texCoord[2] = 0.0f;
         }
 
         void SetVertex3f(float x, float y, float z);
@@ -17,8 +17,14 @@ namespace difont {
 
         void SetTexCoord2f(float s, float t);
 
+        void SetTexCoord3f(float s, float t, float r);
+
         float position[3];
-        float texCoord[2];
+
+        /**
+         * s and t, and the layer for glyphs in a texture array.
+         */
+        float texCoord[3];
     };
 
 
@@ -55,6 +61,21 @@ namespace difont {
 
         static void AddVertex(difont::FontVertex vertex);
 
+        /**
+         * Add a GL_QUADS quad. It's appended to the last mesh if that mesh
+         * is also GL_QUADS with the same texture and has room, so runs of
+         * glyphs from one texture become a single mesh.
+         */
+        static void AddQuad(unsigned int texId,
+                            const difont::FontVertex& v1, const difont::FontVertex& v2,
+                            const difont::FontVertex& v3, const difont::FontVertex& v4);
+
+        /**
+         * Point the meshes added so far that use one texture at another,
+         * for when a texture is replaced in the middle of a frame.
+         */
+        static void ReplaceTextureId(unsigned int oldTexId, unsigned int newTexId);
+
         static void End();
 
         static int MeshCount();
@@ -123,6 +123,22 @@ const difont::Tesselation* const difont::Mesh::Tesselation(size_t index) const
 }
 
 
+size_t difont::Mesh::Footprint() const
+{
+    // std::list nodes carry two links on top of the point.
+    size_t bytes = sizeof(*this)
+        + tesselationList.capacity() * sizeof(difont::Tesselation*)
+        + tempPointList.size() * (sizeof(difont::Point) + 2 * sizeof(void*));
+
+    for(size_t t = 0; t < tesselationList.size(); ++t)
+    {
+        bytes += tesselationList[t]->Footprint();
+    }
+
+    return bytes;
+}
+
+
 difont::Vectoriser::Vectoriser(const FT_GlyphSlot glyph)
 :   contourList(0),
     mesh(0),
@@ -254,6 +270,18 @@ size_t difont::Vectoriser::PointCount()
 }
 
 
+size_t difont::Vectoriser::Footprint() const
+{
+    size_t bytes = sizeof(*this) + ContourCount() * sizeof(difont::Contour*);
+    for(size_t c = 0; c < ContourCount(); ++c)
+    {
+        bytes += contourList[c]->Footprint();
+    }
+
+    return mesh ? bytes + mesh->Footprint() : bytes;
+}
+
+
 const difont::Contour* const difont::Vectoriser::Contour(size_t index) const
 {
     return (index < ContourCount()) ? contourList[index] : NULL;
@@ -84,6 +84,12 @@ namespace difont {
          */
         size_t PointCount() const { return pointList.size(); }
 
+        /**
+         * The memory used by this tesselation, in bytes.
+         */
+        size_t Footprint() const
+        { return sizeof(*this) + pointList.capacity() * sizeof(difont::Point); }
+
         /**
          *
          */
@@ -171,6 +177,11 @@ namespace difont {
          */
         const PointList& TempPointList() const { return tempPointList; }
 
+        /**
+         * The memory used by this mesh and its tesselations, in bytes.
+         */
+        size_t Footprint() const;
+
         /**
          * Get the GL ERROR returned by the glu tesselator
          */
@@ -255,6 +266,11 @@ namespace difont {
          */
         size_t PointCount();
 
+        /**
+         * The memory held by the contours and mesh, in bytes.
+         */
+        size_t Footprint() const;
+
         /**
          * Get the count of contours in this outline
          *
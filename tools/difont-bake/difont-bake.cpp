@@ -0,0 +1,634 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * difont-bake: rasterise a font ahead of time into a file that
+ * difont::BakedFont renders from without FreeType.
+ *
+ * Usage: difont-bake [options] font-file output-file
+ *
+ *   -s 12,16,24   point sizes to bake (default 16)
+ *   -r 72         resolution of the target device (default 72)
+ *   -c 32-126     a range of character codes to bake; may be repeated
+ *   -t file       bake every character in a UTF-8 text file; may be
+ *                 repeated
+ *   -p 3          padding between glyphs in pixels (default 3)
+ *   -w 1024       largest page width and height (default 1024)
+ *
+ * If no -c or -t is given, printable ASCII (32-126) is baked.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ft2build.h"
+#include FT_FREETYPE_H
+#include FT_OUTLINE_H
+
+#include "BakedFormat.h"
+#include "Unicode.h"
+
+using namespace difont;
+
+
+/**
+ * The same load flags TextureFont uses, so baked glyphs match.
+ */
+static const FT_Int LOAD_FLAGS = FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP;
+
+
+struct BakedGlyph
+{
+    unsigned int ftIndex;
+    baked::GlyphRecord record;
+    std::vector<unsigned char> bitmap;
+};
+
+
+struct BakedSize
+{
+    baked::SizeRecord record;
+    std::vector<BakedGlyph> glyphs;
+    std::vector<baked::CharRecord> chars;
+    std::vector<baked::KerningRecord> kerning;
+};
+
+
+struct BakedPage
+{
+    unsigned int width, height;
+    std::vector<unsigned char> pixels;
+};
+
+
+static void Usage()
+{
+    fprintf(stderr,
+            "usage: difont-bake [-s sizes] [-r resolution] [-c first-last]...\n"
+            "                   [-t textfile]... [-p padding] [-w pagesize]\n"
+            "                   font-file output-file\n");
+    exit(2);
+}
+
+
+static unsigned int NextPowerOf2(unsigned int in)
+{
+    in -= 1;
+
+    in |= in >> 16;
+    in |= in >> 8;
+    in |= in >> 4;
+    in |= in >> 2;
+    in |= in >> 1;
+
+    return in + 1;
+}
+
+
+static bool ReadCorpus(const char* path, std::set<unsigned int>& charCodes)
+{
+    FILE *file = fopen(path, "rb");
+    if(!file)
+    {
+        return false;
+    }
+
+    std::string text;
+    char buffer[4096];
+    size_t n;
+    while((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        text.append(buffer, n);
+    }
+    fclose(file);
+
+    FTUnicodeStringItr<unsigned char> itr(reinterpret_cast<const unsigned char*>(text.c_str()));
+    for(; *itr; ++itr)
+    {
+        if(*itr >= 32)
+        {
+            charCodes.insert(*itr);
+        }
+    }
+
+    return true;
+}
+
+
+static bool BakeSize(FT_Face face, unsigned int size, unsigned int resolution,
+                     const std::set<unsigned int>& charCodes, BakedSize& baked)
+{
+    FT_Error err = FT_Set_Char_Size(face, 0, size * 64, resolution, resolution);
+    if(err)
+    {
+        fprintf(stderr, "difont-bake: can't set size %u (error 0x%02x)\n", size, err);
+        return false;
+    }
+
+    memset(&baked.record, 0, sizeof(baked.record));
+    baked.record.size = size;
+    baked.record.resolution = resolution;
+    baked.record.ascender = face->size->metrics.ascender / 64.0f;
+    baked.record.descender = face->size->metrics.descender / 64.0f;
+
+    // Matches difont::Size::Height().
+    if(FT_IS_SCALABLE(face))
+    {
+        baked.record.lineHeight = (face->bbox.yMax - face->bbox.yMin)
+            * (static_cast<float>(face->size->metrics.y_ppem) / static_cast<float>(face->units_per_EM));
+    }
+    else
+    {
+        baked.record.lineHeight = face->size->metrics.height / 64.0f;
+    }
+
+    // Glyph 0 is always the missing glyph; the rest are in character
+    // code order.
+    std::vector<unsigned int> ftIndices(1, 0);
+    std::vector<unsigned int> glyphOf(face->num_glyphs, 0);
+
+    for(std::set<unsigned int>::const_iterator it = charCodes.begin();
+        it != charCodes.end(); ++it)
+    {
+        unsigned int ftIndex = FT_Get_Char_Index(face, *it);
+        if(!ftIndex)
+        {
+            continue;
+        }
+
+        if(!glyphOf[ftIndex])
+        {
+            glyphOf[ftIndex] = static_cast<unsigned int>(ftIndices.size());
+            ftIndices.push_back(ftIndex);
+        }
+
+        baked::CharRecord charRecord;
+        charRecord.charCode = *it;
+        charRecord.glyph = glyphOf[ftIndex];
+        baked.chars.push_back(charRecord);
+    }
+
+    baked.glyphs.resize(ftIndices.size());
+    for(size_t i = 0; i < ftIndices.size(); ++i)
+    {
+        BakedGlyph& glyph = baked.glyphs[i];
+        memset(&glyph.record, 0, sizeof(glyph.record));
+        glyph.ftIndex = ftIndices[i];
+        glyph.record.page = -1;
+
+        err = FT_Load_Glyph(face, glyph.ftIndex, LOAD_FLAGS);
+        if(err)
+        {
+            fprintf(stderr, "difont-bake: can't load glyph %u (error 0x%02x)\n",
+                    glyph.ftIndex, err);
+            continue;
+        }
+
+        FT_GlyphSlot slot = face->glyph;
+
+        // Matches difont::BBox(FT_GlyphSlot) and GlyphImpl.
+        FT_BBox cbox;
+        FT_Outline_Get_CBox(&slot->outline, &cbox);
+        glyph.record.lower[0] = cbox.xMin / 64.0f;
+        glyph.record.lower[1] = cbox.yMin / 64.0f;
+        glyph.record.upper[0] = cbox.xMax / 64.0f;
+        glyph.record.upper[1] = cbox.yMax / 64.0f;
+        glyph.record.advance = slot->advance.x / 64.0f;
+
+        err = FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
+        if(err || slot->format != FT_GLYPH_FORMAT_BITMAP)
+        {
+            fprintf(stderr, "difont-bake: can't render glyph %u (error 0x%02x)\n",
+                    glyph.ftIndex, err);
+            continue;
+        }
+
+        glyph.record.corner[0] = static_cast<float>(slot->bitmap_left);
+        glyph.record.corner[1] = static_cast<float>(slot->bitmap_top);
+        glyph.record.width = slot->bitmap.width;
+        glyph.record.height = slot->bitmap.rows;
+
+        glyph.bitmap.resize(slot->bitmap.width * slot->bitmap.rows);
+        for(int row = 0; row < slot->bitmap.rows; ++row)
+        {
+            memcpy(&glyph.bitmap[0] + row * slot->bitmap.width,
+                   slot->bitmap.buffer + row * slot->bitmap.pitch,
+                   slot->bitmap.width);
+        }
+    }
+
+    // Kerning between every pair of baked glyphs, as difont::Face does it.
+    if(FT_HAS_KERNING(face))
+    {
+        for(size_t left = 1; left < ftIndices.size(); ++left)
+        {
+            for(size_t right = 1; right < ftIndices.size(); ++right)
+            {
+                FT_Vector kernAdvance;
+                kernAdvance.x = kernAdvance.y = 0;
+
+                if(FT_Get_Kerning(face, ftIndices[left], ftIndices[right],
+                                  FT_KERNING_UNFITTED, &kernAdvance) == 0
+                   && (kernAdvance.x || kernAdvance.y))
+                {
+                    baked::KerningRecord kern;
+                    kern.left = static_cast<uint32_t>(left);
+                    kern.right = static_cast<uint32_t>(right);
+                    kern.x = kernAdvance.x / 64.0f;
+                    kern.y = kernAdvance.y / 64.0f;
+                    baked.kerning.push_back(kern);
+                }
+            }
+        }
+    }
+
+    baked.record.glyphCount = static_cast<uint32_t>(baked.glyphs.size());
+    baked.record.charCount = static_cast<uint32_t>(baked.chars.size());
+    baked.record.kerningCount = static_cast<uint32_t>(baked.kerning.size());
+
+    return true;
+}
+
+
+static bool TallerFirst(const BakedGlyph* a, const BakedGlyph* b)
+{
+    return a->record.height > b->record.height;
+}
+
+
+/**
+ * Shelf-pack every glyph of every size into pages, tallest first.
+ */
+static void Pack(std::vector<BakedSize>& sizes, unsigned int pageSize,
+                 unsigned int padding, std::vector<BakedPage>& pages)
+{
+    std::vector<BakedGlyph*> order;
+    for(size_t s = 0; s < sizes.size(); ++s)
+    {
+        for(size_t g = 0; g < sizes[s].glyphs.size(); ++g)
+        {
+            BakedGlyph& glyph = sizes[s].glyphs[g];
+            if(glyph.record.width && glyph.record.height)
+            {
+                order.push_back(&glyph);
+            }
+        }
+    }
+
+    std::stable_sort(order.begin(), order.end(), TallerFirst);
+
+    int x = 0, y = 0, shelfHeight = 0;
+    int used = 0;
+    for(size_t i = 0; i < order.size(); ++i)
+    {
+        baked::GlyphRecord& record = order[i]->record;
+
+        if(pages.empty() || x + record.width + static_cast<int>(padding) > static_cast<int>(pageSize))
+        {
+            x = padding;
+            y += shelfHeight;
+            shelfHeight = record.height + padding;
+
+            if(pages.empty() || y + shelfHeight > static_cast<int>(pageSize))
+            {
+                if(!pages.empty())
+                {
+                    pages.back().height = used;
+                }
+
+                pages.push_back(BakedPage());
+                pages.back().width = pageSize;
+                x = y = padding;
+            }
+        }
+
+        record.page = static_cast<int32_t>(pages.size() - 1);
+        record.x = x;
+        record.y = y;
+        x += record.width + padding;
+        used = y + shelfHeight;
+    }
+
+    if(!pages.empty())
+    {
+        pages.back().height = used;
+    }
+
+    // Trim each page to a power of two and copy the bitmaps in.
+    for(size_t p = 0; p < pages.size(); ++p)
+    {
+        pages[p].height = NextPowerOf2(pages[p].height);
+        if(pages[p].height > pageSize)
+        {
+            pages[p].height = pageSize;
+        }
+        pages[p].pixels.assign(pages[p].width * pages[p].height, 0);
+    }
+
+    for(size_t i = 0; i < order.size(); ++i)
+    {
+        const baked::GlyphRecord& record = order[i]->record;
+        BakedPage& page = pages[record.page];
+        for(int row = 0; row < record.height; ++row)
+        {
+            memcpy(&page.pixels[(record.y + row) * page.width + record.x],
+                   &order[i]->bitmap[row * record.width], record.width);
+        }
+    }
+}
+
+
+static uint64_t Align8(uint64_t offset)
+{
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+
+static bool Write(const char* path, std::vector<BakedSize>& sizes,
+                  const std::vector<BakedPage>& pages)
+{
+    baked::FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, baked::MAGIC, sizeof(baked::MAGIC));
+    header.version = baked::VERSION;
+    header.byteOrder = baked::ENDIAN_TAG;
+    header.headerSize = sizeof(header);
+    header.pageCount = static_cast<uint32_t>(pages.size());
+    header.sizeCount = static_cast<uint32_t>(sizes.size());
+
+    // Lay the file out.
+    uint64_t offset = sizeof(header);
+    header.pageTable = offset;
+    offset = Align8(offset + pages.size() * sizeof(baked::PageRecord));
+    header.sizeTable = offset;
+    offset = Align8(offset + sizes.size() * sizeof(baked::SizeRecord));
+
+    for(size_t s = 0; s < sizes.size(); ++s)
+    {
+        baked::SizeRecord& record = sizes[s].record;
+        record.glyphTable = offset;
+        offset = Align8(offset + sizes[s].glyphs.size() * sizeof(baked::GlyphRecord));
+        record.charTable = offset;
+        offset = Align8(offset + sizes[s].chars.size() * sizeof(baked::CharRecord));
+        record.kerningTable = offset;
+        offset = Align8(offset + sizes[s].kerning.size() * sizeof(baked::KerningRecord));
+    }
+
+    std::vector<baked::PageRecord> pageRecords(pages.size());
+    for(size_t p = 0; p < pages.size(); ++p)
+    {
+        pageRecords[p].width = pages[p].width;
+        pageRecords[p].height = pages[p].height;
+        pageRecords[p].pixels = offset;
+        offset = Align8(offset + pages[p].pixels.size());
+    }
+
+    header.fileLength = offset;
+
+    FILE *file = fopen(path, "wb");
+    if(!file)
+    {
+        return false;
+    }
+
+    static const unsigned char zeros[8] = { 0 };
+    uint64_t written = 0;
+    bool ok = true;
+
+#define DIFONT_BAKE_WRITE(ptr, bytes) \
+    do { \
+        size_t n = (bytes); \
+        if(ok && n) ok = fwrite((ptr), 1, n, file) == n; \
+        written += n; \
+        if(ok && written % 8) ok = fwrite(zeros, 1, 8 - written % 8, file) == 8 - written % 8; \
+        written = Align8(written); \
+    } while(0)
+
+    DIFONT_BAKE_WRITE(&header, sizeof(header));
+    if(!pageRecords.empty())
+    {
+        DIFONT_BAKE_WRITE(&pageRecords[0], pageRecords.size() * sizeof(baked::PageRecord));
+    }
+    for(size_t s = 0; s < sizes.size(); ++s)
+    {
+        DIFONT_BAKE_WRITE(&sizes[s].record, sizeof(baked::SizeRecord));
+    }
+    for(size_t s = 0; s < sizes.size(); ++s)
+    {
+        std::vector<baked::GlyphRecord> glyphRecords(sizes[s].glyphs.size());
+        for(size_t g = 0; g < glyphRecords.size(); ++g)
+        {
+            glyphRecords[g] = sizes[s].glyphs[g].record;
+        }
+
+        DIFONT_BAKE_WRITE(&glyphRecords[0], glyphRecords.size() * sizeof(baked::GlyphRecord));
+        if(!sizes[s].chars.empty())
+        {
+            DIFONT_BAKE_WRITE(&sizes[s].chars[0], sizes[s].chars.size() * sizeof(baked::CharRecord));
+        }
+        if(!sizes[s].kerning.empty())
+        {
+            DIFONT_BAKE_WRITE(&sizes[s].kerning[0], sizes[s].kerning.size() * sizeof(baked::KerningRecord));
+        }
+    }
+    for(size_t p = 0; p < pages.size(); ++p)
+    {
+        DIFONT_BAKE_WRITE(&pages[p].pixels[0], pages[p].pixels.size());
+    }
+
+#undef DIFONT_BAKE_WRITE
+
+    if(fclose(file) != 0)
+    {
+        ok = false;
+    }
+
+    return ok && written == header.fileLength;
+}
+
+
+int main(int argc, char **argv)
+{
+    std::vector<unsigned int> pointSizes;
+    std::set<unsigned int> charCodes;
+    unsigned int resolution = 72;
+    unsigned int padding = 3;
+    unsigned int pageSize = 1024;
+    bool haveChars = false;
+
+    int arg = 1;
+    for(; arg < argc && argv[arg][0] == '-' && argv[arg][1]; ++arg)
+    {
+        char option = argv[arg][1];
+        if(argv[arg][2] || arg + 1 >= argc)
+        {
+            Usage();
+        }
+        const char *value = argv[++arg];
+
+        switch(option)
+        {
+            case 's':
+            {
+                const char *p = value;
+                while(*p)
+                {
+                    char *end;
+                    unsigned long size = strtoul(p, &end, 10);
+                    if(end == p || !size)
+                    {
+                        Usage();
+                    }
+                    pointSizes.push_back(static_cast<unsigned int>(size));
+                    p = *end == ',' ? end + 1 : end;
+                    if(*end && *end != ',')
+                    {
+                        Usage();
+                    }
+                }
+                break;
+            }
+            case 'r':
+                resolution = static_cast<unsigned int>(strtoul(value, NULL, 10));
+                break;
+            case 'c':
+            {
+                char *end;
+                unsigned long first = strtoul(value, &end, 0);
+                unsigned long last = *end == '-' ? strtoul(end + 1, NULL, 0) : first;
+                if(last < first || last > 0x10ffff)
+                {
+                    Usage();
+                }
+                for(unsigned long c = first; c <= last; ++c)
+                {
+                    charCodes.insert(static_cast<unsigned int>(c));
+                }
+                haveChars = true;
+                break;
+            }
+            case 't':
+                if(!ReadCorpus(value, charCodes))
+                {
+                    fprintf(stderr, "difont-bake: can't read %s\n", value);
+                    return 1;
+                }
+                haveChars = true;
+                break;
+            case 'p':
+                padding = static_cast<unsigned int>(strtoul(value, NULL, 10));
+                break;
+            case 'w':
+                pageSize = NextPowerOf2(static_cast<unsigned int>(strtoul(value, NULL, 10)));
+                break;
+            default:
+                Usage();
+        }
+    }
+
+    if(argc - arg != 2 || !resolution || pageSize < 16)
+    {
+        Usage();
+    }
+
+    const char *fontPath = argv[arg];
+    const char *outputPath = argv[arg + 1];
+
+    if(pointSizes.empty())
+    {
+        pointSizes.push_back(16);
+    }
+
+    if(!haveChars)
+    {
+        for(unsigned int c = 32; c < 127; ++c)
+        {
+            charCodes.insert(c);
+        }
+    }
+
+    FT_Library library;
+    FT_Face face;
+    if(FT_Init_FreeType(&library) || FT_New_Face(library, fontPath, 0, &face))
+    {
+        fprintf(stderr, "difont-bake: can't open %s\n", fontPath);
+        return 1;
+    }
+
+    std::sort(pointSizes.begin(), pointSizes.end());
+    pointSizes.erase(std::unique(pointSizes.begin(), pointSizes.end()), pointSizes.end());
+
+    std::vector<BakedSize> sizes(pointSizes.size());
+    for(size_t s = 0; s < pointSizes.size(); ++s)
+    {
+        if(!BakeSize(face, pointSizes[s], resolution, charCodes, sizes[s]))
+        {
+            return 1;
+        }
+    }
+
+    for(size_t s = 0; s < sizes.size(); ++s)
+    {
+        for(size_t g = 0; g < sizes[s].glyphs.size(); ++g)
+        {
+            const baked::GlyphRecord& record = sizes[s].glyphs[g].record;
+            if(record.width + 2 * padding > pageSize || record.height + 2 * padding > pageSize)
+            {
+                fprintf(stderr, "difont-bake: glyph %u at size %u doesn't fit a %u pixel page\n",
+                        sizes[s].glyphs[g].ftIndex, pointSizes[s], pageSize);
+                return 1;
+            }
+        }
+    }
+
+    std::vector<BakedPage> pages;
+    Pack(sizes, pageSize, padding, pages);
+
+    if(!Write(outputPath, sizes, pages))
+    {
+        fprintf(stderr, "difont-bake: can't write %s\n", outputPath);
+        return 1;
+    }
+
+    for(size_t s = 0; s < sizes.size(); ++s)
+    {
+        printf("size %u: %u glyphs, %u characters, %u kerning pairs\n",
+               sizes[s].record.size, sizes[s].record.glyphCount,
+               sizes[s].record.charCount, sizes[s].record.kerningCount);
+    }
+    printf("%u pages\n", static_cast<unsigned int>(pages.size()));
+
+    FT_Done_Face(face);
+    FT_Done_FreeType(library);
+
+    return 0;
+}
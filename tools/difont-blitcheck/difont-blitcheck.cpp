@@ -0,0 +1,458 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * difont-blitcheck: check how BufferGlyph adds glyph coverage into a
+ * buffer, and fail if anything differs.
+ *
+ * Usage: difont-blitcheck [-s sizes] font-file...
+ *
+ *   -s 9,12,16,24,48  point sizes to rasterise the glyphs at (default
+ *                     9,12,16,24,48)
+ *
+ * Three things are checked:
+ *
+ * - AddCoverageRow(), which adds sixteen pixels at a time with SSE2 or
+ *   NEON, against AddCoverageRowScalar() over random rows of every length
+ *   up to 300 pixels and every alignment, including sums that saturate.
+ *   Where neither instruction set is available they are the same loop.
+ * - AddCoverage() against the blit BufferGlyph used before, which clipped
+ *   each pixel and overwrote the buffer with the glyph's non zero pixels.
+ *   Each glyph of the fonts, in characters 32 to 126, is drawn into a
+ *   clear buffer at positions covering every edge and corner of it,
+ *   partly and wholly outside. Where glyphs don't overlap the two must be
+ *   the same.
+ * - A line of text drawn at the glyphs' advances, where neighbouring
+ *   glyphs may overlap. Pixels covered by one glyph must match the old
+ *   blit, and those covered by several must be at least as dark.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "ft2build.h"
+#include FT_FREETYPE_H
+#include FT_OUTLINE_H
+
+#include "AccumulationRasterizer.h"
+#include "CoverageBlit.h"
+#include "SpanRasterizer.h"
+
+using namespace difont;
+
+
+/**
+ * The same load flags BufferFont uses, so glyphs are checked as drawn.
+ */
+static const FT_Int LOAD_FLAGS = FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP;
+
+/**
+ * The size of the buffer glyphs are drawn into.
+ */
+static const int BUFFER_WIDTH = 61;
+static const int BUFFER_HEIGHT = 37;
+
+
+/**
+ * A glyph's coverage, as BufferGlyph keeps it.
+ */
+struct Bitmap
+{
+    int width, height;
+    int left, top;
+    int advance;
+    std::vector<unsigned char> pixels;
+};
+
+
+static void Usage()
+{
+    fprintf(stderr, "usage: difont-blitcheck [-s sizes] font-file...\n");
+    exit(2);
+}
+
+
+/**
+ * A small generator, so every run checks the same rows.
+ */
+static unsigned int Random()
+{
+    static unsigned int state = 12345;
+    state = state * 1103515245 + 12345;
+    return state >> 16;
+}
+
+
+/**
+ * The blit BufferGlyph used before AddCoverage().
+ */
+static void OverwriteBlit(unsigned char* dest, int destWidth, int destHeight,
+                          int dx, int dy, const unsigned char* src,
+                          int width, int height)
+{
+    for(int y = 0; y < height; y++)
+    {
+        if(y + dy < 0 || y + dy >= destHeight) continue;
+
+        for(int x = 0; x < width; x++)
+        {
+            if(x + dx < 0 || x + dx >= destWidth) continue;
+
+            unsigned char p = src[y * width + x];
+
+            if(p)
+            {
+                dest[(y + dy) * destWidth + x + dx] = p;
+            }
+        }
+    }
+}
+
+
+/**
+ * Check AddCoverageRow() against AddCoverageRowScalar().
+ *
+ * @return  The number of rows that differ.
+ */
+static unsigned int CheckRows(unsigned int& rows)
+{
+    const int MAX_COUNT = 300;
+    const int ALIGNMENTS = 16;
+    unsigned int failed = 0;
+
+    std::vector<unsigned char> src(MAX_COUNT + ALIGNMENTS);
+    std::vector<unsigned char> dest(MAX_COUNT + ALIGNMENTS);
+    std::vector<unsigned char> expected(MAX_COUNT + ALIGNMENTS);
+
+    for(int count = 0; count <= MAX_COUNT; ++count)
+    {
+        for(int align = 0; align < ALIGNMENTS; ++align)
+        {
+            // Uniform pixels, then mostly opaque ones so most sums saturate.
+            for(int fill = 0; fill < 2; ++fill)
+            {
+                for(size_t i = 0; i < src.size(); ++i)
+                {
+                    src[i] = static_cast<unsigned char>(
+                        fill ? 255 - Random() % 64 : Random());
+                    dest[i] = static_cast<unsigned char>(
+                        fill ? 255 - Random() % 64 : Random());
+                }
+                expected = dest;
+
+                AddCoverageRowScalar(&expected[align], &src[ALIGNMENTS - 1 - align],
+                                     count);
+                AddCoverageRow(&dest[align], &src[ALIGNMENTS - 1 - align], count);
+                ++rows;
+
+                if(dest != expected)
+                {
+                    printf("rows: %d pixels at alignment %d differ from the "
+                           "scalar loop\n", count, align);
+                    ++failed;
+                }
+            }
+        }
+    }
+
+    return failed;
+}
+
+
+/**
+ * Rasterise a glyph as BufferGlyph does.
+ */
+static bool LoadBitmap(FT_Face face, FT_UInt glyphIndex,
+                       AccumulationRasterizer& rasterizer, Bitmap& bitmap)
+{
+    if(FT_Load_Glyph(face, glyphIndex, LOAD_FLAGS)
+       || face->glyph->format != FT_GLYPH_FORMAT_OUTLINE)
+    {
+        return false;
+    }
+
+    FT_GlyphSlot slot = face->glyph;
+    SpanRasterizer::Bounds(&slot->outline, bitmap.left, bitmap.top,
+                           bitmap.width, bitmap.height);
+    bitmap.advance = static_cast<int>((slot->advance.x + 32) >> 6);
+    bitmap.pixels.assign(bitmap.width * bitmap.height, 0);
+    if(bitmap.pixels.empty())
+    {
+        return true;
+    }
+
+    if(!rasterizer.Render(&slot->outline, bitmap.left, bitmap.top,
+                          bitmap.width, bitmap.height,
+                          &bitmap.pixels[0], bitmap.width))
+    {
+        return !SpanRasterizer::Render(slot->library, &slot->outline,
+                                       bitmap.left, bitmap.top,
+                                       bitmap.width, bitmap.height,
+                                       &bitmap.pixels[0], bitmap.width);
+    }
+
+    return true;
+}
+
+
+/**
+ * Draw a glyph alone at positions covering every edge and corner of the
+ * buffer, and compare AddCoverage() with the old blit.
+ *
+ * @return  The number of positions that differ.
+ */
+static unsigned int CheckPlacements(const Bitmap& bitmap, unsigned int charCode,
+                                    unsigned int size, unsigned int& placements)
+{
+    unsigned int failed = 0;
+    std::vector<unsigned char> added(BUFFER_WIDTH * BUFFER_HEIGHT);
+    std::vector<unsigned char> overwritten(BUFFER_WIDTH * BUFFER_HEIGHT);
+
+    // From wholly left of or above the buffer to wholly right of or below.
+    for(int dy = -bitmap.height - 1; dy <= BUFFER_HEIGHT + 1; ++dy)
+    {
+        for(int dx = -bitmap.width - 1; dx <= BUFFER_WIDTH + 1; ++dx)
+        {
+            std::fill(added.begin(), added.end(), 0);
+            std::fill(overwritten.begin(), overwritten.end(), 0);
+
+            AddCoverage(&added[0], BUFFER_WIDTH, BUFFER_HEIGHT, dx, dy,
+                        &bitmap.pixels[0], bitmap.width, bitmap.height);
+            OverwriteBlit(&overwritten[0], BUFFER_WIDTH, BUFFER_HEIGHT, dx, dy,
+                          &bitmap.pixels[0], bitmap.width, bitmap.height);
+            ++placements;
+
+            // Only the first place is reported for each glyph.
+            if(added != overwritten && !failed++)
+            {
+                printf("U+%04X at %u: drawn at %d,%d, differs from the "
+                       "overwrite blit\n", charCode, size, dx, dy);
+            }
+        }
+    }
+
+    return failed;
+}
+
+
+/**
+ * Draw the glyphs as a line of text, at their advances, with both blits.
+ *
+ * @return  Whether the pixels covered once match and the others are at
+ *          least as dark.
+ */
+static bool CheckLine(const std::vector<Bitmap>& bitmaps, unsigned int size,
+                      unsigned int& overlapping)
+{
+    int width = 0, height = 0, top = 0;
+    for(size_t i = 0; i < bitmaps.size(); ++i)
+    {
+        width += bitmaps[i].advance > 0 ? bitmaps[i].advance : 0;
+        width += bitmaps[i].width;
+        height = bitmaps[i].height > height ? bitmaps[i].height : height;
+        top = bitmaps[i].top > top ? bitmaps[i].top : top;
+    }
+    height += top;
+
+    if(!width || !height)
+    {
+        return true;
+    }
+
+    std::vector<unsigned char> added(width * height);
+    std::vector<unsigned char> overwritten(width * height);
+    std::vector<unsigned char> covers(width * height);
+
+    int pen = 0;
+    for(size_t i = 0; i < bitmaps.size(); ++i)
+    {
+        const Bitmap& bitmap = bitmaps[i];
+        if(!bitmap.pixels.empty())
+        {
+            int dx = pen + bitmap.left;
+            int dy = top - bitmap.top;
+
+            AddCoverage(&added[0], width, height, dx, dy,
+                        &bitmap.pixels[0], bitmap.width, bitmap.height);
+            OverwriteBlit(&overwritten[0], width, height, dx, dy,
+                          &bitmap.pixels[0], bitmap.width, bitmap.height);
+
+            for(int y = 0; y < bitmap.height; ++y)
+            {
+                for(int x = 0; x < bitmap.width; ++x)
+                {
+                    if(bitmap.pixels[y * bitmap.width + x] && dx + x >= 0
+                       && dx + x < width && dy + y >= 0 && dy + y < height)
+                    {
+                        ++covers[(dy + y) * width + dx + x];
+                    }
+                }
+            }
+        }
+
+        pen += bitmap.advance;
+    }
+
+    bool passed = true;
+    for(size_t i = 0; i < added.size(); ++i)
+    {
+        if(covers[i] > 1)
+        {
+            ++overlapping;
+        }
+
+        if(covers[i] > 1 ? added[i] < overwritten[i] : added[i] != overwritten[i])
+        {
+            passed = false;
+        }
+    }
+
+    if(!passed)
+    {
+        printf("line at %u: differs from the overwrite blit\n", size);
+    }
+
+    return passed;
+}
+
+
+static bool CheckFont(FT_Library library, const char* path,
+                      const std::vector<unsigned int>& pointSizes)
+{
+    FT_Face face;
+    if(FT_New_Face(library, path, 0, &face))
+    {
+        fprintf(stderr, "difont-blitcheck: can't open %s\n", path);
+        return false;
+    }
+
+    AccumulationRasterizer rasterizer;
+    unsigned int glyphs = 0, placements = 0, overlapping = 0, failed = 0;
+
+    for(size_t s = 0; s < pointSizes.size(); ++s)
+    {
+        if(FT_Set_Char_Size(face, 0, pointSizes[s] * 64, 72, 72))
+        {
+            fprintf(stderr, "difont-blitcheck: %s has no size %u\n",
+                    path, pointSizes[s]);
+            FT_Done_Face(face);
+            return false;
+        }
+
+        std::vector<Bitmap> line;
+        for(unsigned int charCode = 32; charCode <= 126; ++charCode)
+        {
+            FT_UInt glyphIndex = FT_Get_Char_Index(face, charCode);
+            Bitmap bitmap;
+            if(!glyphIndex || !LoadBitmap(face, glyphIndex, rasterizer, bitmap))
+            {
+                continue;
+            }
+
+            line.push_back(bitmap);
+            if(bitmap.pixels.empty())
+            {
+                continue;
+            }
+
+            ++glyphs;
+            failed += CheckPlacements(bitmap, charCode, pointSizes[s], placements);
+        }
+
+        failed += !CheckLine(line, pointSizes[s], overlapping);
+    }
+
+    FT_Done_Face(face);
+
+    printf("%s: %u glyphs drawn at %u places, %u pixels where neighbours "
+           "overlap; %u differ\n", path, glyphs, placements, overlapping, failed);
+
+    return failed == 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    std::vector<unsigned int> pointSizes;
+
+    int arg = 1;
+    for(; arg < argc && argv[arg][0] == '-' && argv[arg][1]; ++arg)
+    {
+        if(argv[arg][1] != 's' || argv[arg][2] || arg + 1 >= argc)
+        {
+            Usage();
+        }
+
+        const char *p = argv[++arg];
+        while(*p)
+        {
+            char *end;
+            unsigned long size = strtoul(p, &end, 10);
+            if(end == p || !size || (*end && *end != ','))
+            {
+                Usage();
+            }
+            pointSizes.push_back(static_cast<unsigned int>(size));
+            p = *end == ',' ? end + 1 : end;
+        }
+    }
+
+    if(arg >= argc)
+    {
+        Usage();
+    }
+
+    if(pointSizes.empty())
+    {
+        static const unsigned int DEFAULT_SIZES[] = { 9, 12, 16, 24, 48 };
+        pointSizes.assign(DEFAULT_SIZES, DEFAULT_SIZES + 5);
+    }
+
+    unsigned int rows = 0;
+    unsigned int failedRows = CheckRows(rows);
+    printf("rows: %u added, %u differ from the scalar loop\n", rows, failedRows);
+    bool passed = failedRows == 0;
+
+    FT_Library library;
+    if(FT_Init_FreeType(&library))
+    {
+        fprintf(stderr, "difont-blitcheck: can't start FreeType\n");
+        return 1;
+    }
+
+    for(; arg < argc; ++arg)
+    {
+        passed = CheckFont(library, argv[arg], pointSizes) && passed;
+    }
+
+    FT_Done_FreeType(library);
+
+    return passed ? 0 : 1;
+}
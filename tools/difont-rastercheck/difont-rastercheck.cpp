@@ -0,0 +1,714 @@
+/*
+ * FTGL - OpenGL font library
+ *
+ * Copyright (c) 2001-2004 Henry Maddocks <ftgl@opengl.geek.nz>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/*
+ * difont-rastercheck: check the coverage TextureFont's
+ * AccumulationRasterizer gives each glyph of a font, and fail if any glyph
+ * is out of tolerance.
+ *
+ * Usage: difont-rastercheck [options] font-file...
+ *
+ *   -s 9,12,16,24,48  point sizes to check (default 9,12,16,24,48)
+ *   -r 72             resolution (default 72)
+ *   -p 4              subpixel phases to check at each size (default 4)
+ *   -c 32-126         a range of character codes to check; may be
+ *                     repeated (default 32-126)
+ *   -m 12             the most a pixel may differ from the reference, in
+ *                     levels of 255 (default 12)
+ *   -a 3              the most the glyph's mean difference from the
+ *                     reference may be (default 3)
+ *   -l 1              the most a pixel of a glyph with straight edges only
+ *                     may differ from FT_Render_Glyph (default 1)
+ *   -t 200            time this many passes over the glyphs at each size
+ *                     instead of checking them
+ *
+ * Glyphs with straight edges only must match FT_Render_Glyph but for
+ * rounding. Curves can't be checked that way: FreeType 2.4 flattens them
+ * to within a quarter pixel, so its coverage strays by up to about 100
+ * levels on curved edges. Every glyph is instead checked against a
+ * reference that FreeType rasterises at 16 times the size and that is
+ * then averaged down. That flattens curves to within 1/64 pixel, so the
+ * reference is within 4 levels of exact; flattening to within 1/32 pixel
+ * keeps the rasteriser within 8, hence the default of 12. The mean is
+ * over the pixels either covers, so it is highest at small sizes, where
+ * most of them are on an edge.
+ *
+ * The worst differences from FT_Render_Glyph are reported as well. Glyphs
+ * the rasteriser leaves to FreeType, such as even-odd filled ones, are
+ * counted but not checked.
+ *
+ * With -t each glyph is rasterised by AccumulationRasterizer and by
+ * FT_Outline_Get_Bitmap, the FreeType call it replaces, and the time per
+ * pass over the glyphs is reported for both. Outlines are loaded before
+ * timing starts, and glyphs left to FreeType are not timed. The bitmap
+ * FreeType renders into is cleared first, as it only writes covered
+ * pixels.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <set>
+#include <vector>
+
+#include "ft2build.h"
+#include FT_FREETYPE_H
+#include FT_OUTLINE_H
+
+#include "AccumulationRasterizer.h"
+#include "SpanRasterizer.h"
+
+using namespace difont;
+
+
+/**
+ * The same load flags TextureFont uses, so glyphs are checked as drawn.
+ */
+static const FT_Int LOAD_FLAGS = FT_LOAD_NO_HINTING | FT_LOAD_NO_BITMAP;
+
+/**
+ * How many times the size the reference is rasterised at, each way.
+ */
+static const int SUPERSAMPLE = 16;
+
+
+struct Tolerance
+{
+    int maxDifference;
+    double meanDifference;
+    int straightDifference;
+};
+
+
+/**
+ * The worst difference found between two renderings.
+ */
+struct Difference
+{
+    int max;
+    double mean;
+};
+
+
+struct Totals
+{
+    unsigned int glyphs;
+    unsigned int straight;
+    unsigned int failed;
+    unsigned int fellBack;
+    Difference reference;
+    Difference freeTypeReference;
+    Difference freeType;
+    Difference straightFreeType;
+};
+
+
+/**
+ * A glyph loaded for timing, moved so its pixels start at the origin.
+ */
+struct TimedGlyph
+{
+    FT_Outline outline;
+    int width, height;
+};
+
+
+static void Usage()
+{
+    fprintf(stderr,
+            "usage: difont-rastercheck [-s sizes] [-r resolution] [-p phases]\n"
+            "                          [-c first-last]... [-m max] [-a mean]\n"
+            "                          [-l straight] [-t passes] font-file...\n");
+    exit(2);
+}
+
+
+/**
+ * Whether every point of an outline is on the curve, so it has no
+ * curved edges.
+ */
+static bool Straight(const FT_Outline& outline)
+{
+    for(int i = 0; i < outline.n_points; ++i)
+    {
+        if(FT_CURVE_TAG(outline.tags[i]) != FT_CURVE_TAG_ON)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * Rasterise an outline at SUPERSAMPLE times the size into pixels found by
+ * SpanRasterizer::Bounds, averaging each block down to a pixel.
+ */
+static bool Reference(FT_Library library, const FT_Outline& outline,
+                      int left, int top, int width, int height,
+                      std::vector<unsigned char>& pixels)
+{
+    FT_Outline scaled;
+    if(FT_Outline_New(library, outline.n_points, outline.n_contours, &scaled))
+    {
+        return false;
+    }
+    FT_Outline_Copy(&outline, &scaled);
+
+    FT_Matrix matrix = { SUPERSAMPLE << 16, 0, 0, SUPERSAMPLE << 16 };
+    FT_Outline_Transform(&scaled, &matrix);
+
+    const int bigWidth = width * SUPERSAMPLE;
+    std::vector<unsigned char> big(bigWidth * height * SUPERSAMPLE);
+    FT_Error error = SpanRasterizer::Render(library, &scaled,
+                                            left * SUPERSAMPLE, top * SUPERSAMPLE,
+                                            bigWidth, height * SUPERSAMPLE,
+                                            &big[0], bigWidth);
+    FT_Outline_Done(library, &scaled);
+    if(error)
+    {
+        return false;
+    }
+
+    const int samples = SUPERSAMPLE * SUPERSAMPLE;
+    pixels.resize(width * height);
+    for(int y = 0; y < height; ++y)
+    {
+        for(int x = 0; x < width; ++x)
+        {
+            int sum = 0;
+            for(int j = 0; j < SUPERSAMPLE; ++j)
+            {
+                const unsigned char *row = &big[(y * SUPERSAMPLE + j) * bigWidth
+                                                + x * SUPERSAMPLE];
+                for(int i = 0; i < SUPERSAMPLE; ++i)
+                {
+                    sum += row[i];
+                }
+            }
+            pixels[y * width + x] = static_cast<unsigned char>((sum + samples / 2) / samples);
+        }
+    }
+
+    return true;
+}
+
+
+/**
+ * Compare two renderings of a glyph. The mean is over the pixels either
+ * covers.
+ */
+static Difference Compare(const unsigned char* a, int aPitch,
+                          const unsigned char* b, int bPitch,
+                          int width, int height)
+{
+    Difference difference;
+    difference.max = 0;
+    long sum = 0;
+    int covered = 0;
+
+    for(int y = 0; y < height; ++y)
+    {
+        for(int x = 0; x < width; ++x)
+        {
+            int first = a[y * aPitch + x];
+            int second = b[y * bPitch + x];
+            int d = abs(first - second);
+
+            if(first || second)
+            {
+                sum += d;
+                ++covered;
+            }
+
+            if(d > difference.max)
+            {
+                difference.max = d;
+            }
+        }
+    }
+
+    difference.mean = covered ? static_cast<double>(sum) / covered : 0.0;
+    return difference;
+}
+
+
+static void Worst(Difference& worst, const Difference& difference)
+{
+    if(difference.max > worst.max)
+    {
+        worst.max = difference.max;
+    }
+    if(difference.mean > worst.mean)
+    {
+        worst.mean = difference.mean;
+    }
+}
+
+
+/**
+ * Check one glyph at one phase. The slot is rendered by FreeType last,
+ * since that replaces its outline.
+ */
+static void CheckGlyph(FT_Library library, FT_Face face, unsigned int charCode,
+                       unsigned int size, unsigned int phase, unsigned int phases,
+                       AccumulationRasterizer& rasterizer,
+                       const Tolerance& tolerance, Totals& totals)
+{
+    FT_GlyphSlot slot = face->glyph;
+    if(phase)
+    {
+        FT_Outline_Translate(&slot->outline,
+                             static_cast<FT_Pos>(phase * 64 / phases), 0);
+    }
+
+    int left, top, width, height;
+    SpanRasterizer::Bounds(&slot->outline, left, top, width, height);
+    if(!width || !height)
+    {
+        return;
+    }
+
+    bool straight = Straight(slot->outline);
+
+    std::vector<unsigned char> pixels(width * height);
+    if(!rasterizer.Render(&slot->outline, left, top, width, height,
+                          &pixels[0], width))
+    {
+        ++totals.fellBack;
+        return;
+    }
+
+    std::vector<unsigned char> reference;
+    if(!Reference(library, slot->outline, left, top, width, height, reference)
+       || FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL))
+    {
+        fprintf(stderr, "U+%04X at %u: FreeType can't render it\n", charCode, size);
+        ++totals.failed;
+        return;
+    }
+
+    const FT_Bitmap& bitmap = slot->bitmap;
+    ++totals.glyphs;
+    totals.straight += straight;
+
+    if(slot->bitmap_left != left || slot->bitmap_top != top
+       || static_cast<int>(bitmap.width) != width
+       || static_cast<int>(bitmap.rows) != height)
+    {
+        printf("U+%04X at %u phase %u: bounds %d,%d %dx%d, FreeType %d,%d %dx%d\n",
+               charCode, size, phase, left, top, width, height,
+               slot->bitmap_left, slot->bitmap_top, bitmap.width, bitmap.rows);
+        ++totals.failed;
+        return;
+    }
+
+    Difference fromReference = Compare(&pixels[0], width, &reference[0], width,
+                                       width, height);
+    Difference fromFreeType = Compare(&pixels[0], width, bitmap.buffer, bitmap.pitch,
+                                      width, height);
+    Worst(totals.reference, fromReference);
+    Worst(totals.freeTypeReference, Compare(bitmap.buffer, bitmap.pitch,
+                                            &reference[0], width, width, height));
+    Worst(straight ? totals.straightFreeType : totals.freeType, fromFreeType);
+
+    bool failed = false;
+    if(fromReference.max > tolerance.maxDifference
+       || fromReference.mean > tolerance.meanDifference)
+    {
+        printf("U+%04X at %u phase %u: differs from the reference by up to %d, "
+               "%.2f on average\n",
+               charCode, size, phase, fromReference.max, fromReference.mean);
+        failed = true;
+    }
+
+    if(straight && fromFreeType.max > tolerance.straightDifference)
+    {
+        printf("U+%04X at %u phase %u: straight, but differs from FreeType by up "
+               "to %d\n", charCode, size, phase, fromFreeType.max);
+        failed = true;
+    }
+
+    totals.failed += failed;
+}
+
+
+static bool CheckFont(FT_Library library, const char* path,
+                      const std::vector<unsigned int>& pointSizes,
+                      unsigned int resolution, unsigned int phases,
+                      const std::set<unsigned int>& charCodes,
+                      const Tolerance& tolerance)
+{
+    FT_Face face;
+    if(FT_New_Face(library, path, 0, &face))
+    {
+        fprintf(stderr, "difont-rastercheck: can't open %s\n", path);
+        return false;
+    }
+
+    AccumulationRasterizer rasterizer;
+    Totals totals;
+    memset(&totals, 0, sizeof(totals));
+
+    for(size_t s = 0; s < pointSizes.size(); ++s)
+    {
+        if(FT_Set_Char_Size(face, 0, pointSizes[s] * 64, resolution, resolution))
+        {
+            fprintf(stderr, "difont-rastercheck: %s has no size %u\n",
+                    path, pointSizes[s]);
+            FT_Done_Face(face);
+            return false;
+        }
+
+        for(std::set<unsigned int>::const_iterator it = charCodes.begin();
+            it != charCodes.end(); ++it)
+        {
+            FT_UInt glyphIndex = FT_Get_Char_Index(face, *it);
+            if(!glyphIndex)
+            {
+                continue;
+            }
+
+            for(unsigned int phase = 0; phase < phases; ++phase)
+            {
+                // Loaded again for each phase, as FT_Render_Glyph
+                // replaces the outline.
+                if(FT_Load_Glyph(face, glyphIndex, LOAD_FLAGS)
+                   || face->glyph->format != FT_GLYPH_FORMAT_OUTLINE)
+                {
+                    break;
+                }
+
+                CheckGlyph(library, face, *it, pointSizes[s], phase, phases,
+                           rasterizer, tolerance, totals);
+            }
+        }
+    }
+
+    FT_Done_Face(face);
+
+    printf("%s: %u glyphs, %u with straight edges only; %u out of tolerance, "
+           "%u left to FreeType\n"
+           "  from the reference:      worst pixel %3d, worst mean %5.2f "
+           "(FT_Render_Glyph %d, %.2f)\n"
+           "  from FT_Render_Glyph:    worst pixel %3d, worst mean %5.2f\n"
+           "    with straight edges:   worst pixel %3d, worst mean %5.2f\n",
+           path, totals.glyphs, totals.straight, totals.failed, totals.fellBack,
+           totals.reference.max, totals.reference.mean,
+           totals.freeTypeReference.max, totals.freeTypeReference.mean,
+           totals.freeType.max, totals.freeType.mean,
+           totals.straightFreeType.max, totals.straightFreeType.mean);
+
+    return totals.failed == 0;
+}
+
+
+/**
+ * Load the outlines of a face at one size for timing, leaving out those
+ * the rasteriser leaves to FreeType.
+ */
+static void LoadTimedGlyphs(FT_Library library, FT_Face face,
+                            const std::set<unsigned int>& charCodes,
+                            AccumulationRasterizer& rasterizer,
+                            std::vector<unsigned char>& pixels,
+                            std::vector<TimedGlyph>& glyphs)
+{
+    for(std::set<unsigned int>::const_iterator it = charCodes.begin();
+        it != charCodes.end(); ++it)
+    {
+        FT_UInt glyphIndex = FT_Get_Char_Index(face, *it);
+        if(!glyphIndex || FT_Load_Glyph(face, glyphIndex, LOAD_FLAGS)
+           || face->glyph->format != FT_GLYPH_FORMAT_OUTLINE)
+        {
+            continue;
+        }
+
+        const FT_Outline& outline = face->glyph->outline;
+        int left, top, width, height;
+        SpanRasterizer::Bounds(&outline, left, top, width, height);
+        if(!width || !height)
+        {
+            continue;
+        }
+
+        TimedGlyph glyph;
+        if(FT_Outline_New(library, outline.n_points, outline.n_contours,
+                          &glyph.outline))
+        {
+            continue;
+        }
+        FT_Outline_Copy(&outline, &glyph.outline);
+        FT_Outline_Translate(&glyph.outline, -left * 64, (height - top) * 64);
+        glyph.width = width;
+        glyph.height = height;
+
+        if(pixels.size() < static_cast<size_t>(width * height))
+        {
+            pixels.resize(width * height);
+        }
+
+        if(!rasterizer.Render(&glyph.outline, 0, height, width, height,
+                              &pixels[0], width))
+        {
+            FT_Outline_Done(library, &glyph.outline);
+            continue;
+        }
+
+        glyphs.push_back(glyph);
+    }
+}
+
+
+/**
+ * The milliseconds of processor time since an earlier clock().
+ */
+static double Milliseconds(clock_t start)
+{
+    return (clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+
+static bool TimeFont(FT_Library library, const char* path,
+                     const std::vector<unsigned int>& pointSizes,
+                     unsigned int resolution,
+                     const std::set<unsigned int>& charCodes,
+                     unsigned int passes)
+{
+    FT_Face face;
+    if(FT_New_Face(library, path, 0, &face))
+    {
+        fprintf(stderr, "difont-rastercheck: can't open %s\n", path);
+        return false;
+    }
+
+    printf("%s: milliseconds per pass, %u passes\n"
+           "  size  glyphs  AccumulationRasterizer  FT_Outline_Get_Bitmap  speedup\n",
+           path, passes);
+
+    AccumulationRasterizer rasterizer;
+    std::vector<unsigned char> pixels;
+
+    for(size_t s = 0; s < pointSizes.size(); ++s)
+    {
+        if(FT_Set_Char_Size(face, 0, pointSizes[s] * 64, resolution, resolution))
+        {
+            fprintf(stderr, "difont-rastercheck: %s has no size %u\n",
+                    path, pointSizes[s]);
+            FT_Done_Face(face);
+            return false;
+        }
+
+        std::vector<TimedGlyph> glyphs;
+        LoadTimedGlyphs(library, face, charCodes, rasterizer, pixels, glyphs);
+
+        clock_t start = clock();
+        for(unsigned int pass = 0; pass < passes; ++pass)
+        {
+            for(size_t g = 0; g < glyphs.size(); ++g)
+            {
+                const TimedGlyph& glyph = glyphs[g];
+                rasterizer.Render(&glyph.outline, 0, glyph.height,
+                                  glyph.width, glyph.height,
+                                  &pixels[0], glyph.width);
+            }
+        }
+        double accumulation = Milliseconds(start);
+
+        start = clock();
+        for(unsigned int pass = 0; pass < passes; ++pass)
+        {
+            for(size_t g = 0; g < glyphs.size(); ++g)
+            {
+                TimedGlyph& glyph = glyphs[g];
+                FT_Bitmap bitmap;
+                memset(&bitmap, 0, sizeof(bitmap));
+                bitmap.rows = glyph.height;
+                bitmap.width = glyph.width;
+                bitmap.pitch = glyph.width;
+                bitmap.buffer = &pixels[0];
+                bitmap.num_grays = 256;
+                bitmap.pixel_mode = FT_PIXEL_MODE_GRAY;
+
+                memset(&pixels[0], 0, glyph.width * glyph.height);
+                FT_Outline_Get_Bitmap(library, &glyph.outline, &bitmap);
+            }
+        }
+        double freeType = Milliseconds(start);
+
+        printf("  %4u  %6u  %22.3f  %21.3f  %6.2fx\n",
+               pointSizes[s], static_cast<unsigned int>(glyphs.size()),
+               accumulation / passes, freeType / passes,
+               accumulation > 0.0 ? freeType / accumulation : 0.0);
+
+        for(size_t g = 0; g < glyphs.size(); ++g)
+        {
+            FT_Outline_Done(library, &glyphs[g].outline);
+        }
+    }
+
+    FT_Done_Face(face);
+    return true;
+}
+
+
+int main(int argc, char **argv)
+{
+    std::vector<unsigned int> pointSizes;
+    std::set<unsigned int> charCodes;
+    unsigned int resolution = 72;
+    unsigned int phases = 4;
+    unsigned int passes = 0;
+    Tolerance tolerance;
+    tolerance.maxDifference = 12;
+    tolerance.meanDifference = 3.0;
+    tolerance.straightDifference = 1;
+
+    int arg = 1;
+    for(; arg < argc && argv[arg][0] == '-' && argv[arg][1]; ++arg)
+    {
+        char option = argv[arg][1];
+        if(argv[arg][2] || arg + 1 >= argc)
+        {
+            Usage();
+        }
+        const char *value = argv[++arg];
+
+        switch(option)
+        {
+            case 's':
+            {
+                const char *p = value;
+                while(*p)
+                {
+                    char *end;
+                    unsigned long size = strtoul(p, &end, 10);
+                    if(end == p || !size)
+                    {
+                        Usage();
+                    }
+                    pointSizes.push_back(static_cast<unsigned int>(size));
+                    p = *end == ',' ? end + 1 : end;
+                    if(*end && *end != ',')
+                    {
+                        Usage();
+                    }
+                }
+                break;
+            }
+            case 'r':
+                resolution = static_cast<unsigned int>(strtoul(value, NULL, 10));
+                break;
+            case 'p':
+                phases = static_cast<unsigned int>(strtoul(value, NULL, 10));
+                if(!phases || phases > 64)
+                {
+                    Usage();
+                }
+                break;
+            case 'c':
+            {
+                char *end;
+                unsigned long first = strtoul(value, &end, 0);
+                unsigned long last = *end == '-' ? strtoul(end + 1, NULL, 0) : first;
+                if(last < first || last > 0x10ffff)
+                {
+                    Usage();
+                }
+                for(unsigned long c = first; c <= last; ++c)
+                {
+                    charCodes.insert(static_cast<unsigned int>(c));
+                }
+                break;
+            }
+            case 'm':
+                tolerance.maxDifference = atoi(value);
+                break;
+            case 'a':
+                tolerance.meanDifference = atof(value);
+                break;
+            case 'l':
+                tolerance.straightDifference = atoi(value);
+                break;
+            case 't':
+                passes = static_cast<unsigned int>(strtoul(value, NULL, 10));
+                if(!passes)
+                {
+                    Usage();
+                }
+                break;
+            default:
+                Usage();
+        }
+    }
+
+    if(arg >= argc || !resolution)
+    {
+        Usage();
+    }
+
+    if(pointSizes.empty())
+    {
+        static const unsigned int DEFAULT_SIZES[] = { 9, 12, 16, 24, 48 };
+        pointSizes.assign(DEFAULT_SIZES, DEFAULT_SIZES + 5);
+    }
+
+    if(charCodes.empty())
+    {
+        for(unsigned int c = 32; c <= 126; ++c)
+        {
+            charCodes.insert(c);
+        }
+    }
+
+    FT_Library library;
+    if(FT_Init_FreeType(&library))
+    {
+        fprintf(stderr, "difont-rastercheck: can't start FreeType\n");
+        return 1;
+    }
+
+    bool passed = true;
+    for(; arg < argc; ++arg)
+    {
+        if(passes)
+        {
+            passed = TimeFont(library, argv[arg], pointSizes, resolution,
+                              charCodes, passes) && passed;
+        }
+        else
+        {
+            passed = CheckFont(library, argv[arg], pointSizes, resolution, phases,
+                               charCodes, tolerance) && passed;
+        }
+    }
+
+    FT_Done_FreeType(library);
+
+    return passed ? 0 : 1;
+}